@@ -0,0 +1,117 @@
+#include <stdlib.h>
+#include <memory.h>
+#include <pthread.h>
+
+#include "asym.h"
+#include "atomic.h"
+#include "util.h"
+
+__thread sxlatch_asym_slots_t * __sxlatch_asym_my_slots = NULL;
+
+/* all slot blocks ever created */
+static sxlatch_asym_slots_t * volatile __sxlatch_asym_all_slots = NULL;
+
+static pthread_once_t __sxlatch_asym_once = PTHREAD_ONCE_INIT;
+static pthread_key_t  __sxlatch_asym_key;
+
+static void __sxlatch_asym_detach( void * arg )
+{
+    sxlatch_asym_slots_t * slots = (sxlatch_asym_slots_t *)arg;
+
+    mem_barrier();
+    slots->in_use = 0;
+}
+
+static void __sxlatch_asym_init_key( void )
+{
+    pthread_key_create( &__sxlatch_asym_key, __sxlatch_asym_detach );
+}
+
+sxlatch_asym_slots_t * sxlatch_asym_attach( void )
+{
+    sxlatch_asym_slots_t * slots = NULL;
+    sxlatch_asym_slots_t * oldhead = NULL;
+
+    pthread_once( &__sxlatch_asym_once, __sxlatch_asym_init_key );
+
+    /* reuse the slots of an exited thread first */
+    for( slots = __sxlatch_asym_all_slots; slots != NULL; slots = slots->next )
+    {
+        if( slots->in_use == 0 &&
+            atomic_cas_32( &(slots->in_use), 0, 1 ) == 0 )
+        {
+            break;
+        }
+    }
+
+    if( slots == NULL )
+    {
+        TRY( posix_memalign( (void **)&slots, 64, sizeof(sxlatch_asym_slots_t) ) != 0 );
+        memset( slots, 0x00, sizeof(sxlatch_asym_slots_t) );
+        slots->in_use = 1;
+
+        do
+        {
+            oldhead     = __sxlatch_asym_all_slots;
+            slots->next = oldhead;
+        } while( atomic_cas_64( &__sxlatch_asym_all_slots, oldhead, slots ) != oldhead );
+    }
+
+    slots->top = 0;
+
+    pthread_setspecific( __sxlatch_asym_key, slots );
+    __sxlatch_asym_my_slots = slots;
+
+    return slots;
+
+    CATCH_END;
+
+    return NULL;
+}
+
+int sxlatch_asym_release( const void * latch, session_id_t session_id )
+{
+    sxlatch_asym_slots_t * slots = NULL;
+    int released = 0;
+    int idx = 0;
+
+    for( slots = __sxlatch_asym_all_slots; slots != NULL; slots = slots->next )
+    {
+        for( idx = SXLATCH_ASYM_SLOT_CNT - 1; idx >= 0; idx-- )
+        {
+            if( slots->latches[idx] != NULL &&
+                slots->sessions[idx] == session_id &&
+                ( latch == NULL || slots->latches[idx] == latch ) )
+            {
+                __atomic_store_n( &(slots->latches[idx]), NULL, __ATOMIC_RELEASE );
+                released++;
+
+                if( latch != NULL )
+                {
+                    return released;
+                }
+            }
+        }
+    }
+
+    return released;
+}
+
+bool sxlatch_asym_is_read( const void * latch )
+{
+    sxlatch_asym_slots_t * slots = NULL;
+    int idx = 0;
+
+    for( slots = __sxlatch_asym_all_slots; slots != NULL; slots = slots->next )
+    {
+        for( idx = 0; idx < SXLATCH_ASYM_SLOT_CNT; idx++ )
+        {
+            if( slots->latches[idx] == latch )
+            {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
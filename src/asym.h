@@ -0,0 +1,39 @@
+#ifndef _ASYM_H_
+#define _ASYM_H_ 1
+
+#include <stdint.h>
+#include "util.h"
+#include "session.h"
+
+/* reader slots of the asymmetric-fence policy(SXLATCH_POLICY_ASYMMETRIC)
+ * A reader publishes the latch it reads in a slot of its own thread with
+ * plain stores. A writer makes those stores visible with membarrier(2)
+ * and scans the slots of all threads. Slot blocks are never freed: the
+ * block of an exited thread is handed over to a new thread. */
+
+#define SXLATCH_ASYM_SLOT_CNT       4   /* nested reads per thread */
+
+typedef struct _sxlatch_asym_slots sxlatch_asym_slots_t;
+struct _sxlatch_asym_slots
+{
+    sxlatch_asym_slots_t * next;
+    volatile int32_t       in_use;
+    int32_t                top;       /* owner thread only */
+    const void * volatile  latches[SXLATCH_ASYM_SLOT_CNT];
+    session_id_t           sessions[SXLATCH_ASYM_SLOT_CNT];
+} __attribute__((aligned(64)));
+
+extern __thread sxlatch_asym_slots_t * __sxlatch_asym_my_slots;
+
+/* the slots of the calling thread, allocated at the first read */
+sxlatch_asym_slots_t * sxlatch_asym_attach( void );
+
+/* true if a thread reads the latch through its slots */
+bool sxlatch_asym_is_read( const void * latch );
+
+/* recovery of a dead session: clear its slots of the latch(NULL: of all
+ * latches) in the blocks of all threads, living or exited. The number of
+ * slots cleared; one at most for a latch. */
+int sxlatch_asym_release( const void * latch, session_id_t session_id );
+
+#endif /* _ASYM_H_ */
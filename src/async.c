@@ -0,0 +1,378 @@
+#include <stdlib.h>
+#include <memory.h>
+#include <errno.h>
+#include <time.h>
+#include <sched.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "async.h"
+#include "session.h"
+#include "atomic.h"
+#include "util.h"
+
+#define SXLATCH_ASYNC_BACKSTOP_MSEC  10    /* releases no one signals(step-backs) */
+
+static pthread_mutex_t   __sxlatch_async_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t    __sxlatch_async_cond;
+static pthread_once_t    __sxlatch_async_once  = PTHREAD_ONCE_INIT;
+static pthread_mutex_t   __sxlatch_async_stop_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_t         __sxlatch_async_thread;
+static bool              __sxlatch_async_running  = false;
+static bool              __sxlatch_async_stopping = false;
+
+/* requests queued since the last pass of the granter */
+static sxlatch_async_t * __sxlatch_async_incoming = NULL;
+
+/* queued requests not completed yet: the release paths signal the granter
+ * while it is not 0. release_seq moves at each signal. */
+volatile int32_t         __sxlatch_async_pending = 0;
+static volatile int32_t  __sxlatch_async_release_seq = 0;
+
+static void __sxlatch_async_init_cond( void )
+{
+    pthread_condattr_t attr;
+
+    pthread_condattr_init( &attr );
+    pthread_condattr_setclock( &attr, CLOCK_MONOTONIC );
+    pthread_cond_init( &__sxlatch_async_cond, &attr );
+    pthread_condattr_destroy( &attr );
+}
+
+void sxlatch_async_notify( void )
+{
+    atomic_inc_fetch( &__sxlatch_async_release_seq );
+
+    pthread_mutex_lock( &__sxlatch_async_mutex );
+    pthread_cond_signal( &__sxlatch_async_cond );
+    pthread_mutex_unlock( &__sxlatch_async_mutex );
+}
+
+int sxlatch_async_init( sxlatch_async_t *    req,
+                        int                  efd,
+                        sxlatch_async_func_t func,
+                        void *               arg )
+{
+    TRY( req == NULL );
+
+    memset( req, 0x00, sizeof(sxlatch_async_t) );
+    req->efd   = efd;
+    req->func  = func;
+    req->arg   = arg;
+    req->state = SXLATCH_ASYNC_IDLE;
+
+    return RC_SUCCESS;
+
+    CATCH_END;
+
+    return RC_FAIL;
+}
+
+static void __sxlatch_async_complete( sxlatch_async_t * req, int status )
+{
+    sxlatch_async_func_t func = req->func;
+    void * arg = req->arg;
+    int efd = req->efd;
+    uint64_t one = 1;
+
+    req->status = status;
+    mem_barrier();
+    req->state = SXLATCH_ASYNC_DONE;
+    atomic_fetch_dec( &__sxlatch_async_pending );
+
+    /* the request belongs to the caller from here */
+    if( func != NULL )
+    {
+        func( req, arg );
+    }
+
+    if( efd >= 0 )
+    {
+        (void)write( efd, &one, sizeof(one) );
+    }
+}
+
+/* one try for a queued request: true if it completed */
+static bool __sxlatch_async_try( sxlatch_async_t * req )
+{
+    int ret = 0;
+
+    if( req->cancelled != 0 ||
+        sxlatch_session_is_interrupted( sxlatch_session_find( req->session_id ) ) )
+    {
+        if( req->mode != BF_LATCH_MODE_S )
+        {
+            (void)sxlatch_trywrlock_unmark( req->latch, req->session_id );
+        }
+        __sxlatch_async_complete( req, RC_ERR_LOCK_INTERRUPTED );
+        return true;
+    }
+
+    ret = ( req->mode == BF_LATCH_MODE_S ) ?
+          sxlatch_tryrdlock( req->latch, req->session_id ) :
+          sxlatch_trywrlock_mark( req->latch, req->session_id );
+
+    if( ret == RC_SUCCESS || ret == RC_ERR_LOCK_TIMEOUT )
+    {
+        if( ret == RC_SUCCESS && __sxlatch_hold_track_enabled != 0 )
+        {
+            sxlatch_session_hold_add( req->session_id, req->latch, req->mode );
+        }
+        if( ret == RC_ERR_LOCK_TIMEOUT && req->mode != BF_LATCH_MODE_S )
+        {
+            (void)sxlatch_trywrlock_unmark( req->latch, req->session_id );
+        }
+        __sxlatch_async_complete( req, ret );
+        return true;
+    }
+
+    return false;
+}
+
+/* the granter is stopping: the queued requests are interrupted */
+static void __sxlatch_async_abort( sxlatch_async_t * pending )
+{
+    sxlatch_async_t * next = NULL;
+
+    for( ; pending != NULL; pending = next )
+    {
+        next = pending->next;
+
+        if( pending->mode != BF_LATCH_MODE_S )
+        {
+            (void)sxlatch_trywrlock_unmark( pending->latch, pending->session_id );
+        }
+        __sxlatch_async_complete( pending, RC_ERR_LOCK_INTERRUPTED );
+    }
+}
+
+static void * __sxlatch_async_main( void * arg )
+{
+    sxlatch_async_t * pending = NULL;
+    sxlatch_async_t * req = NULL;
+    sxlatch_async_t * next = NULL;
+    sxlatch_async_t ** link = NULL;
+    struct timespec deadline;
+    int32_t seq = 0;
+
+    (void)arg;
+
+    /* the latches are the sessions', not this thread's */
+    __sxlatch_hold_by_proxy = 1;
+
+    pthread_mutex_lock( &__sxlatch_async_mutex );
+
+    while( true )
+    {
+        /* take the new requests, after the older ones */
+        for( link = &pending; *link != NULL; link = &((*link)->next) )
+        {
+        }
+        *link = __sxlatch_async_incoming;
+        __sxlatch_async_incoming = NULL;
+
+        if( __sxlatch_async_stopping == true )
+        {
+            break;
+        }
+
+        if( pending == NULL )
+        {
+            pthread_cond_wait( &__sxlatch_async_cond, &__sxlatch_async_mutex );
+            continue;
+        }
+
+        /* read before the pass: a release after it moves the sequence */
+        seq = __sxlatch_async_release_seq;
+
+        pthread_mutex_unlock( &__sxlatch_async_mutex );
+
+        for( link = &pending; *link != NULL; )
+        {
+            req  = *link;
+            next = req->next;   /* req is the caller's once completed */
+
+            if( __sxlatch_async_try( req ) == true )
+            {
+                *link = next;
+            }
+            else
+            {
+                link = &(req->next);
+            }
+        }
+
+        pthread_mutex_lock( &__sxlatch_async_mutex );
+
+        if( pending != NULL &&
+            __sxlatch_async_incoming == NULL &&
+            __sxlatch_async_stopping == false &&
+            seq == __sxlatch_async_release_seq )
+        {
+            clock_gettime( CLOCK_MONOTONIC, &deadline );
+            deadline.tv_nsec += SXLATCH_ASYNC_BACKSTOP_MSEC * 1000000;
+            if( deadline.tv_nsec >= 1000000000 )
+            {
+                deadline.tv_sec++;
+                deadline.tv_nsec -= 1000000000;
+            }
+
+            pthread_cond_timedwait( &__sxlatch_async_cond,
+                                    &__sxlatch_async_mutex,
+                                    &deadline );
+        }
+    }
+
+    pthread_mutex_unlock( &__sxlatch_async_mutex );
+
+    __sxlatch_async_abort( pending );
+
+    return NULL;
+}
+
+static int __sxlatch_async_lock( sxlatch_t *       r,
+                                 session_id_t      session_id,
+                                 sxlatch_async_t * req,
+                                 int               mode )
+{
+    int ret = RC_FAIL;
+
+    TRY( r == NULL || req == NULL );
+    TRY( req->state == SXLATCH_ASYNC_PENDING );
+    /* their holds are kept by the thread, not by the session */
+    TRY( r->policy == SXLATCH_POLICY_BIASED ||
+         r->policy == SXLATCH_POLICY_ASYMMETRIC );
+
+    ret = ( mode == BF_LATCH_MODE_S ) ?
+          sxlatch_tryrdlock( r, session_id ) :
+          sxlatch_trywrlock_mark( r, session_id );
+
+    if( ret == RC_SUCCESS || ret == RC_ERR_LOCK_TIMEOUT || ret == RC_FAIL )
+    {
+        return ret;
+    }
+
+    req->latch      = r;
+    req->session_id = session_id;
+    req->mode       = mode;
+    req->status     = RC_SUCCESS;
+    req->cancelled  = 0;
+    req->state      = SXLATCH_ASYNC_PENDING;
+
+    pthread_once( &__sxlatch_async_once, __sxlatch_async_init_cond );
+    pthread_mutex_lock( &__sxlatch_async_mutex );
+
+    TRY_GOTO( __sxlatch_async_stopping == true, err_unlock );
+
+    if( __sxlatch_async_running == false )
+    {
+        TRY_GOTO( pthread_create( &__sxlatch_async_thread, NULL,
+                                  __sxlatch_async_main, NULL ) != 0,
+                  err_unlock );
+        __sxlatch_async_running = true;
+    }
+
+    atomic_fetch_inc( &__sxlatch_async_pending );
+    req->next = __sxlatch_async_incoming;
+    __sxlatch_async_incoming = req;
+    pthread_cond_signal( &__sxlatch_async_cond );
+
+    pthread_mutex_unlock( &__sxlatch_async_mutex );
+
+    return EINPROGRESS;
+
+    CATCH( err_unlock )
+    {
+        if( mode != BF_LATCH_MODE_S )
+        {
+            (void)sxlatch_trywrlock_unmark( r, session_id );
+        }
+        req->state = SXLATCH_ASYNC_IDLE;
+        pthread_mutex_unlock( &__sxlatch_async_mutex );
+        ret = RC_FAIL;
+    }
+    CATCH_END;
+
+    return ret;
+}
+
+int sxlatch_async_rdlock( sxlatch_t * r, session_id_t session_id, sxlatch_async_t * req )
+{
+    return __sxlatch_async_lock( r, session_id, req, BF_LATCH_MODE_S );
+}
+
+int sxlatch_async_wrlock( sxlatch_t * r, session_id_t session_id, sxlatch_async_t * req )
+{
+    return __sxlatch_async_lock( r, session_id, req, BF_LATCH_MODE_X_ACQUIRED );
+}
+
+int sxlatch_async_cancel( sxlatch_async_t * req )
+{
+    TRY( req == NULL || req->state != SXLATCH_ASYNC_PENDING );
+
+    req->cancelled = 1;
+    sxlatch_async_notify();
+
+    return RC_SUCCESS;
+
+    CATCH_END;
+
+    return RC_FAIL;
+}
+
+int sxlatch_async_status( const sxlatch_async_t * req )
+{
+    if( req->state == SXLATCH_ASYNC_PENDING )
+    {
+        return EINPROGRESS;
+    }
+
+    mem_barrier();
+
+    return req->status;
+}
+
+int sxlatch_async_shutdown( void )
+{
+    bool running = false;
+
+    pthread_mutex_lock( &__sxlatch_async_stop_mutex );
+    pthread_mutex_lock( &__sxlatch_async_mutex );
+
+    running = __sxlatch_async_running;
+    /* a completion function cannot wait for its own thread */
+    TRY_GOTO( running == true &&
+              pthread_equal( pthread_self(), __sxlatch_async_thread ) != 0,
+              err_self );
+
+    __sxlatch_async_stopping = true;
+    if( running == true )
+    {
+        pthread_cond_signal( &__sxlatch_async_cond );
+    }
+
+    pthread_mutex_unlock( &__sxlatch_async_mutex );
+
+    if( running == true )
+    {
+        (void)pthread_join( __sxlatch_async_thread, NULL );
+    }
+
+    pthread_mutex_lock( &__sxlatch_async_mutex );
+    __sxlatch_async_running  = false;
+    __sxlatch_async_stopping = false;
+    pthread_mutex_unlock( &__sxlatch_async_mutex );
+
+    pthread_mutex_unlock( &__sxlatch_async_stop_mutex );
+
+    return RC_SUCCESS;
+
+    CATCH( err_self )
+    {
+        pthread_mutex_unlock( &__sxlatch_async_mutex );
+        pthread_mutex_unlock( &__sxlatch_async_stop_mutex );
+    }
+    CATCH_END;
+
+    return RC_FAIL;
+}
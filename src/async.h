@@ -0,0 +1,93 @@
+#ifndef _ASYNC_H_
+#define _ASYNC_H_ 1
+
+#include <stdint.h>
+#include <errno.h>
+#include "util.h"
+#include "sxlatch.h"
+
+/* asynchronous acquisition(event loops, coroutines)
+ * sxlatch_async_rdlock()/sxlatch_async_wrlock() never wait: they take the
+ * latch at once as sxlatch_try*lock(), or queue the request and return
+ * EINPROGRESS. A background thread(the granter, started at the first
+ * queued request) retries the queued requests and completes each one
+ * exactly once:
+ *   status RC_SUCCESS:              the latch is held by the session
+ *   status RC_ERR_LOCK_INTERRUPTED: cancelled, or the session was
+ *                                   interrupted(sxlatch_interrupt_session)
+ *   status RC_ERR_LOCK_TIMEOUT:     the latch is being cleaned up
+ * On completion, func is called on the granter thread, then 1 is written
+ * to efd(an eventfd(2) or the write end of a pipe). The request and efd
+ * must stay valid until then; after that the granter never touches them.
+ * func must not block: every other queued request waits for it.
+ *
+ * The granter sleeps while nothing is released. The unlock paths, the
+ * session interrupts and the end of a cleanup wake it up while requests
+ * are queued; a release no one signals(a reader stepping back) is picked
+ * up within SXLATCH_ASYNC_BACKSTOP_MSEC. sxlatch_async_shutdown() stops
+ * the granter and waits for it to exit: the queued requests complete with
+ * RC_ERR_LOCK_INTERRUPTED, and requests made meanwhile fail(RC_FAIL). A
+ * later request starts a new granter.
+ *
+ * A queued writer marks X_BLOCKED for its session at once, as
+ * sxlatch_wrlock() does(sxlatch_trywrlock_mark()): new readers are not
+ * admitted, and the granter takes X once the readers have left. The mark
+ * is given back when the request is cancelled or interrupted.
+ * The granter takes the latch on its own thread: BIASED and ASYMMETRIC
+ * latches, whose holds are kept by the thread, are refused(RC_FAIL). */
+
+#define SXLATCH_ASYNC_IDLE        0
+#define SXLATCH_ASYNC_PENDING     1
+#define SXLATCH_ASYNC_DONE        2
+
+typedef struct _sxlatch_async sxlatch_async_t;
+
+typedef void (*sxlatch_async_func_t)( sxlatch_async_t * req, void * arg );
+
+struct _sxlatch_async
+{
+    sxlatch_t *           latch;
+    session_id_t          session_id;
+    int                   mode;        /* BF_LATCH_MODE_S or _X_ACQUIRED */
+    int                   efd;         /* -1: none */
+    sxlatch_async_func_t  func;        /* NULL: none */
+    void *                arg;
+    volatile int32_t      state;       /* SXLATCH_ASYNC_XXX */
+    volatile int32_t      status;
+    volatile int32_t      cancelled;
+    sxlatch_async_t *     next;        /* granter's queue */
+};
+
+int sxlatch_async_init( sxlatch_async_t *    req,
+                        int                  efd,
+                        sxlatch_async_func_t func,
+                        void *               arg );
+
+/* RC_SUCCESS: held now(no completion), EINPROGRESS: queued,
+ * otherwise the error of sxlatch_try*lock() */
+int sxlatch_async_rdlock( sxlatch_t * r, session_id_t session_id, sxlatch_async_t * req );
+int sxlatch_async_wrlock( sxlatch_t * r, session_id_t session_id, sxlatch_async_t * req );
+
+/* the request completes with RC_ERR_LOCK_INTERRUPTED unless it is granted
+ * first: check the status at completion */
+int sxlatch_async_cancel( sxlatch_async_t * req );
+
+/* EINPROGRESS while queued, then the status of the completion */
+int sxlatch_async_status( const sxlatch_async_t * req );
+
+/* RC_FAIL when called from the granter(func) */
+int sxlatch_async_shutdown( void );
+
+/* release paths: wake the granter while requests are queued */
+extern volatile int32_t __sxlatch_async_pending;
+void sxlatch_async_notify( void );
+
+#define SXLATCH_ASYNC_NOTIFY()                                        \
+  do {                                                                \
+    if( __builtin_expect( __sxlatch_async_pending != 0, 0 ) )         \
+    {                                                                 \
+      sxlatch_async_notify();                                         \
+    }                                                                 \
+  } while( 0 )
+
+#endif /* _ASYNC_H_ */
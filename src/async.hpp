@@ -0,0 +1,93 @@
+#ifndef _ASYNC_HPP_
+#define _ASYNC_HPP_ 1
+
+#include <coroutine>
+
+extern "C" {
+#include "async.h"
+}
+
+/* C++20 awaitable over the asynchronous acquisition(async.h)
+ *   int ret = co_await sxlatch_async_awaitable( &latch, sid, BF_LATCH_MODE_S );
+ * co_await returns RC_SUCCESS when the latch is held, or the status of the
+ * completion. A latch taken at once does not suspend.
+ * A queued request completes on the granter thread. With an executor
+ * (post), the awaitable hands the coroutine to post(handle, ctx) there,
+ * e.g. to queue it on the event loop; post must not block. Without one,
+ * the coroutine resumes on the granter thread itself and must not block
+ * until it has hopped off: the granter serves no other request meanwhile. */
+class sxlatch_async_awaitable
+{
+public:
+    typedef void (*post_func_t)( std::coroutine_handle<> handle, void * ctx );
+
+    sxlatch_async_awaitable( sxlatch_t *  r,
+                             session_id_t session_id,
+                             int          mode,
+                             post_func_t  post = nullptr,
+                             void *       post_ctx = nullptr )
+        : latch_( r ), session_id_( session_id ), mode_( mode ), ret_( RC_FAIL ),
+          post_( post ), post_ctx_( post_ctx )
+    {
+    }
+
+    bool await_ready() noexcept
+    {
+        return false;
+    }
+
+    bool await_suspend( std::coroutine_handle<> handle ) noexcept
+    {
+        int ret = RC_FAIL;
+
+        handle_ = handle;
+        ret_    = EINPROGRESS;
+        (void)sxlatch_async_init( &req_, -1, __resume, this );
+
+        ret = ( mode_ == BF_LATCH_MODE_S ) ?
+              sxlatch_async_rdlock( latch_, session_id_, &req_ ) :
+              sxlatch_async_wrlock( latch_, session_id_, &req_ );
+
+        /* queued: the coroutine may be running on the granter already,
+         * do not touch *this any more */
+        if( ret == EINPROGRESS )
+        {
+            return true;
+        }
+
+        ret_ = ret;
+        return false;
+    }
+
+    int await_resume() noexcept
+    {
+        return ( ret_ == EINPROGRESS ) ? sxlatch_async_status( &req_ ) : ret_;
+    }
+
+private:
+    static void __resume( sxlatch_async_t * req, void * arg )
+    {
+        sxlatch_async_awaitable * self = static_cast<sxlatch_async_awaitable *>( arg );
+
+        (void)req;
+        if( self->post_ != nullptr )
+        {
+            self->post_( self->handle_, self->post_ctx_ );
+        }
+        else
+        {
+            self->handle_.resume();
+        }
+    }
+
+    sxlatch_t *             latch_;
+    session_id_t            session_id_;
+    int                     mode_;
+    int                     ret_;
+    post_func_t             post_;
+    void *                  post_ctx_;
+    sxlatch_async_t         req_;
+    std::coroutine_handle<> handle_;
+};
+
+#endif /* _ASYNC_HPP_ */
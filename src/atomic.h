@@ -4,6 +4,9 @@
 #ifdef __GCC_HAVE_SYNC_COMPARE_AND_SWAP_8
 
 #define mem_barrier      __sync_synchronize
+#define compiler_barrier() __asm__ __volatile__( "" ::: "memory" )
+/* spin-wait hint: yields the core to the sibling hyperthread */
+#define cpu_relax()      __asm__ __volatile__( "pause" ::: "memory" )
 
 #define atomic_cas_32 __sync_val_compare_and_swap
 #define atomic_cas_64 __sync_val_compare_and_swap
@@ -12,6 +15,8 @@
 #define atomic_dec_fetch(_ptr) __sync_sub_and_fetch(_ptr, 1)
 #define atomic_fetch_inc(_ptr) __sync_fetch_and_add(_ptr, 1)
 #define atomic_fetch_dec(_ptr) __sync_fetch_and_sub(_ptr, 1)
+#define atomic_fetch_add(_ptr, _val) __sync_fetch_and_add(_ptr, _val)
+#define atomic_fetch_sub(_ptr, _val) __sync_fetch_and_sub(_ptr, _val)
 
 #else
 #define mem_barrier()  asm("mfence")
@@ -0,0 +1,209 @@
+#include <stdlib.h>
+#include <memory.h>
+#include <sched.h>
+#include <pthread.h>
+
+#include "combine.h"
+#include "atomic.h"
+#include "util.h"
+
+static __thread sxlatch_combine_rec_t * __sxlatch_combine_my_rec = NULL;
+
+/* all records ever created */
+static sxlatch_combine_rec_t * volatile __sxlatch_combine_all_recs = NULL;
+
+static pthread_once_t __sxlatch_combine_once = PTHREAD_ONCE_INIT;
+static pthread_key_t  __sxlatch_combine_key;
+
+static volatile uint64_t __sxlatch_combine_batches  = 0;
+static volatile uint64_t __sxlatch_combine_combined = 0;
+
+static void __sxlatch_combine_detach( void * arg )
+{
+    sxlatch_combine_rec_t * rec = (sxlatch_combine_rec_t *)arg;
+
+    mem_barrier();
+    rec->in_use = 0;
+}
+
+static void __sxlatch_combine_init_key( void )
+{
+    pthread_key_create( &__sxlatch_combine_key, __sxlatch_combine_detach );
+}
+
+static sxlatch_combine_rec_t * __sxlatch_combine_attach( void )
+{
+    sxlatch_combine_rec_t * rec = NULL;
+    sxlatch_combine_rec_t * oldhead = NULL;
+
+    pthread_once( &__sxlatch_combine_once, __sxlatch_combine_init_key );
+
+    /* reuse the record of an exited thread first */
+    for( rec = __sxlatch_combine_all_recs; rec != NULL; rec = rec->next )
+    {
+        if( rec->in_use == 0 &&
+            atomic_cas_32( &(rec->in_use), 0, 1 ) == 0 )
+        {
+            break;
+        }
+    }
+
+    if( rec == NULL )
+    {
+        TRY( posix_memalign( (void **)&rec, 64, sizeof(sxlatch_combine_rec_t) ) != 0 );
+        memset( rec, 0x00, sizeof(sxlatch_combine_rec_t) );
+        rec->in_use = 1;
+
+        do
+        {
+            oldhead   = __sxlatch_combine_all_recs;
+            rec->next = oldhead;
+        } while( atomic_cas_64( &__sxlatch_combine_all_recs, oldhead, rec ) != oldhead );
+    }
+
+    rec->state = SXLATCH_COMBINE_IDLE;
+
+    pthread_setspecific( __sxlatch_combine_key, rec );
+    __sxlatch_combine_my_rec = rec;
+
+    return rec;
+
+    CATCH_END;
+
+    return NULL;
+}
+
+/* X is held: run the closures published for the latch */
+static void __sxlatch_combine_serve( sxlatch_t * r )
+{
+    sxlatch_combine_rec_t * rec = NULL;
+    uint64_t combined = 0;
+    int pass = 0;
+    int cnt = 0;
+
+    for( pass = 0; pass < SXLATCH_COMBINE_PASSES; pass++ )
+    {
+        cnt = 0;
+
+        for( rec = __sxlatch_combine_all_recs; rec != NULL; rec = rec->next )
+        {
+            if( rec->latch == r &&
+                rec->state == SXLATCH_COMBINE_PENDING &&
+                atomic_cas_32( &(rec->state),
+                               SXLATCH_COMBINE_PENDING,
+                               SXLATCH_COMBINE_RUNNING ) == SXLATCH_COMBINE_PENDING )
+            {
+                rec->func( rec->arg );
+                mem_barrier();
+                rec->state = SXLATCH_COMBINE_DONE;
+                cnt++;
+            }
+        }
+
+        if( cnt == 0 )
+        {
+            break;
+        }
+        combined += cnt;
+    }
+
+    atomic_inc_fetch( &__sxlatch_combine_batches );
+    if( combined > 0 )
+    {
+        __sync_fetch_and_add( &__sxlatch_combine_combined, combined );
+    }
+}
+
+int sxlatch_combine( sxlatch_t *            r,
+                     session_id_t           session_id,
+                     sxlatch_combine_func_t func,
+                     void *                 arg )
+{
+    sxlatch_combine_rec_t * rec = __sxlatch_combine_my_rec;
+    int ret = RC_FAIL;
+
+    TRY( r == NULL || func == NULL );
+
+    if( rec == NULL )
+    {
+        rec = __sxlatch_combine_attach();
+        TRY( rec == NULL );
+    }
+
+    rec->latch = r;
+    rec->func  = func;
+    rec->arg   = arg;
+    mem_barrier();
+    rec->state = SXLATCH_COMBINE_PENDING;
+
+    while( true )
+    {
+        if( rec->state == SXLATCH_COMBINE_DONE )
+        {
+            /* a combiner ran it */
+            break;
+        }
+
+        if( SXLATCH_GET_VALUE( r ) != SXLATCH_UNLOCKED &&
+            r->cleanup_in_progress_cnt == 0 )
+        {
+            /* a combiner may pick our record up */
+            sched_yield();
+            continue;
+        }
+
+        ret = sxlatch_trywrlock( r, session_id );
+        if( ret == RC_SUCCESS )
+        {
+            /* no combiner can hold our record: it is pending or done */
+            if( atomic_cas_32( &(rec->state),
+                               SXLATCH_COMBINE_PENDING,
+                               SXLATCH_COMBINE_RUNNING ) == SXLATCH_COMBINE_PENDING )
+            {
+                func( arg );
+            }
+            /* the record is free again: the closures may combine too */
+            rec->state = SXLATCH_COMBINE_IDLE;
+
+            __sxlatch_combine_serve( r );
+
+            sxlatch_unlock( r, session_id );
+
+            return RC_SUCCESS;
+        }
+
+        if( ret == RC_ERR_LOCK_TIMEOUT )
+        {
+            /* cleanup: withdraw unless a combiner took it already */
+            if( atomic_cas_32( &(rec->state),
+                               SXLATCH_COMBINE_PENDING,
+                               SXLATCH_COMBINE_IDLE ) == SXLATCH_COMBINE_PENDING )
+            {
+                return ret;
+            }
+
+            while( rec->state != SXLATCH_COMBINE_DONE )
+            {
+                sched_yield();
+            }
+            break;
+        }
+
+        sched_yield();
+    }
+
+    mem_barrier();
+    rec->state = SXLATCH_COMBINE_IDLE;
+
+    return RC_SUCCESS;
+
+    CATCH_END;
+
+    return RC_FAIL;
+}
+
+void sxlatch_combine_get_stat( sxlatch_combine_stat_t * stat )
+{
+    stat->batches  = __sxlatch_combine_batches;
+    stat->combined = __sxlatch_combine_combined;
+}
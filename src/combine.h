@@ -0,0 +1,59 @@
+#ifndef _COMBINE_H_
+#define _COMBINE_H_ 1
+
+#include <stdint.h>
+#include "util.h"
+#include "sxlatch.h"
+
+/* delegation(flat combining) of short X sections
+ * sxlatch_combine() publishes func(arg) in a record of the calling thread
+ * and tries to take X. The thread which gets X becomes the combiner: it
+ * runs its own closure, then the closures published for the same latch
+ * by the other threads, in batches, and releases X. The others wait on
+ * their own record until it is done: the latch and the protected data
+ * stay in the cache of the combiner.
+ *
+ * A closure may run on another thread, under the session of the combiner:
+ * it must not rely on thread local state nor take the latch again. Its
+ * results go through arg, which is visible to the caller on return.
+ * Records are never freed: the record of an exited thread is handed over
+ * to a new thread. */
+
+#define SXLATCH_COMBINE_PASSES      4      /* batches per combiner at most */
+
+#define SXLATCH_COMBINE_IDLE        0
+#define SXLATCH_COMBINE_PENDING     1
+#define SXLATCH_COMBINE_RUNNING     2      /* claimed by a combiner */
+#define SXLATCH_COMBINE_DONE        3
+
+typedef void (*sxlatch_combine_func_t)( void * arg );
+
+typedef struct _sxlatch_combine_rec sxlatch_combine_rec_t;
+struct _sxlatch_combine_rec
+{
+    sxlatch_combine_rec_t *  next;
+    volatile int32_t         in_use;
+    volatile int32_t         state;      /* SXLATCH_COMBINE_XXX */
+    const sxlatch_t *        latch;
+    sxlatch_combine_func_t   func;
+    void *                   arg;
+} __attribute__((aligned(64)));
+
+/* run func(arg) under X of the latch. RC_SUCCESS once it ran, or the
+ * error of sxlatch_trywrlock()(cleanup) if it could not run. */
+int sxlatch_combine( sxlatch_t *            r,
+                     session_id_t           session_id,
+                     sxlatch_combine_func_t func,
+                     void *                 arg );
+
+/* statistics */
+typedef struct _sxlatch_combine_stat sxlatch_combine_stat_t;
+struct _sxlatch_combine_stat
+{
+    uint64_t  batches;     /* X sections of combiners */
+    uint64_t  combined;    /* closures run for other threads */
+};
+
+void sxlatch_combine_get_stat( sxlatch_combine_stat_t * stat );
+
+#endif /* _COMBINE_H_ */
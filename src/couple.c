@@ -0,0 +1,117 @@
+#include <memory.h>
+
+#include "couple.h"
+#include "util.h"
+
+/* release path[from, to) */
+static void __sxlatch_couple_release( sxlatch_couple_t * c, int from, int to )
+{
+    int idx = 0;
+
+    for( idx = from; idx < to; idx++ )
+    {
+        sxlatch_unlock( c->path[idx], c->session_id );
+        c->path[idx] = NULL;
+    }
+}
+
+int sxlatch_couple_begin( sxlatch_couple_t * c, session_id_t session_id, int strategy )
+{
+    TRY( c == NULL );
+    TRY( strategy < SXLATCH_COUPLE_READ || strategy > SXLATCH_COUPLE_PESSIMISTIC );
+
+    memset( c, 0x00, sizeof(sxlatch_couple_t) );
+    c->session_id = session_id;
+    c->strategy   = strategy;
+
+    return RC_SUCCESS;
+
+    CATCH_END;
+
+    return RC_FAIL;
+}
+
+int sxlatch_couple_step( sxlatch_couple_t * c, sxlatch_t * node, bool leaf )
+{
+    int ret = RC_FAIL;
+    bool exclusive = false;
+
+    TRY( c == NULL || node == NULL );
+    TRY_GOTO( c->depth == SXLATCH_COUPLE_DEPTH_MAX, err_release );
+
+    exclusive = ( c->strategy == SXLATCH_COUPLE_PESSIMISTIC ||
+                  ( c->strategy == SXLATCH_COUPLE_OPTIMISTIC && leaf == true ) ) ?
+                true : false;
+
+    ret = ( exclusive == true ) ?
+          sxlatch_wrlock( node, c->session_id ) :
+          sxlatch_rdlock( node, c->session_id );
+    TRY_GOTO( ret != RC_SUCCESS, err_release );
+
+    c->path[c->depth++] = node;
+
+    if( c->strategy != SXLATCH_COUPLE_PESSIMISTIC )
+    {
+        /* the child is latched: the parent may go */
+        __sxlatch_couple_release( c, 0, c->depth - 1 );
+        c->path[0] = node;
+        c->depth   = 1;
+    }
+
+    return RC_SUCCESS;
+
+    CATCH( err_release )
+    {
+        __sxlatch_couple_release( c, 0, c->depth );
+        c->depth = 0;
+        ret = ( ret == RC_SUCCESS ) ? RC_FAIL : ret;
+    }
+    CATCH_END;
+
+    return ret;
+}
+
+int sxlatch_couple_safe( sxlatch_couple_t * c )
+{
+    TRY( c == NULL || c->depth == 0 );
+
+    __sxlatch_couple_release( c, 0, c->depth - 1 );
+    c->path[0] = c->path[c->depth - 1];
+    c->depth   = 1;
+
+    return RC_SUCCESS;
+
+    CATCH_END;
+
+    return RC_FAIL;
+}
+
+int sxlatch_couple_restart( sxlatch_couple_t * c )
+{
+    TRY( c == NULL );
+
+    __sxlatch_couple_release( c, 0, c->depth );
+    c->depth    = 0;
+    c->strategy = SXLATCH_COUPLE_PESSIMISTIC;
+    c->restarts++;
+
+    return RC_SUCCESS;
+
+    CATCH_END;
+
+    return RC_FAIL;
+}
+
+int sxlatch_couple_end( sxlatch_couple_t * c )
+{
+    TRY( c == NULL );
+
+    __sxlatch_couple_release( c, 0, c->depth );
+    c->depth = 0;
+
+    return RC_SUCCESS;
+
+    CATCH_END;
+
+    return RC_FAIL;
+}
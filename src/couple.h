@@ -0,0 +1,55 @@
+#ifndef _COUPLE_H_
+#define _COUPLE_H_ 1
+
+#include <stdint.h>
+#include "util.h"
+#include "sxlatch.h"
+
+/* latch coupling(crabbing) for tree and list traversals
+ * The coupler keeps the latches of the path which are still needed. Each
+ * sxlatch_couple_step() latches the next node, then releases the
+ * ancestors which the strategy does not need any more:
+ *
+ * READ:        S on every node, the parent is released under the child.
+ * OPTIMISTIC:  as READ, but X on the leaf. If the leaf turns out unsafe
+ *              (it would split/merge) or the caller detects a conflict,
+ *              sxlatch_couple_restart() releases everything and the
+ *              descent restarts from the root as PESSIMISTIC.
+ * PESSIMISTIC: X on every node; the ancestors are kept until the caller
+ *              reports the current node safe(sxlatch_couple_safe()).
+ *
+ * X is taken with sxlatch_wrlock(): a descending writer blocks new readers
+ * of the node(X_BLOCKED) while the readers inside drain. On an error the
+ * coupler releases everything it holds. */
+
+#define SXLATCH_COUPLE_READ          0
+#define SXLATCH_COUPLE_OPTIMISTIC    1
+#define SXLATCH_COUPLE_PESSIMISTIC   2
+
+#define SXLATCH_COUPLE_DEPTH_MAX     32
+
+typedef struct _sxlatch_couple sxlatch_couple_t;
+struct _sxlatch_couple
+{
+    session_id_t  session_id;
+    int           strategy;      /* SXLATCH_COUPLE_XXX */
+    int           depth;         /* latches held */
+    int           restarts;
+    sxlatch_t *   path[SXLATCH_COUPLE_DEPTH_MAX];   /* root first */
+};
+
+int sxlatch_couple_begin( sxlatch_couple_t * c, session_id_t session_id, int strategy );
+
+/* latch the next node of the path(leaf: last node, OPTIMISTIC takes X) */
+int sxlatch_couple_step( sxlatch_couple_t * c, sxlatch_t * node, bool leaf );
+
+/* PESSIMISTIC: the current node is safe, release its ancestors */
+int sxlatch_couple_safe( sxlatch_couple_t * c );
+
+/* release everything and go on as PESSIMISTIC from the root */
+int sxlatch_couple_restart( sxlatch_couple_t * c );
+
+/* release everything */
+int sxlatch_couple_end( sxlatch_couple_t * c );
+
+#endif /* _COUPLE_H_ */
@@ -0,0 +1,159 @@
+#include <stdlib.h>
+#include <memory.h>
+
+#include "inflate.h"
+#include "atomic.h"
+#include "util.h"
+
+#define DEFAULT_SXLATCH_INFLATE_THRESHOLD   1024
+#define DEFAULT_SXLATCH_DEFLATE_MSEC        100
+#define DEFAULT_SXLATCH_DEFLATE_READS       1000
+
+int __sxlatch_inflate_threshold = DEFAULT_SXLATCH_INFLATE_THRESHOLD;
+int __sxlatch_deflate_msec      = DEFAULT_SXLATCH_DEFLATE_MSEC;
+int __sxlatch_deflate_reads     = DEFAULT_SXLATCH_DEFLATE_READS;
+
+/* index 0 is never used: policy_word 0 is "not inflated" */
+sxlatch_inflated_t * volatile __sxlatch_inflated_pool[SXLATCH_INFLATE_MAX];
+
+__thread int __sxlatch_inflate_my_shard = -1;
+
+static volatile int32_t  __sxlatch_inflate_next_shard = 0;
+static volatile uint64_t __sxlatch_inflations = 0;
+static volatile uint64_t __sxlatch_deflations = 0;
+static volatile int32_t  __sxlatch_inflated_cnt = 0;
+
+int sxlatch_inflated_assign_shard( void )
+{
+    __sxlatch_inflate_my_shard =
+        atomic_fetch_inc( &__sxlatch_inflate_next_shard ) % SXLATCH_INFLATE_SHARD_CNT;
+
+    return __sxlatch_inflate_my_shard;
+}
+
+int32_t sxlatch_inflated_alloc( const sxlatch_t * latch )
+{
+    sxlatch_inflated_t * p = NULL;
+    int32_t idx = 0;
+
+    for( idx = 1; idx < SXLATCH_INFLATE_MAX; idx++ )
+    {
+        p = __sxlatch_inflated_pool[idx];
+
+        if( p == NULL )
+        {
+            TRY( posix_memalign( (void **)&p, 64, sizeof(sxlatch_inflated_t) ) != 0 );
+            memset( p, 0x00, sizeof(sxlatch_inflated_t) );
+            p->latch = latch;
+
+            if( atomic_cas_64( &(__sxlatch_inflated_pool[idx]), NULL, p ) == NULL )
+            {
+                break;
+            }
+
+            /* another thread filled the entry: try to reuse it */
+            free( p );
+            p = __sxlatch_inflated_pool[idx];
+        }
+
+        if( p->latch == NULL &&
+            atomic_cas_64( &(p->latch), NULL, latch ) == NULL )
+        {
+            break;
+        }
+    }
+
+    TRY( idx == SXLATCH_INFLATE_MAX );
+
+    /* the shards of a handed over structure are drained already */
+    p->inflated_at = get_time();
+    p->epoch_begin = p->inflated_at;
+    p->epoch_reads = sxlatch_inflated_reads( p );
+
+    return idx;
+
+    CATCH_END;
+
+    return 0;
+}
+
+void sxlatch_inflated_free( int32_t idx )
+{
+    sxlatch_inflated_t * p = sxlatch_inflated_get( idx );
+
+    if( p != NULL )
+    {
+        mem_barrier();
+        p->latch = NULL;
+    }
+}
+
+int64_t sxlatch_inflated_readers( const sxlatch_inflated_t * p )
+{
+    int64_t readers = 0;
+    int idx = 0;
+
+    for( idx = 0; idx < SXLATCH_INFLATE_SHARD_CNT; idx++ )
+    {
+        readers += p->shards[idx].readers;
+    }
+
+    return readers;
+}
+
+uint64_t sxlatch_inflated_reads( const sxlatch_inflated_t * p )
+{
+    uint64_t reads = 0;
+    int idx = 0;
+
+    for( idx = 0; idx < SXLATCH_INFLATE_SHARD_CNT; idx++ )
+    {
+        reads += p->shards[idx].reads;
+    }
+
+    return reads;
+}
+
+void sxlatch_inflate_count( bool inflated )
+{
+    if( inflated == true )
+    {
+        atomic_inc_fetch( &__sxlatch_inflations );
+        atomic_inc_fetch( &__sxlatch_inflated_cnt );
+    }
+    else
+    {
+        atomic_inc_fetch( &__sxlatch_deflations );
+        atomic_dec_fetch( &__sxlatch_inflated_cnt );
+    }
+}
+
+void sxlatch_inflate_get_stat( sxlatch_inflate_stat_t * stat )
+{
+    stat->inflations   = __sxlatch_inflations;
+    stat->deflations   = __sxlatch_deflations;
+    stat->inflated_cnt = __sxlatch_inflated_cnt;
+}
+
+int sxlatch_inflated_get_latch_stat( const sxlatch_t *               r,
+                                     sxlatch_inflated_latch_stat_t * stat )
+{
+    sxlatch_inflated_t * p = NULL;
+
+    TRY( r == NULL || stat == NULL );
+    TRY( r->policy != SXLATCH_POLICY_INFLATED );
+
+    p = sxlatch_inflated_get( r->policy_word );
+    TRY( p == NULL || p->latch != r );
+
+    stat->reads         = sxlatch_inflated_reads( p );
+    stat->writes        = p->writes;
+    stat->parks         = p->parks;
+    stat->inflated_nsec = (uint64_t)get_elapsed_time( get_time() - p->inflated_at );
+
+    return RC_SUCCESS;
+
+    CATCH_END;
+
+    return RC_FAIL;
+}
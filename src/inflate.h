@@ -0,0 +1,112 @@
+#ifndef _INFLATE_H_
+#define _INFLATE_H_ 1
+
+#include <stdint.h>
+#include "util.h"
+#include "sxlatch.h"
+
+/* inflated latches
+ * A DEFAULT latch whose CAS on value keeps failing inflates: it takes a
+ * side structure from a global pool and keeps its index in policy_word.
+ * Readers of an inflated latch count themselves in a shard of the side
+ * structure(a cache line each) instead of value, and sleep in its waiter
+ * queue while a writer is in. A shard hold is kept by the session, not
+ * the thread. Writers still take X on value and wait for the shards to
+ * drain, as long as the readers hold S. The X holder deflates the
+ * latch when reads fell below __sxlatch_deflate_reads during
+ * __sxlatch_deflate_msec.
+ *
+ * Side structures are never freed: the one of a deflated latch is handed
+ * over to the next latch which inflates. */
+
+/* internal row of the policy table: never given by sxlatch_attr_t */
+#define SXLATCH_POLICY_INFLATED        SXLATCH_POLICY_MAX
+
+#define SXLATCH_INFLATE_MAX            1024   /* inflated latches at a time */
+#define SXLATCH_INFLATE_SHARD_CNT      16
+
+typedef struct _sxlatch_inflate_shard sxlatch_inflate_shard_t;
+struct _sxlatch_inflate_shard
+{
+    volatile int64_t   readers;   /* S holders counted in this shard */
+    volatile uint64_t  reads;
+} __attribute__((aligned(64)));
+
+typedef struct _sxlatch_inflated sxlatch_inflated_t;
+struct _sxlatch_inflated
+{
+    const sxlatch_t * volatile latch;   /* NULL: free */
+    volatile int32_t   wake_seq;        /* futex word of the waiter queue */
+    volatile int32_t   waiters;
+    uint64_t           inflated_at;     /* get_time() */
+    uint64_t           epoch_begin;     /* deflation window(X holder only) */
+    uint64_t           epoch_reads;
+    volatile uint64_t  writes;
+    volatile uint64_t  parks;
+    sxlatch_inflate_shard_t  shards[SXLATCH_INFLATE_SHARD_CNT];
+} __attribute__((aligned(64)));
+
+/* tunables */
+extern int __sxlatch_inflate_threshold;   /* CAS failures, 0: never inflate */
+extern int __sxlatch_deflate_msec;
+extern int __sxlatch_deflate_reads;
+
+extern sxlatch_inflated_t * volatile __sxlatch_inflated_pool[SXLATCH_INFLATE_MAX];
+extern __thread int __sxlatch_inflate_my_shard;
+
+/* index of a side structure bound to latch, 0 when the pool is full */
+int32_t sxlatch_inflated_alloc( const sxlatch_t * latch );
+void sxlatch_inflated_free( int32_t idx );
+
+/* the shard of the calling thread */
+int sxlatch_inflated_assign_shard( void );
+
+static inline sxlatch_inflated_t * sxlatch_inflated_get( int32_t idx )
+{
+    return ( idx > 0 && idx < SXLATCH_INFLATE_MAX ) ?
+           __sxlatch_inflated_pool[idx] : NULL;
+}
+
+static inline sxlatch_inflate_shard_t * sxlatch_inflated_my_shard( sxlatch_inflated_t * p )
+{
+    int shard = __sxlatch_inflate_my_shard;
+
+    if( __builtin_expect( shard < 0, 0 ) )
+    {
+        shard = sxlatch_inflated_assign_shard();
+    }
+
+    return &(p->shards[shard]);
+}
+
+int64_t sxlatch_inflated_readers( const sxlatch_inflated_t * p );
+uint64_t sxlatch_inflated_reads( const sxlatch_inflated_t * p );
+
+/* statistics */
+typedef struct _sxlatch_inflate_stat sxlatch_inflate_stat_t;
+struct _sxlatch_inflate_stat
+{
+    uint64_t  inflations;
+    uint64_t  deflations;
+    int32_t   inflated_cnt;    /* inflated now */
+};
+
+typedef struct _sxlatch_inflated_latch_stat sxlatch_inflated_latch_stat_t;
+struct _sxlatch_inflated_latch_stat
+{
+    uint64_t  reads;           /* S through the shards */
+    uint64_t  writes;          /* X released while inflated */
+    uint64_t  parks;           /* readers slept in the waiter queue */
+    uint64_t  inflated_nsec;
+};
+
+void sxlatch_inflate_get_stat( sxlatch_inflate_stat_t * stat );
+
+/* RC_FAIL if the latch is not inflated */
+int sxlatch_inflated_get_latch_stat( const sxlatch_t *               r,
+                                     sxlatch_inflated_latch_stat_t * stat );
+
+/* called by the latch functions */
+void sxlatch_inflate_count( bool inflated );
+
+#endif /* _INFLATE_H_ */
@@ -0,0 +1,308 @@
+#include <memory.h>
+#include <sched.h>
+
+#include "intent.h"
+#include "atomic.h"
+#include "util.h"
+
+extern int  __sxlatch_yield_loop_cnt;
+extern bool __latch_use_sleep;
+
+/* [held][requested] */
+static const bool __sxlatch_intent_matrix[SXLATCH_INTENT_MODE_MAX][SXLATCH_INTENT_MODE_MAX] = {
+    /*            IS     IX     S      SIX    X     */
+    /* IS  */  { true,  true,  true,  true,  false },
+    /* IX  */  { true,  true,  false, false, false },
+    /* S   */  { true,  false, true,  false, false },
+    /* SIX */  { true,  false, false, false, false },
+    /* X   */  { false, false, false, false, false }
+};
+
+static const int __sxlatch_intent_shift[SXLATCH_INTENT_MODE_MAX] = {
+    SXLATCH_INTENT_IS_SHIFT,
+    SXLATCH_INTENT_IX_SHIFT,
+    SXLATCH_INTENT_S_SHIFT,
+    0, /* SIX: a bit */
+    0  /* X: a bit */
+};
+
+bool sxlatch_intent_compatible( int held_mode, int req_mode )
+{
+    if( held_mode < 0 || held_mode >= SXLATCH_INTENT_MODE_MAX ||
+        req_mode < 0 || req_mode >= SXLATCH_INTENT_MODE_MAX )
+    {
+        return false;
+    }
+
+    return __sxlatch_intent_matrix[held_mode][req_mode];
+}
+
+/* may mode come in, whatever is held(X_BLOCKED aside) */
+static inline bool __sxlatch_intent_admit( int64_t value, int mode )
+{
+    int64_t held = value & ~SXLATCH_INTENT_BLOCKED_BIT;
+
+    if( held & SXLATCH_INTENT_X_BIT )
+    {
+        return false;
+    }
+
+    /* a full count would carry into the next field: wait for a release */
+    if( mode <= SXLATCH_INTENT_S &&
+        SXLATCH_INTENT_GET_CNT( held, __sxlatch_intent_shift[mode] ) ==
+        SXLATCH_INTENT_CNT_MASK )
+    {
+        return false;
+    }
+
+    switch( mode )
+    {
+        case SXLATCH_INTENT_IS:
+            return true;
+
+        case SXLATCH_INTENT_IX:
+            return ( (held & SXLATCH_INTENT_SIX_BIT) == 0 &&
+                     SXLATCH_INTENT_GET_CNT( held, SXLATCH_INTENT_S_SHIFT ) == 0 ) ?
+                   true : false;
+
+        case SXLATCH_INTENT_S:
+            return ( (held & SXLATCH_INTENT_SIX_BIT) == 0 &&
+                     SXLATCH_INTENT_GET_CNT( held, SXLATCH_INTENT_IX_SHIFT ) == 0 ) ?
+                   true : false;
+
+        case SXLATCH_INTENT_SIX:
+            return ( (held & SXLATCH_INTENT_SIX_BIT) == 0 &&
+                     SXLATCH_INTENT_GET_CNT( held, SXLATCH_INTENT_IX_SHIFT ) == 0 &&
+                     SXLATCH_INTENT_GET_CNT( held, SXLATCH_INTENT_S_SHIFT ) == 0 ) ?
+                   true : false;
+
+        case SXLATCH_INTENT_X:
+            return ( held == 0 ) ? true : false;
+
+        default:
+            break;
+    }
+
+    return false;
+}
+
+static inline int64_t __sxlatch_intent_add( int64_t value, int mode )
+{
+    switch( mode )
+    {
+        case SXLATCH_INTENT_SIX:
+            return value | SXLATCH_INTENT_SIX_BIT;
+
+        case SXLATCH_INTENT_X:
+            /* got X: the block is over */
+            return SXLATCH_INTENT_X_BIT;
+
+        default:
+            return value + ((int64_t)1 << __sxlatch_intent_shift[mode]);
+    }
+}
+
+/* one attempt: RC_SUCCESS, or RC_ERR_LOCK_BUSY */
+static int __sxlatch_intent_try( sxlatch_intent_t * r, int mode, bool * blocked )
+{
+    int64_t oldvalue = 0;
+
+    while( true )
+    {
+        oldvalue = r->value;
+
+        if( ( mode == SXLATCH_INTENT_X ||
+              (oldvalue & SXLATCH_INTENT_BLOCKED_BIT) == 0 ) &&
+            __sxlatch_intent_admit( oldvalue, mode ) == true )
+        {
+            if( oldvalue == atomic_cas_64( &(r->value),
+                                           oldvalue,
+                                           __sxlatch_intent_add( oldvalue, mode ) ) )
+            {
+                return RC_SUCCESS;
+            }
+            continue;
+        }
+
+        if( blocked != NULL && mode == SXLATCH_INTENT_X &&
+            (oldvalue & SXLATCH_INTENT_BLOCKED_BIT) == 0 )
+        {
+            /* stop new holders while the current ones drain */
+            if( oldvalue != atomic_cas_64( &(r->value),
+                                           oldvalue,
+                                           oldvalue | SXLATCH_INTENT_BLOCKED_BIT ) )
+            {
+                continue;
+            }
+            *blocked = true;
+        }
+
+        return RC_ERR_LOCK_BUSY;
+    }
+}
+
+int sxlatch_intent_init( sxlatch_intent_t * r )
+{
+    memset( r, 0x00, sizeof(sxlatch_intent_t) );
+    return RC_SUCCESS;
+}
+
+int sxlatch_intent_destroy( sxlatch_intent_t * r )
+{
+    memset( r, 0x00, sizeof(sxlatch_intent_t) );
+    return RC_SUCCESS;
+}
+
+int sxlatch_intent_lock( sxlatch_intent_t * r, int mode )
+{
+    int yield_cnt = __sxlatch_yield_loop_cnt;
+    bool blocked = false;
+
+    TRY( r == NULL || mode < 0 || mode >= SXLATCH_INTENT_MODE_MAX );
+
+    while( __sxlatch_intent_try( r, mode, &blocked ) != RC_SUCCESS )
+    {
+        if( yield_cnt-- > 0 )
+        {
+            sched_yield();
+        }
+        else
+        {
+            yield_cnt = __sxlatch_yield_loop_cnt;
+
+            if( __latch_use_sleep )
+            {
+                thread_sleep( 0, 1 );
+            }
+        }
+    }
+
+    return RC_SUCCESS;
+
+    CATCH_END;
+
+    return RC_FAIL;
+}
+
+int sxlatch_intent_trylock( sxlatch_intent_t * r, int mode )
+{
+    TRY( r == NULL || mode < 0 || mode >= SXLATCH_INTENT_MODE_MAX );
+
+    return __sxlatch_intent_try( r, mode, NULL );
+
+    CATCH_END;
+
+    return RC_FAIL;
+}
+
+int sxlatch_intent_unlock( sxlatch_intent_t * r, int mode )
+{
+    int64_t oldvalue = 0;
+    int64_t newvalue = 0;
+
+    TRY( r == NULL || mode < 0 || mode >= SXLATCH_INTENT_MODE_MAX );
+
+    while( true )
+    {
+        oldvalue = r->value;
+
+        switch( mode )
+        {
+            case SXLATCH_INTENT_SIX:
+                TRY( (oldvalue & SXLATCH_INTENT_SIX_BIT) == 0 );
+                newvalue = oldvalue & ~SXLATCH_INTENT_SIX_BIT;
+                break;
+
+            case SXLATCH_INTENT_X:
+                TRY( (oldvalue & SXLATCH_INTENT_X_BIT) == 0 );
+                newvalue = oldvalue & ~SXLATCH_INTENT_X_BIT;
+                break;
+
+            default:
+                TRY( SXLATCH_INTENT_GET_CNT( oldvalue, __sxlatch_intent_shift[mode] ) == 0 );
+                newvalue = oldvalue - ((int64_t)1 << __sxlatch_intent_shift[mode]);
+                break;
+        }
+
+        if( oldvalue == atomic_cas_64( &(r->value), oldvalue, newvalue ) )
+        {
+            break;
+        }
+    }
+
+    return RC_SUCCESS;
+
+    CATCH_END;
+
+    return RC_FAIL;
+}
+
+int sxlatch_intent_lock_path( sxlatch_intent_t * const * ancestors,
+                              int                        ancestor_cnt,
+                              sxlatch_t *                leaf,
+                              int                        leaf_mode,
+                              session_id_t               session_id )
+{
+    int intent = ( leaf_mode == BF_LATCH_MODE_S ) ?
+                 SXLATCH_INTENT_IS : SXLATCH_INTENT_IX;
+    int idx = 0;
+    int ret = RC_FAIL;
+
+    TRY( ancestor_cnt < 0 || ( ancestor_cnt > 0 && ancestors == NULL ) );
+    TRY( leaf_mode != BF_LATCH_MODE_S && leaf_mode != BF_LATCH_MODE_X_ACQUIRED );
+
+    for( idx = 0; idx < ancestor_cnt; idx++ )
+    {
+        TRY_GOTO( sxlatch_intent_lock( ancestors[idx], intent ) != RC_SUCCESS,
+                  err_release );
+    }
+
+    if( leaf != NULL )
+    {
+        ret = ( leaf_mode == BF_LATCH_MODE_S ) ?
+              sxlatch_rdlock( leaf, session_id ) :
+              sxlatch_wrlock( leaf, session_id );
+        TRY_GOTO( ret != RC_SUCCESS, err_release );
+    }
+
+    return RC_SUCCESS;
+
+    CATCH( err_release )
+    {
+        while( --idx >= 0 )
+        {
+            (void)sxlatch_intent_unlock( ancestors[idx], intent );
+        }
+        ret = ( ret == RC_SUCCESS ) ? RC_FAIL : ret;
+    }
+    CATCH_END;
+
+    return ret;
+}
+
+int sxlatch_intent_unlock_path( sxlatch_intent_t * const * ancestors,
+                                int                        ancestor_cnt,
+                                sxlatch_t *                leaf,
+                                int                        leaf_mode,
+                                session_id_t               session_id )
+{
+    int intent = ( leaf_mode == BF_LATCH_MODE_S ) ?
+                 SXLATCH_INTENT_IS : SXLATCH_INTENT_IX;
+    int ret = RC_SUCCESS;
+    int idx = 0;
+
+    if( leaf != NULL && sxlatch_unlock( leaf, session_id ) != RC_SUCCESS )
+    {
+        ret = RC_FAIL;
+    }
+
+    for( idx = ancestor_cnt - 1; idx >= 0; idx-- )
+    {
+        if( sxlatch_intent_unlock( ancestors[idx], intent ) != RC_SUCCESS )
+        {
+            ret = RC_FAIL;
+        }
+    }
+
+    return ret;
+}
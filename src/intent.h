@@ -0,0 +1,82 @@
+#ifndef _INTENT_H_
+#define _INTENT_H_ 1
+
+#include <stdint.h>
+#include "util.h"
+#include "sxlatch.h"
+
+/* multi-granularity(intent) latches
+ * A parent(table) carries an sxlatch_intent_t; its children(pages) keep
+ * plain sxlatch_t. Before S on a child, IS is taken on the ancestors;
+ * before X, IX. S/X on the parent cover every child at once, SIX is a
+ * scan which updates some children.
+ *
+ * compatibility:  IS  IX  S   SIX  X
+ *            IS   o   o   o   o    -
+ *            IX   o   o   -   -    -
+ *            S    o   -   o   -    -
+ *            SIX  o   -   -   -    -
+ *            X    -   -   -   -    -
+ *
+ * value syntax & semantic:
+ * |------|------|---------|-----|-----|----------|----------|----------|
+ * | 13   | 1    | 1       | 1   | 1   | 16 bits  | 16 bits  | 16 bits  |
+ * |------|------|---------|-----|-----|----------|----------|----------|
+ * | N/A  | N/A  | X_BLOCK | X   | SIX | S cnt    | IX cnt   | IS cnt   |
+ * |------|------|---------|-----|-----|----------|----------|----------|
+ * A waiting X marks X_BLOCKED as sxlatch_wrlock() does: no new holder
+ * comes in until it got X. At most SXLATCH_INTENT_CNT_MASK holders of a
+ * counted mode(IS, IX, S) at once: one more waits, or fails the try with
+ * RC_ERR_LOCK_BUSY. */
+
+#define SXLATCH_INTENT_IS          0
+#define SXLATCH_INTENT_IX          1
+#define SXLATCH_INTENT_S           2
+#define SXLATCH_INTENT_SIX         3
+#define SXLATCH_INTENT_X           4
+#define SXLATCH_INTENT_MODE_MAX    5
+
+#define SXLATCH_INTENT_CNT_BITS    16
+#define SXLATCH_INTENT_CNT_MASK    ((int64_t)0xFFFF)
+#define SXLATCH_INTENT_IS_SHIFT    0
+#define SXLATCH_INTENT_IX_SHIFT    16
+#define SXLATCH_INTENT_S_SHIFT     32
+#define SXLATCH_INTENT_SIX_BIT     ((int64_t)1 << 48)
+#define SXLATCH_INTENT_X_BIT       ((int64_t)1 << 49)
+#define SXLATCH_INTENT_BLOCKED_BIT ((int64_t)1 << 50)
+
+#define SXLATCH_INTENT_GET_CNT( i64v, shift )   \
+  ((((int64_t)(i64v)) >> (shift)) & SXLATCH_INTENT_CNT_MASK)
+
+typedef struct _sxlatch_intent sxlatch_intent_t;
+struct _sxlatch_intent
+{
+  volatile int64_t  value;
+};
+
+int sxlatch_intent_init( sxlatch_intent_t * r );
+int sxlatch_intent_destroy( sxlatch_intent_t * r );
+
+/* may a holder of held_mode and a requester of req_mode share the latch */
+bool sxlatch_intent_compatible( int held_mode, int req_mode );
+
+int sxlatch_intent_lock( sxlatch_intent_t * r, int mode );
+/* RC_ERR_LOCK_BUSY if it would wait */
+int sxlatch_intent_trylock( sxlatch_intent_t * r, int mode );
+int sxlatch_intent_unlock( sxlatch_intent_t * r, int mode );
+
+/* root to leaf: IS(leaf S) or IX(leaf X) on the ancestors from the root,
+ * then leaf_mode(BF_LATCH_MODE_S or _X_ACQUIRED) on the leaf. Nothing is
+ * held on an error. unlock_path releases from the leaf up. */
+int sxlatch_intent_lock_path( sxlatch_intent_t * const * ancestors,
+                              int                        ancestor_cnt,
+                              sxlatch_t *                leaf,
+                              int                        leaf_mode,
+                              session_id_t               session_id );
+int sxlatch_intent_unlock_path( sxlatch_intent_t * const * ancestors,
+                                int                        ancestor_cnt,
+                                sxlatch_t *                leaf,
+                                int                        leaf_mode,
+                                session_id_t               session_id );
+
+#endif /* _INTENT_H_ */
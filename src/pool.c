@@ -0,0 +1,232 @@
+#include <stdlib.h>
+#include <memory.h>
+
+#include "pool.h"
+#include "inflate.h"
+#include "util.h"
+
+#define SXLATCH_POOL_ELEM_BASE     sizeof(sxlatch_pool_chunk_t)
+
+static inline char * __sxlatch_pool_elem( sxlatch_pool_t *       pool,
+                                          sxlatch_pool_chunk_t * chunk,
+                                          uint32_t               idx )
+{
+    return (char *)chunk + SXLATCH_POOL_ELEM_BASE + (size_t)idx * pool->elem_size;
+}
+
+/* mutex held */
+static sxlatch_pool_chunk_t * __sxlatch_pool_grow( sxlatch_pool_t * pool )
+{
+    sxlatch_pool_chunk_t * chunk = NULL;
+    bool huge = false;
+    uint32_t cap = 0;
+    uint32_t idx = 0;
+
+    chunk = huge_page_alloc( SXLATCH_POOL_CHUNK_SIZE, pool->node, &huge );
+    TRY( chunk == NULL );
+
+    cap = (uint32_t)((SXLATCH_POOL_CHUNK_SIZE - SXLATCH_POOL_ELEM_BASE) /
+                     pool->elem_size);
+
+    if( pool->zero_latch == false )
+    {
+        /* the pages are zero already, only the latch image is written */
+        for( idx = 0; idx < cap; idx++ )
+        {
+            memcpy( __sxlatch_pool_elem( pool, chunk, idx ) + pool->latch_offset,
+                    &(pool->latch_image), sizeof(sxlatch_t) );
+        }
+    }
+
+    chunk->next = pool->chunks;
+    chunk->used = 0;
+    chunk->cap  = cap;
+    chunk->huge = huge;
+    chunk->node = ( pool->node >= 0 ) ? pool->node : numa_node_of_caller();
+
+    pool->chunks = chunk;
+    pool->chunk_cnt++;
+    if( huge == true )
+    {
+        pool->huge_chunk_cnt++;
+    }
+
+    return chunk;
+
+    CATCH_END;
+
+    return NULL;
+}
+
+/* mutex held */
+static void * __sxlatch_pool_get( sxlatch_pool_t * pool )
+{
+    sxlatch_pool_chunk_t * chunk = pool->chunks;
+    char * elem = NULL;
+
+    if( pool->free_list != NULL )
+    {
+        elem = pool->free_list;
+        pool->free_list = *(void **)elem;
+        memcpy( elem + pool->latch_offset, &(pool->latch_image), sizeof(sxlatch_t) );
+    }
+    else
+    {
+        if( chunk == NULL || chunk->used == chunk->cap )
+        {
+            chunk = __sxlatch_pool_grow( pool );
+            TRY( chunk == NULL );
+        }
+
+        elem = __sxlatch_pool_elem( pool, chunk, chunk->used++ );
+    }
+
+    pool->elem_cnt++;
+
+    return elem;
+
+    CATCH_END;
+
+    return NULL;
+}
+
+int sxlatch_pool_init( sxlatch_pool_t *       pool,
+                       size_t                 elem_size,
+                       size_t                 latch_offset,
+                       int                    node,
+                       const sxlatch_attr_t * attr )
+{
+    static const sxlatch_t zero_latch;
+
+    TRY( pool == NULL || elem_size < sizeof(void *) );
+    TRY( latch_offset % 8 != 0 || latch_offset + sizeof(sxlatch_t) > elem_size );
+
+    memset( pool, 0x00, sizeof(sxlatch_pool_t) );
+
+    pool->elem_size    = (elem_size + 7) & ~(size_t)7;
+    pool->latch_offset = latch_offset;
+    pool->node         = ( node >= 0 ) ? node : SXLATCH_POOL_NODE_LOCAL;
+
+    TRY( pool->elem_size > SXLATCH_POOL_CHUNK_SIZE - SXLATCH_POOL_ELEM_BASE );
+    TRY( sxlatch_init_attr( &(pool->latch_image), attr ) != RC_SUCCESS );
+
+    pool->zero_latch = ( memcmp( &(pool->latch_image), &zero_latch,
+                                 sizeof(sxlatch_t) ) == 0 ) ? true : false;
+
+    TRY( pthread_mutex_init( &(pool->mutex), NULL ) != 0 );
+
+    return RC_SUCCESS;
+
+    CATCH_END;
+
+    return RC_FAIL;
+}
+
+int sxlatch_pool_destroy( sxlatch_pool_t * pool )
+{
+    sxlatch_pool_chunk_t * chunk = NULL;
+    sxlatch_t * latch = NULL;
+    uint32_t idx = 0;
+
+    TRY( pool == NULL );
+
+    while( pool->chunks != NULL )
+    {
+        chunk = pool->chunks;
+        pool->chunks = chunk->next;
+
+        if( pool->latch_image.policy == SXLATCH_POLICY_DEFAULT )
+        {
+            /* only inflated latches own something outside the chunk */
+            for( idx = 0; idx < chunk->used; idx++ )
+            {
+                latch = (sxlatch_t *)(__sxlatch_pool_elem( pool, chunk, idx ) +
+                                      pool->latch_offset);
+                if( latch->policy == SXLATCH_POLICY_INFLATED )
+                {
+                    sxlatch_destroy( latch );
+                }
+            }
+        }
+
+        huge_page_free( chunk, SXLATCH_POOL_CHUNK_SIZE );
+    }
+
+    pthread_mutex_destroy( &(pool->mutex) );
+    memset( pool, 0x00, sizeof(sxlatch_pool_t) );
+
+    return RC_SUCCESS;
+
+    CATCH_END;
+
+    return RC_FAIL;
+}
+
+void * sxlatch_pool_alloc( sxlatch_pool_t * pool )
+{
+    void * elem = NULL;
+
+    pthread_mutex_lock( &(pool->mutex) );
+    elem = __sxlatch_pool_get( pool );
+    pthread_mutex_unlock( &(pool->mutex) );
+
+    return elem;
+}
+
+int sxlatch_pool_alloc_bulk( sxlatch_pool_t * pool, uint32_t cnt, void ** elems )
+{
+    uint32_t idx = 0;
+
+    TRY( pool == NULL || ( cnt > 0 && elems == NULL ) );
+
+    pthread_mutex_lock( &(pool->mutex) );
+
+    for( idx = 0; idx < cnt; idx++ )
+    {
+        elems[idx] = __sxlatch_pool_get( pool );
+        TRY_GOTO( elems[idx] == NULL, err_unwind );
+    }
+
+    pthread_mutex_unlock( &(pool->mutex) );
+
+    return RC_SUCCESS;
+
+    CATCH( err_unwind )
+    {
+        while( idx-- > 0 )
+        {
+            *(void **)elems[idx] = pool->free_list;
+            pool->free_list = elems[idx];
+            pool->elem_cnt--;
+        }
+        pthread_mutex_unlock( &(pool->mutex) );
+    }
+    CATCH_END;
+
+    return RC_FAIL;
+}
+
+void sxlatch_pool_free( sxlatch_pool_t * pool, void * elem )
+{
+    sxlatch_t * latch = sxlatch_pool_latch( pool, elem );
+
+    if( latch->policy == SXLATCH_POLICY_INFLATED )
+    {
+        sxlatch_destroy( latch );
+    }
+
+    pthread_mutex_lock( &(pool->mutex) );
+    *(void **)elem = pool->free_list;
+    pool->free_list = elem;
+    pool->elem_cnt--;
+    pthread_mutex_unlock( &(pool->mutex) );
+}
+
+void sxlatch_pool_get_stat( sxlatch_pool_t * pool, sxlatch_pool_stat_t * stat )
+{
+    pthread_mutex_lock( &(pool->mutex) );
+    stat->chunk_cnt      = pool->chunk_cnt;
+    stat->huge_chunk_cnt = pool->huge_chunk_cnt;
+    stat->elem_cnt       = pool->elem_cnt;
+    pthread_mutex_unlock( &(pool->mutex) );
+}
@@ -0,0 +1,81 @@
+#ifndef _POOL_H_
+#define _POOL_H_ 1
+
+#include <stdint.h>
+#include <pthread.h>
+#include "util.h"
+#include "sxlatch.h"
+
+/* latch pool
+ * Carves fixed-size elements(a bare sxlatch_t or a header which embeds
+ * one at latch_offset) out of 2MB chunks of huge pages(huge_page_alloc()),
+ * placed on a NUMA node: the given one, or SXLATCH_POOL_NODE_LOCAL for
+ * the node of the thread which makes the pool grow.
+ *
+ * New chunks come zeroed, which is an initialized DEFAULT latch; for
+ * other attributes the latch image is copied into the chunk as a whole.
+ * No sxlatch_init()/sxlatch_destroy() per element is needed: an element
+ * is handed out initialized, and sxlatch_pool_destroy() unmaps the
+ * chunks at once. Elements must not be held when they are freed. */
+
+#define SXLATCH_POOL_CHUNK_SIZE    HUGE_PAGE_SIZE
+#define SXLATCH_POOL_NODE_LOCAL    (-1)
+
+typedef struct _sxlatch_pool_chunk sxlatch_pool_chunk_t;
+struct _sxlatch_pool_chunk
+{
+    sxlatch_pool_chunk_t *  next;
+    uint32_t                used;    /* elements carved */
+    uint32_t                cap;
+    bool                    huge;    /* reserved huge pages */
+    int                     node;
+} __attribute__((aligned(64)));
+
+typedef struct _sxlatch_pool sxlatch_pool_t;
+struct _sxlatch_pool
+{
+    pthread_mutex_t         mutex;
+    size_t                  elem_size;      /* rounded up to 8 */
+    size_t                  latch_offset;
+    int                     node;           /* SXLATCH_POOL_NODE_LOCAL or a node */
+    bool                    zero_latch;     /* the latch image is all zero */
+    sxlatch_t               latch_image;
+    sxlatch_pool_chunk_t *  chunks;         /* the newest first */
+    void *                  free_list;      /* linked through the first word */
+    uint64_t                chunk_cnt;
+    uint64_t                huge_chunk_cnt;
+    uint64_t                elem_cnt;       /* handed out */
+};
+
+/* elem_size: sizeof the element(sizeof(sxlatch_t) for bare latches),
+ * latch_offset: offsetof the latch in it; attr: NULL for defaults */
+int sxlatch_pool_init( sxlatch_pool_t *       pool,
+                       size_t                 elem_size,
+                       size_t                 latch_offset,
+                       int                    node,
+                       const sxlatch_attr_t * attr );
+int sxlatch_pool_destroy( sxlatch_pool_t * pool );
+
+/* an element whose latch is initialized, NULL when out of memory */
+void * sxlatch_pool_alloc( sxlatch_pool_t * pool );
+/* cnt elements into elems[]; all or nothing */
+int sxlatch_pool_alloc_bulk( sxlatch_pool_t * pool, uint32_t cnt, void ** elems );
+void sxlatch_pool_free( sxlatch_pool_t * pool, void * elem );
+
+static inline sxlatch_t * sxlatch_pool_latch( const sxlatch_pool_t * pool, void * elem )
+{
+    return (sxlatch_t *)((char *)elem + pool->latch_offset);
+}
+
+/* statistics */
+typedef struct _sxlatch_pool_stat sxlatch_pool_stat_t;
+struct _sxlatch_pool_stat
+{
+    uint64_t  chunk_cnt;
+    uint64_t  huge_chunk_cnt;   /* from reserved huge pages */
+    uint64_t  elem_cnt;         /* handed out */
+};
+
+void sxlatch_pool_get_stat( sxlatch_pool_t * pool, sxlatch_pool_stat_t * stat );
+
+#endif /* _POOL_H_ */
@@ -0,0 +1,186 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <memory.h>
+#include <dlfcn.h>
+
+#include "profile.h"
+#include "sxlatch.h"
+#include "atomic.h"
+#include "util.h"
+
+#define SXLATCH_PROFILE_TABLE_MASK   (SXLATCH_PROFILE_TABLE_SIZE - 1)
+#define SXLATCH_PROFILE_PROBE_MAX    64
+
+volatile uint32_t __sxlatch_profile_period = 0;
+
+static sxlatch_profile_entry_t __sxlatch_profile_table[SXLATCH_PROFILE_TABLE_SIZE];
+static volatile uint64_t __sxlatch_profile_dropped = 0;
+
+/* contended acquisitions left until the next sample */
+static __thread uint32_t __sxlatch_profile_countdown = 0;
+
+int sxlatch_profile_enable( uint32_t sample_period )
+{
+    if( sample_period != 0 )
+    {
+        (void)get_elapsed_time( 0 );
+    }
+
+    mem_barrier();
+    __sxlatch_profile_period = sample_period;
+    mem_barrier();
+
+    return RC_SUCCESS;
+}
+
+/* CAUTION: samples recorded during the reset may be lost or survive */
+void sxlatch_profile_reset( void )
+{
+    memset( (void *)__sxlatch_profile_table, 0x00, sizeof(__sxlatch_profile_table) );
+    __sxlatch_profile_dropped = 0;
+    mem_barrier();
+}
+
+static inline uint64_t __sxlatch_profile_hash( uint64_t key )
+{
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    return key;
+}
+
+void sxlatch_profile_record( const void * caller, int mode, uint64_t wait_ticks )
+{
+    sxlatch_profile_entry_t * entry = NULL;
+    uint64_t key = 0;
+    uint64_t oldkey = 0;
+    uint64_t oldmax = 0;
+    uint64_t idx = 0;
+    int probe = 0;
+
+    if( __sxlatch_profile_countdown > 1 )
+    {
+        __sxlatch_profile_countdown--;
+        return;
+    }
+    __sxlatch_profile_countdown = __sxlatch_profile_period;
+
+    /* user space addresses are below 2^56: the mode goes to the top byte */
+    key = ((uint64_t)(uintptr_t)caller & 0x00FFFFFFFFFFFFFFULL) |
+          ((uint64_t)(mode + 1) << 56);
+    idx = __sxlatch_profile_hash( key );
+
+    for( probe = 0; probe < SXLATCH_PROFILE_PROBE_MAX; probe++, idx++ )
+    {
+        entry  = &(__sxlatch_profile_table[idx & SXLATCH_PROFILE_TABLE_MASK]);
+        oldkey = entry->key;
+
+        if( oldkey == 0 )
+        {
+            oldkey = atomic_cas_64( &(entry->key), 0, key );
+        }
+
+        if( oldkey == 0 || oldkey == key )
+        {
+            __sync_fetch_and_add( &(entry->samples), 1 );
+            __sync_fetch_and_add( &(entry->wait_ticks), wait_ticks );
+
+            do
+            {
+                oldmax = entry->max_ticks;
+            } while( oldmax < wait_ticks &&
+                     atomic_cas_64( &(entry->max_ticks), oldmax, wait_ticks ) != oldmax );
+
+            return;
+        }
+    }
+
+    atomic_inc_fetch( &__sxlatch_profile_dropped );
+}
+
+static int __sxlatch_profile_compare( const void * a, const void * b )
+{
+    const sxlatch_profile_entry_t * ea = (const sxlatch_profile_entry_t *)a;
+    const sxlatch_profile_entry_t * eb = (const sxlatch_profile_entry_t *)b;
+
+    if( ea->wait_ticks == eb->wait_ticks )
+    {
+        return 0;
+    }
+
+    return ( ea->wait_ticks < eb->wait_ticks ) ? 1 : -1;
+}
+
+int sxlatch_profile_dump( FILE * fp )
+{
+    sxlatch_profile_entry_t * entries = NULL;
+    Dl_info info;
+    void * caller = NULL;
+    int cnt = 0;
+    int idx = 0;
+
+    TRY( fp == NULL );
+
+    entries = malloc( sizeof(__sxlatch_profile_table) );
+    TRY( entries == NULL );
+
+    for( idx = 0; idx < SXLATCH_PROFILE_TABLE_SIZE; idx++ )
+    {
+        if( __sxlatch_profile_table[idx].key != 0 )
+        {
+            entries[cnt++] = __sxlatch_profile_table[idx];
+        }
+    }
+
+    qsort( entries, cnt, sizeof(sxlatch_profile_entry_t), __sxlatch_profile_compare );
+
+    fprintf( fp, "%-4s %10s %14s %12s %12s  %s\n",
+             "mode", "samples", "total(usec)", "avg(nsec)", "max(nsec)", "call site" );
+
+    for( idx = 0; idx < cnt; idx++ )
+    {
+        caller = (void *)(uintptr_t)(entries[idx].key & 0x00FFFFFFFFFFFFFFULL);
+
+        fprintf( fp, "%-4s %10llu %14.1f %12.0f %12.0f  ",
+                 ( (entries[idx].key >> 56) - 1 == BF_LATCH_MODE_S ) ? "S" : "X",
+                 (unsigned long long)entries[idx].samples,
+                 get_elapsed_time( entries[idx].wait_ticks ) / 1000.0,
+                 ( entries[idx].samples == 0 ) ? 0 :
+                 get_elapsed_time( entries[idx].wait_ticks / entries[idx].samples ),
+                 get_elapsed_time( entries[idx].max_ticks ) );
+
+        if( dladdr( caller, &info ) == 0 )
+        {
+            fprintf( fp, "%p\n", caller );
+        }
+        else if( info.dli_sname != NULL )
+        {
+            fprintf( fp, "%s+0x%lx (%s)\n",
+                     info.dli_sname,
+                     (unsigned long)((char *)caller - (char *)info.dli_saddr),
+                     info.dli_fname );
+        }
+        else
+        {
+            fprintf( fp, "%p (%s+0x%lx)\n",
+                     caller,
+                     info.dli_fname,
+                     (unsigned long)((char *)caller - (char *)info.dli_fbase) );
+        }
+    }
+
+    if( __sxlatch_profile_dropped > 0 )
+    {
+        fprintf( fp, "(%llu samples dropped: table full)\n",
+                 (unsigned long long)__sxlatch_profile_dropped );
+    }
+
+    free( entries );
+
+    return RC_SUCCESS;
+
+    CATCH_END;
+
+    return RC_FAIL;
+}
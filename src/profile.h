@@ -0,0 +1,36 @@
+#ifndef _PROFILE_H_
+#define _PROFILE_H_ 1
+
+#include <stdio.h>
+#include <stdint.h>
+#include "util.h"
+#include "sxlatch.h"
+
+/* call-site contention profiler
+ * One of every sample_period contended acquisitions in sxlatch_rdlock(),
+ * sxlatch_wrlock() and sxlatch_Xlock() records its caller address and the
+ * time spent waiting. Samples are aggregated per (caller, mode) in a lock
+ * free open addressing table and dumped symbolized with dladdr(). */
+
+#define SXLATCH_PROFILE_TABLE_SIZE   4096   /* power of 2 */
+
+typedef struct _sxlatch_profile_entry sxlatch_profile_entry_t;
+struct _sxlatch_profile_entry
+{
+    volatile uint64_t  key;          /* caller address | mode, 0: empty */
+    volatile uint64_t  samples;
+    volatile uint64_t  wait_ticks;
+    volatile uint64_t  max_ticks;
+};
+
+extern volatile uint32_t __sxlatch_profile_period;
+
+/* sample_period: 1 = every contended acquisition, 0 = disable */
+int sxlatch_profile_enable( uint32_t sample_period );
+void sxlatch_profile_reset( void );
+int sxlatch_profile_dump( FILE * fp );
+
+/* mode: BF_LATCH_MODE_S or BF_LATCH_MODE_X_ACQUIRED */
+void sxlatch_profile_record( const void * caller, int mode, uint64_t wait_ticks );
+
+#endif /* _PROFILE_H_ */
@@ -103,6 +103,20 @@ uint32_t RNG_generate( RNG * rng )
   return 1000;
 }
 
+__thread uint32_t __rng_thread_state = 0;
+
+uint32_t RNG_thread_seed( void )
+{
+  /* the address of the state tells the threads apart */
+  uint32_t seed = (uint32_t)generate_seed() ^
+                  ((uint32_t)(uintptr_t)&__rng_thread_state * 2654435761U);
+
+  /* xorshift never leaves 0 */
+  __rng_thread_state = ( seed != 0 ) ? seed : 27644437;
+
+  return __rng_thread_state;
+}
+
 void RNG_backoff( RNG * rng )
 {
   volatile uint64_t loops = (uint64_t)RNG_generate( rng );
@@ -25,4 +25,26 @@ unsigned long long rdtsc(void);
 int RNG_init( RNG * rng, uint32_t seed, uint32_t min, uint32_t max);
 uint32_t RNG_generate( RNG * rng );
 void RNG_backoff( RNG * rng );
+
+/* per-thread xorshift32: the state lives in the calling thread and is
+ * seeded once, at the first call. Nothing is shared between threads. */
+extern __thread uint32_t __rng_thread_state;
+uint32_t RNG_thread_seed( void );
+
+static inline uint32_t RNG_thread_generate( void )
+{
+  uint32_t x = __rng_thread_state;
+
+  if( __builtin_expect( x == 0, 0 ) )
+    {
+      x = RNG_thread_seed();
+    }
+
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  __rng_thread_state = x;
+
+  return x;
+}
 #endif /* _RAND_R_H_ */
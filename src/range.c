@@ -0,0 +1,266 @@
+#include <stdlib.h>
+#include <memory.h>
+
+#include "range.h"
+#include "util.h"
+
+#define SXLATCH_RANGE_WAIT    0
+#define SXLATCH_RANGE_TRY     1
+#define SXLATCH_RANGE_INT     2
+
+/* the slots of [lo, hi) in ascending order: at most two runs, [from, to] */
+static int __sxlatch_range_runs( sxlatch_range_t * r,
+                                 uint64_t          lo,
+                                 uint64_t          hi,
+                                 uint32_t          runs[2][2] )
+{
+    uint64_t first = lo / r->granule;
+    uint64_t last  = (hi - 1) / r->granule;
+    uint32_t from  = 0;
+    uint32_t to    = 0;
+
+    if( last - first + 1 >= r->slot_cnt )
+    {
+        runs[0][0] = 0;
+        runs[0][1] = r->slot_cnt - 1;
+        return 1;
+    }
+
+    from = (uint32_t)(first % r->slot_cnt);
+    to   = (uint32_t)(last % r->slot_cnt);
+
+    if( from <= to )
+    {
+        runs[0][0] = from;
+        runs[0][1] = to;
+        return 1;
+    }
+
+    /* wraps around: the low slots first */
+    runs[0][0] = 0;
+    runs[0][1] = to;
+    runs[1][0] = from;
+    runs[1][1] = r->slot_cnt - 1;
+    return 2;
+}
+
+static inline int __sxlatch_range_lock_slot( sxlatch_t *  latch,
+                                             session_id_t session_id,
+                                             int          mode,
+                                             int          how )
+{
+    if( mode == BF_LATCH_MODE_S )
+    {
+        switch( how )
+        {
+            case SXLATCH_RANGE_TRY: return sxlatch_tryrdlock( latch, session_id );
+            case SXLATCH_RANGE_INT: return sxlatch_intrdlock( latch, session_id );
+            default:                return sxlatch_rdlock( latch, session_id );
+        }
+    }
+
+    switch( how )
+    {
+        case SXLATCH_RANGE_TRY: return sxlatch_trywrlock( latch, session_id );
+        case SXLATCH_RANGE_INT: return sxlatch_intwrlock( latch, session_id );
+        default:                return sxlatch_wrlock( latch, session_id );
+    }
+}
+
+/* the session holds X on the slot already(another range aliased on it):
+ * waiting for the slot would wait for itself */
+static inline bool __sxlatch_range_self_held( sxlatch_t * latch, session_id_t session_id )
+{
+    int64_t value = SXLATCH_GET_VALUE( latch );
+
+    return ( SXLATCH_GET_MODE( value ) != SXLATCH_MODE_S &&
+             session_id == (int)SXLATCH_GET_SESSION_ID( value ) ) ? true : false;
+}
+
+static int __sxlatch_range_lock( sxlatch_range_t * r,
+                                 uint64_t          lo,
+                                 uint64_t          hi,
+                                 session_id_t      session_id,
+                                 int               mode,
+                                 int               how )
+{
+    uint32_t runs[2][2];
+    int run_cnt = 0;
+    int run = 0;
+    int64_t idx = 0;
+    int ret = RC_FAIL;
+
+    TRY( r == NULL || r->slots == NULL || hi <= lo );
+
+    run_cnt = __sxlatch_range_runs( r, lo, hi, runs );
+
+    for( run = 0; run < run_cnt; run++ )
+    {
+        for( idx = runs[run][0]; idx <= runs[run][1]; idx++ )
+        {
+            ret = RC_FAIL;
+            TRY_GOTO( __sxlatch_range_self_held( &(r->slots[idx].latch), session_id ),
+                      err_release );
+
+            ret = __sxlatch_range_lock_slot( &(r->slots[idx].latch),
+                                             session_id, mode, how );
+            TRY_GOTO( ret != RC_SUCCESS, err_release );
+        }
+    }
+
+    return RC_SUCCESS;
+
+    CATCH( err_release )
+    {
+        /* give back what was taken, newest first */
+        for( ; run >= 0; run-- )
+        {
+            while( --idx >= (int64_t)runs[run][0] )
+            {
+                sxlatch_unlock( &(r->slots[idx].latch), session_id );
+            }
+
+            if( run > 0 )
+            {
+                idx = (int64_t)runs[run - 1][1] + 1;
+            }
+        }
+    }
+    CATCH_END;
+
+    return ret;
+}
+
+int sxlatch_range_init( sxlatch_range_t *      r,
+                        uint32_t               slot_cnt,
+                        uint64_t               granule,
+                        const sxlatch_attr_t * attr )
+{
+    sxlatch_attr_t def_attr;
+    uint32_t idx = 0;
+
+    TRY( r == NULL || slot_cnt == 0 || granule == 0 );
+
+    if( attr == NULL )
+    {
+        (void)sxlatch_attr_init( &def_attr );
+        attr = &def_attr;
+    }
+
+    memset( r, 0x00, sizeof(sxlatch_range_t) );
+
+    TRY( posix_memalign( (void **)&(r->slots), 64,
+                         sizeof(sxlatch_range_slot_t) * slot_cnt ) != 0 );
+    memset( r->slots, 0x00, sizeof(sxlatch_range_slot_t) * slot_cnt );
+
+    for( idx = 0; idx < slot_cnt; idx++ )
+    {
+        TRY_GOTO( sxlatch_init_attr( &(r->slots[idx].latch), attr ) != RC_SUCCESS,
+                  err_free );
+    }
+
+    r->granule  = granule;
+    r->slot_cnt = slot_cnt;
+
+    return RC_SUCCESS;
+
+    CATCH( err_free )
+    {
+        free( r->slots );
+        r->slots = NULL;
+    }
+    CATCH_END;
+
+    return RC_FAIL;
+}
+
+int sxlatch_range_destroy( sxlatch_range_t * r )
+{
+    TRY( r == NULL || r->slots == NULL );
+
+    (void)sxlatch_destroy_bulk( &(r->slots[0].latch), r->slot_cnt,
+                                sizeof(sxlatch_range_slot_t),
+                                SXLATCH_DESTROY_TIMEOUT_MSEC );
+
+    free( r->slots );
+    memset( r, 0x00, sizeof(sxlatch_range_t) );
+
+    return RC_SUCCESS;
+
+    CATCH_END;
+
+    return RC_FAIL;
+}
+
+int sxlatch_range_rdlock( sxlatch_range_t * r, uint64_t lo, uint64_t hi,
+                          session_id_t session_id )
+{
+    return __sxlatch_range_lock( r, lo, hi, session_id,
+                                 BF_LATCH_MODE_S, SXLATCH_RANGE_WAIT );
+}
+
+int sxlatch_range_wrlock( sxlatch_range_t * r, uint64_t lo, uint64_t hi,
+                          session_id_t session_id )
+{
+    return __sxlatch_range_lock( r, lo, hi, session_id,
+                                 BF_LATCH_MODE_X_ACQUIRED, SXLATCH_RANGE_WAIT );
+}
+
+int sxlatch_range_tryrdlock( sxlatch_range_t * r, uint64_t lo, uint64_t hi,
+                             session_id_t session_id )
+{
+    return __sxlatch_range_lock( r, lo, hi, session_id,
+                                 BF_LATCH_MODE_S, SXLATCH_RANGE_TRY );
+}
+
+int sxlatch_range_trywrlock( sxlatch_range_t * r, uint64_t lo, uint64_t hi,
+                             session_id_t session_id )
+{
+    return __sxlatch_range_lock( r, lo, hi, session_id,
+                                 BF_LATCH_MODE_X_ACQUIRED, SXLATCH_RANGE_TRY );
+}
+
+int sxlatch_range_intrdlock( sxlatch_range_t * r, uint64_t lo, uint64_t hi,
+                             session_id_t session_id )
+{
+    return __sxlatch_range_lock( r, lo, hi, session_id,
+                                 BF_LATCH_MODE_S, SXLATCH_RANGE_INT );
+}
+
+int sxlatch_range_intwrlock( sxlatch_range_t * r, uint64_t lo, uint64_t hi,
+                             session_id_t session_id )
+{
+    return __sxlatch_range_lock( r, lo, hi, session_id,
+                                 BF_LATCH_MODE_X_ACQUIRED, SXLATCH_RANGE_INT );
+}
+
+int sxlatch_range_unlock( sxlatch_range_t * r, uint64_t lo, uint64_t hi,
+                          session_id_t session_id )
+{
+    uint32_t runs[2][2];
+    int run_cnt = 0;
+    int run = 0;
+    int64_t idx = 0;
+    int ret = RC_SUCCESS;
+
+    TRY( r == NULL || r->slots == NULL || hi <= lo );
+
+    run_cnt = __sxlatch_range_runs( r, lo, hi, runs );
+
+    for( run = run_cnt - 1; run >= 0; run-- )
+    {
+        for( idx = runs[run][1]; idx >= (int64_t)runs[run][0]; idx-- )
+        {
+            if( sxlatch_unlock( &(r->slots[idx].latch), session_id ) != RC_SUCCESS )
+            {
+                ret = RC_FAIL;
+            }
+        }
+    }
+
+    return ret;
+
+    CATCH_END;
+
+    return RC_FAIL;
+}
@@ -0,0 +1,68 @@
+#ifndef _RANGE_H_
+#define _RANGE_H_ 1
+
+#include <stdint.h>
+#include "util.h"
+#include "sxlatch.h"
+
+/* striped latch over a 64-bit key space(pages, keys)
+ * This is not an interval lock: no interval is kept or compared. The
+ * space is cut into granules of `granule` keys, and granule g is covered
+ * by the cache-aligned slot latch g % slot_cnt(the stripes). S or X on
+ * [lo, hi) takes the slots of the granules it touches, with the sxlatch_t
+ * protocol in ascending slot order, so overlapping requests never
+ * deadlock and a bulk operation takes at most slot_cnt latches however
+ * long it is.
+ *
+ * Ranges which share no slot never touch a common cache line. Exclusion is
+ * per slot, so conflicts are coarse: two ranges in one granule, or in
+ * granules aliased on a slot(g % slot_cnt), conflict even if they do not
+ * overlap, also within one session. Size granule and slot_cnt so that
+ * the false conflicts are rare for the workload.
+ *
+ * A request on a slot the session holds in X fails(RC_FAIL). A holder of
+ * S is not known by session, so while a session holds a range, it must
+ * not wait(rdlock, wrlock, int*lock) for another range sharing a slot
+ * with it: X would wait for its own S, and S would wait behind a writer
+ * blocked by its own S. Use the try functions then. */
+
+typedef struct _sxlatch_range_slot sxlatch_range_slot_t;
+struct _sxlatch_range_slot
+{
+    sxlatch_t  latch;
+} __attribute__((aligned(64)));
+
+typedef struct _sxlatch_range sxlatch_range_t;
+struct _sxlatch_range
+{
+    uint64_t                granule;     /* keys per granule */
+    uint32_t                slot_cnt;
+    sxlatch_range_slot_t *  slots;
+};
+
+/* attr: NULL for defaults */
+int sxlatch_range_init( sxlatch_range_t *      r,
+                        uint32_t               slot_cnt,
+                        uint64_t               granule,
+                        const sxlatch_attr_t * attr );
+int sxlatch_range_destroy( sxlatch_range_t * r );
+
+int sxlatch_range_rdlock( sxlatch_range_t * r, uint64_t lo, uint64_t hi,
+                          session_id_t session_id );
+int sxlatch_range_wrlock( sxlatch_range_t * r, uint64_t lo, uint64_t hi,
+                          session_id_t session_id );
+/* fail as sxlatch_try*lock() if a slot is held */
+int sxlatch_range_tryrdlock( sxlatch_range_t * r, uint64_t lo, uint64_t hi,
+                             session_id_t session_id );
+int sxlatch_range_trywrlock( sxlatch_range_t * r, uint64_t lo, uint64_t hi,
+                             session_id_t session_id );
+/* as sxlatch_int*lock(): RC_ERR_LOCK_INTERRUPTED or RC_ERR_LOCK_TIMEOUT.
+ * Nothing of the range is held on an error. */
+int sxlatch_range_intrdlock( sxlatch_range_t * r, uint64_t lo, uint64_t hi,
+                             session_id_t session_id );
+int sxlatch_range_intwrlock( sxlatch_range_t * r, uint64_t lo, uint64_t hi,
+                             session_id_t session_id );
+int sxlatch_range_unlock( sxlatch_range_t * r, uint64_t lo, uint64_t hi,
+                          session_id_t session_id );
+
+#endif /* _RANGE_H_ */
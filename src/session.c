@@ -0,0 +1,463 @@
+#include <stdlib.h>
+#include <memory.h>
+#include <sched.h>
+
+#include "sxlatch.h"
+#include "session.h"
+#include "util.h"
+#include "atomic.h"
+#include "async.h"
+
+#define SXLATCH_SESSION_DIR_SIZE  \
+    ((SXLATCH_MAX_SESSION_ID >> SXLATCH_SESSION_CHUNK_BITS) + 1)
+
+static sxlatch_session_t * volatile __sxlatch_session_dir[SXLATCH_SESSION_DIR_SIZE];
+
+/* the last session looked up by this thread.
+ * In most cases a thread works for only one session. */
+static __thread session_id_t        __sxlatch_cached_session_id = -1;
+static __thread sxlatch_session_t * __sxlatch_cached_session    = NULL;
+
+static sxlatch_session_t * __sxlatch_session_alloc_chunk( int dir_idx )
+{
+    sxlatch_session_t * chunk = NULL;
+    sxlatch_session_t * oldchunk = NULL;
+
+    TRY( posix_memalign( (void **)&chunk,
+                         sizeof(sxlatch_session_t),
+                         sizeof(sxlatch_session_t) * SXLATCH_SESSION_CHUNK_SIZE ) != 0 );
+    memset( chunk, 0x00, sizeof(sxlatch_session_t) * SXLATCH_SESSION_CHUNK_SIZE );
+
+    oldchunk = atomic_cas_64( &(__sxlatch_session_dir[dir_idx]), NULL, chunk );
+    if( oldchunk != NULL )
+    {
+        /* other thread has installed the chunk already */
+        free( chunk );
+        chunk = oldchunk;
+    }
+
+    return chunk;
+
+    CATCH_END;
+
+    return NULL;
+}
+
+sxlatch_session_t * sxlatch_session_get( session_id_t session_id )
+{
+    sxlatch_session_t * chunk = NULL;
+    int dir_idx = 0;
+
+    if( session_id == __sxlatch_cached_session_id )
+    {
+        return __sxlatch_cached_session;
+    }
+
+    TRY( session_id < 0 || session_id > SXLATCH_MAX_SESSION_ID );
+
+    dir_idx = session_id >> SXLATCH_SESSION_CHUNK_BITS;
+    chunk = __sxlatch_session_dir[dir_idx];
+    if( chunk == NULL )
+    {
+        chunk = __sxlatch_session_alloc_chunk( dir_idx );
+        TRY( chunk == NULL );
+    }
+
+    __sxlatch_cached_session_id = session_id;
+    __sxlatch_cached_session    = &(chunk[session_id & SXLATCH_SESSION_CHUNK_MASK]);
+
+    return __sxlatch_cached_session;
+
+    CATCH_END;
+
+    return NULL;
+}
+
+sxlatch_session_t * sxlatch_session_find( session_id_t session_id )
+{
+    sxlatch_session_t * chunk = NULL;
+
+    TRY( session_id < 0 || session_id > SXLATCH_MAX_SESSION_ID );
+
+    chunk = __sxlatch_session_dir[session_id >> SXLATCH_SESSION_CHUNK_BITS];
+    TRY( chunk == NULL );
+
+    return &(chunk[session_id & SXLATCH_SESSION_CHUNK_MASK]);
+
+    CATCH_END;
+
+    return NULL;
+}
+
+int sxlatch_session_interrupt( session_id_t session_id )
+{
+    sxlatch_session_t * sess = sxlatch_session_get( session_id );
+
+    TRY( sess == NULL );
+
+    sess->interrupted = SXLATCH_SESSION_INTERRUPT;
+    mem_barrier();
+
+    /* wake up the session if it is sleeping in a latch backoff */
+    if( sess->sleeping_cnt > 0 )
+    {
+        futex_wake( &(sess->interrupted), 0 /* all */ );
+    }
+    /* and its queued asynchronous requests */
+    SXLATCH_ASYNC_NOTIFY();
+
+    return RC_SUCCESS;
+
+    CATCH_END;
+
+    return RC_FAIL;
+}
+
+int sxlatch_session_clear_interrupt( session_id_t session_id )
+{
+    sxlatch_session_t * sess = sxlatch_session_get( session_id );
+
+    TRY( sess == NULL );
+
+    sess->interrupted = 0;
+    mem_barrier();
+
+    return RC_SUCCESS;
+
+    CATCH_END;
+
+    return RC_FAIL;
+}
+
+bool sxlatch_session_is_interrupted( sxlatch_session_t * sess )
+{
+    return ( sess != NULL && sess->interrupted != 0 ) ? true : false;
+}
+
+int sxlatch_session_interrupt_once( session_id_t session_id )
+{
+    sxlatch_session_t * sess = sxlatch_session_get( session_id );
+
+    TRY( sess == NULL );
+
+    (void)atomic_cas_32( &(sess->interrupted), 0, SXLATCH_SESSION_INTERRUPT_ONCE );
+    mem_barrier();
+
+    if( sess->sleeping_cnt > 0 )
+    {
+        futex_wake( &(sess->interrupted), 0 /* all */ );
+    }
+    /* and its queued asynchronous requests */
+    SXLATCH_ASYNC_NOTIFY();
+
+    return RC_SUCCESS;
+
+    CATCH_END;
+
+    return RC_FAIL;
+}
+
+bool sxlatch_session_take_interrupt( sxlatch_session_t * sess )
+{
+    if( sess == NULL || sess->interrupted == 0 )
+    {
+        return false;
+    }
+
+    if( sess->interrupted == SXLATCH_SESSION_INTERRUPT_ONCE )
+    {
+        /* lost the race: cleared, or it stays from now on */
+        (void)atomic_cas_32( &(sess->interrupted), SXLATCH_SESSION_INTERRUPT_ONCE, 0 );
+    }
+
+    return true;
+}
+
+void sxlatch_session_drop_interrupt_once( sxlatch_session_t * sess )
+{
+    if( sess != NULL && sess->interrupted == SXLATCH_SESSION_INTERRUPT_ONCE )
+    {
+        (void)atomic_cas_32( &(sess->interrupted), SXLATCH_SESSION_INTERRUPT_ONCE, 0 );
+    }
+}
+
+static inline void __sxlatch_session_off_cpu( sxlatch_session_t * sess )
+{
+    atomic_inc_fetch( &(sess->off_cpu) );
+}
+
+static inline void __sxlatch_session_on_cpu( sxlatch_session_t * sess )
+{
+    if( atomic_dec_fetch( &(sess->off_cpu) ) == 0 &&
+        sess->off_cpu_waiters > 0 )
+    {
+        futex_wake( &(sess->off_cpu), 0 /* all */ );
+    }
+}
+
+int sxlatch_session_sleep( sxlatch_session_t * sess, uint64_t usec )
+{
+    int ret = 0;
+
+    if( sess == NULL )
+    {
+        return thread_sleep( 0, usec );
+    }
+
+    atomic_inc_fetch( &(sess->sleeping_cnt) );
+    __sxlatch_session_off_cpu( sess );
+
+    /* returns immediately if the session has been interrupted already */
+    ret = futex_wait( &(sess->interrupted), 0, usec );
+
+    __sxlatch_session_on_cpu( sess );
+    atomic_dec_fetch( &(sess->sleeping_cnt) );
+
+    return ret;
+}
+
+int sxlatch_session_set_off_cpu( session_id_t session_id, bool off_cpu )
+{
+    sxlatch_session_t * sess = sxlatch_session_get( session_id );
+
+    TRY( sess == NULL );
+
+    if( off_cpu == true )
+    {
+        __sxlatch_session_off_cpu( sess );
+    }
+    else
+    {
+        TRY( sess->off_cpu <= 0 );
+        __sxlatch_session_on_cpu( sess );
+    }
+
+    return RC_SUCCESS;
+
+    CATCH_END;
+
+    return RC_FAIL;
+}
+
+int sxlatch_session_wait_on_cpu( sxlatch_session_t * sess, uint64_t usec )
+{
+    int32_t off_cpu = sess->off_cpu;
+
+    if( off_cpu <= 0 )
+    {
+        return RC_SUCCESS;
+    }
+
+    atomic_inc_fetch( &(sess->off_cpu_waiters) );
+
+    /* returns immediately if off_cpu has changed already */
+    (void)futex_wait( &(sess->off_cpu), off_cpu, usec );
+
+    atomic_dec_fetch( &(sess->off_cpu_waiters) );
+
+    return RC_SUCCESS;
+}
+
+void sxlatch_session_foreach( sxlatch_session_visitor visitor, void * arg )
+{
+    sxlatch_session_t * chunk = NULL;
+    int dir_idx = 0;
+    int idx     = 0;
+
+    for( dir_idx = 0; dir_idx < SXLATCH_SESSION_DIR_SIZE; dir_idx++ )
+    {
+        chunk = __sxlatch_session_dir[dir_idx];
+        if( chunk == NULL )
+        {
+            continue;
+        }
+
+        for( idx = 0; idx < SXLATCH_SESSION_CHUNK_SIZE; idx++ )
+        {
+            visitor( (dir_idx << SXLATCH_SESSION_CHUNK_BITS) | idx,
+                     &(chunk[idx]),
+                     arg );
+        }
+    }
+}
+
+sxlatch_session_shard_holds_t * sxlatch_session_get_shard_holds( sxlatch_session_t * sess )
+{
+    sxlatch_session_shard_holds_t * holds = sess->shard_holds;
+
+    if( __builtin_expect( holds == NULL, 0 ) )
+    {
+        holds = calloc( 1, sizeof(sxlatch_session_shard_holds_t) );
+        TRY( holds == NULL );
+
+        if( atomic_cas_64( &(sess->shard_holds), NULL, holds ) != NULL )
+        {
+            free( holds );
+            holds = sess->shard_holds;
+        }
+    }
+
+    return holds;
+
+    CATCH_END;
+
+    return NULL;
+}
+
+volatile int32_t __sxlatch_hold_track_enabled = 0;
+__thread int32_t __sxlatch_hold_by_proxy = 0;
+
+int sxlatch_session_track_holds( bool enable )
+{
+    __sxlatch_hold_track_enabled = ( enable == true ) ? 1 : 0;
+    mem_barrier();
+
+    return RC_SUCCESS;
+}
+
+static sxlatch_session_holds_t * __sxlatch_session_holds( session_id_t session_id )
+{
+    sxlatch_session_t * sess = sxlatch_session_get( session_id );
+    sxlatch_session_holds_t * holds = NULL;
+
+    TRY( sess == NULL );
+
+    holds = sess->holds;
+    if( holds == NULL )
+    {
+        holds = calloc( 1, sizeof(sxlatch_session_holds_t) );
+        TRY( holds == NULL );
+
+        /* the async granter may allocate it at the same time */
+        if( atomic_cas_64( &(sess->holds), NULL, holds ) != NULL )
+        {
+            free( holds );
+            holds = sess->holds;
+        }
+    }
+
+    return holds;
+
+    CATCH_END;
+
+    return NULL;
+}
+
+void sxlatch_session_holds_lock( sxlatch_session_holds_t * holds )
+{
+    while( holds->lock != 0 || atomic_cas_32( &(holds->lock), 0, 1 ) != 0 )
+    {
+        sched_yield();
+    }
+}
+
+void sxlatch_session_holds_unlock( sxlatch_session_holds_t * holds )
+{
+    __atomic_store_n( &(holds->lock), 0, __ATOMIC_RELEASE );
+}
+
+/* under the lock */
+static void __sxlatch_session_hold_append( sxlatch_session_holds_t * holds,
+                                           void *                    latch,
+                                           int                       mode )
+{
+    sxlatch_hold_t * entries = NULL;
+    uint32_t cap = 0;
+
+    if( holds->cnt == holds->cap )
+    {
+        cap = ( holds->cap == 0 ) ? SXLATCH_SESSION_HOLDS_INIT_CAP : holds->cap * 2;
+        entries = realloc( holds->entries, sizeof(sxlatch_hold_t) * cap );
+        if( entries == NULL )
+        {
+            holds->overflow = true;
+            return;
+        }
+        holds->entries = entries;
+        holds->cap     = cap;
+    }
+
+    holds->entries[holds->cnt].latch = latch;
+    holds->entries[holds->cnt].mode  = mode;
+    mem_barrier();
+    holds->cnt++;
+}
+
+void sxlatch_session_hold_request( session_id_t session_id, void * latch, int mode )
+{
+    sxlatch_session_holds_t * holds = __sxlatch_session_holds( session_id );
+
+    if( holds != NULL )
+    {
+        holds->pending_mode = mode;
+        /* the mode is visible before the latch for the recovery */
+        mem_barrier();
+        holds->pending = latch;
+    }
+}
+
+void sxlatch_session_hold_result( session_id_t session_id, void * latch, bool granted )
+{
+    sxlatch_session_holds_t * holds = __sxlatch_session_holds( session_id );
+
+    if( holds == NULL || holds->pending != latch )
+    {
+        return;
+    }
+
+    if( granted == true )
+    {
+        sxlatch_session_holds_lock( holds );
+        __sxlatch_session_hold_append( holds, latch, holds->pending_mode );
+        sxlatch_session_holds_unlock( holds );
+    }
+
+    holds->pending = NULL;
+}
+
+void sxlatch_session_hold_add( session_id_t session_id, void * latch, int mode )
+{
+    sxlatch_session_holds_t * holds = __sxlatch_session_holds( session_id );
+
+    if( holds != NULL )
+    {
+        sxlatch_session_holds_lock( holds );
+        __sxlatch_session_hold_append( holds, latch, mode );
+        sxlatch_session_holds_unlock( holds );
+    }
+}
+
+void sxlatch_session_hold_release( session_id_t session_id, void * latch )
+{
+    sxlatch_session_t * sess = sxlatch_session_get( session_id );
+    sxlatch_session_holds_t * holds = ( sess != NULL ) ? sess->holds : NULL;
+    int64_t idx = 0;
+
+    if( holds == NULL )
+    {
+        return;
+    }
+
+    sxlatch_session_holds_lock( holds );
+
+    /* latches are released mostly in the reverse order */
+    for( idx = (int64_t)holds->cnt - 1; idx >= 0; idx-- )
+    {
+        if( holds->entries[idx].latch == latch )
+        {
+            memmove( &(holds->entries[idx]), &(holds->entries[idx + 1]),
+                     sizeof(sxlatch_hold_t) * (holds->cnt - idx - 1) );
+            holds->cnt--;
+            break;
+        }
+    }
+
+    sxlatch_session_holds_unlock( holds );
+}
+
+sxlatch_session_holds_t * sxlatch_session_get_holds( session_id_t session_id )
+{
+    sxlatch_session_t * sess = sxlatch_session_find( session_id );
+
+    return ( sess != NULL ) ? sess->holds : NULL;
+}
@@ -0,0 +1,150 @@
+#ifndef _SESSION_H_
+#define _SESSION_H_ 1
+
+#include <stdint.h>
+#include "util.h"
+
+typedef int32_t session_id_t;
+
+/* per-session control block
+ * Every session id that ever touches the latch API through a session
+ * oriented function(interrupt, ...) owns one block. Blocks are never freed,
+ * so a pointer to it stays valid for the life of the process. */
+typedef struct _sxlatch_session sxlatch_session_t;
+struct _sxlatch_session
+{
+    /* futex word: 0 = running, SXLATCH_SESSION_INTERRUPT_XXX */
+    volatile int32_t  interrupted;
+    volatile int32_t  sleeping_cnt;
+    /* the latch which this session is waiting for in sxlatch_int*lock() */
+    const void * volatile waiting_latch;
+    /* latch wait accounting(stat.h), allocated at the first contended wait */
+    struct _sxlatch_session_waits * volatile waits;
+    /* futex word: > 0 while the session cannot run(sleeps, descheduled).
+     * Waiters for an X held by this session park instead of spinning. */
+    volatile int32_t  off_cpu;
+    volatile int32_t  off_cpu_waiters;
+    /* latches held(hold tracking), allocated at the first tracked request */
+    struct _sxlatch_session_holds * volatile holds;
+    /* S held through the shards of inflated latches, allocated at the first */
+    struct _sxlatch_session_shard_holds * volatile shard_holds;
+} __attribute__((aligned(64)));
+
+/* sessions are kept in a two level table(directory -> chunk), which covers
+ * the whole 28-bit session id space without preallocating it. */
+#define SXLATCH_SESSION_CHUNK_BITS    10
+#define SXLATCH_SESSION_CHUNK_SIZE    (1 << SXLATCH_SESSION_CHUNK_BITS)
+#define SXLATCH_SESSION_CHUNK_MASK    (SXLATCH_SESSION_CHUNK_SIZE - 1)
+
+sxlatch_session_t * sxlatch_session_get( session_id_t session_id );
+/* lookup only: NULL if the block was never allocated */
+sxlatch_session_t * sxlatch_session_find( session_id_t session_id );
+
+#define SXLATCH_SESSION_INTERRUPT        1   /* stays until it is cleared */
+#define SXLATCH_SESSION_INTERRUPT_ONCE   2   /* for the wait going on only */
+
+int sxlatch_session_interrupt( session_id_t session_id );
+int sxlatch_session_clear_interrupt( session_id_t session_id );
+bool sxlatch_session_is_interrupted( sxlatch_session_t * sess );
+
+/* a one-shot interrupt(watchdog): the waiter which sees it takes it, and
+ * it is dropped when the wait ends otherwise. It never replaces the
+ * interrupt which stays. */
+int sxlatch_session_interrupt_once( session_id_t session_id );
+bool sxlatch_session_take_interrupt( sxlatch_session_t * sess );
+void sxlatch_session_drop_interrupt_once( sxlatch_session_t * sess );
+
+/* visit every session block of the allocated chunks */
+typedef void (*sxlatch_session_visitor)( session_id_t        session_id,
+                                         sxlatch_session_t * sess,
+                                         void              * arg );
+void sxlatch_session_foreach( sxlatch_session_visitor visitor, void * arg );
+
+/* sleep at most usec, but return as soon as the session is interrupted */
+int sxlatch_session_sleep( sxlatch_session_t * sess, uint64_t usec );
+
+/* on-cpu indicator of the session(opt-in)
+ * The session is off cpu while it sleeps in the backoff of an int*lock
+ * (sxlatch_session_sleep), and between sxlatch_session_set_off_cpu( id,
+ * true ) and ( id, false ), which the engine calls around its own
+ * descheduling points(blocking I/O, task switch of a user level
+ * scheduler). Calls nest. Preemption is not seen: an engine which never
+ * calls it gets owner parking only for owners asleep in an int*lock. */
+int sxlatch_session_set_off_cpu( session_id_t session_id, bool off_cpu );
+
+/* park until the session is back on cpu, at most usec */
+int sxlatch_session_wait_on_cpu( sxlatch_session_t * sess, uint64_t usec );
+
+/* S held through a shard of an inflated latch(inflate.h)
+ * Kept by session, so the session may release it from any thread and the
+ * recovery can take the shard counts of a dead session back. */
+#define SXLATCH_SESSION_SHARD_HOLD_CNT    8    /* nested shard reads */
+
+typedef struct _sxlatch_shard_hold sxlatch_shard_hold_t;
+struct _sxlatch_shard_hold
+{
+    const void *         latch;
+    volatile int64_t *   readers;   /* the counter of the shard */
+};
+
+typedef struct _sxlatch_session_shard_holds sxlatch_session_shard_holds_t;
+struct _sxlatch_session_shard_holds
+{
+    int32_t               cnt;
+    sxlatch_shard_hold_t  holds[SXLATCH_SESSION_SHARD_HOLD_CNT];
+};
+
+/* NULL when out of memory */
+sxlatch_session_shard_holds_t * sxlatch_session_get_shard_holds( sxlatch_session_t * sess );
+
+/* hold tracking
+ * While enabled, the public lock functions record the latch a session
+ * requests(pending) and move it to entries[] when it is granted;
+ * sxlatch_unlock() drops it. sxlatch_recover_session() releases what a
+ * dead session left with it. pending is written by the owning session
+ * only; entries[] also by the async granter(async.h), which takes latches
+ * for sessions it does not run, so its writers take lock. */
+typedef struct _sxlatch_hold sxlatch_hold_t;
+struct _sxlatch_hold
+{
+    void *    latch;
+    int32_t   mode;     /* BF_LATCH_MODE_S or BF_LATCH_MODE_X_ACQUIRED */
+};
+
+typedef struct _sxlatch_session_holds sxlatch_session_holds_t;
+struct _sxlatch_session_holds
+{
+    volatile int32_t  lock;           /* entries[], cnt, cap, overflow */
+    void *            pending;        /* requested, not granted(yet) */
+    int32_t           pending_mode;
+    bool              overflow;       /* an entry was lost(out of memory) */
+    uint32_t          cnt;
+    uint32_t          cap;
+    sxlatch_hold_t *  entries;        /* the oldest first */
+};
+
+#define SXLATCH_SESSION_HOLDS_INIT_CAP    16
+
+extern volatile int32_t __sxlatch_hold_track_enabled;
+/* set on a thread which takes latches for other sessions(the async
+ * granter): the lock functions do not track, it adds the grants itself,
+ * and it takes S on the value of an inflated latch, not in a shard */
+extern __thread int32_t __sxlatch_hold_by_proxy;
+
+/* holds taken before enabling are not known */
+int sxlatch_session_track_holds( bool enable );
+
+/* hooks called by the public lock functions */
+void sxlatch_session_hold_request( session_id_t session_id, void * latch, int mode );
+void sxlatch_session_hold_result( session_id_t session_id, void * latch, bool granted );
+void sxlatch_session_hold_release( session_id_t session_id, void * latch );
+/* a latch granted to the session by a proxy */
+void sxlatch_session_hold_add( session_id_t session_id, void * latch, int mode );
+
+void sxlatch_session_holds_lock( sxlatch_session_holds_t * holds );
+void sxlatch_session_holds_unlock( sxlatch_session_holds_t * holds );
+
+/* NULL if the session never requested a latch while tracking */
+sxlatch_session_holds_t * sxlatch_session_get_holds( session_id_t session_id );
+
+#endif /* _SESSION_H_ */
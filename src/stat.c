@@ -0,0 +1,480 @@
+#include <stdlib.h>
+#include <memory.h>
+#include <pthread.h>
+
+#include "stat.h"
+#include "sxlatch.h"
+#include "session.h"
+#include "atomic.h"
+#include "util.h"
+
+/* holds of one thread which are not released yet */
+#define SXLATCH_STAT_HOLD_DEPTH     64
+
+typedef struct _sxlatch_stat_class sxlatch_stat_class_t;
+struct _sxlatch_stat_class
+{
+    sxlatch_histogram_t hist[SXLATCH_STAT_MODE_MAX][SXLATCH_STAT_KIND_MAX];
+};
+
+typedef struct _sxlatch_stat_hold sxlatch_stat_hold_t;
+struct _sxlatch_stat_hold
+{
+    const sxlatch_t * latch;
+    int               mode;
+    uint64_t          begin;
+};
+
+typedef struct _sxlatch_stat_thread sxlatch_stat_thread_t;
+struct _sxlatch_stat_thread
+{
+    sxlatch_stat_thread_t * next;
+    volatile int32_t        in_use;
+    int32_t                 hold_cnt;
+    uint32_t                epoch;
+    sxlatch_stat_hold_t     holds[SXLATCH_STAT_HOLD_DEPTH];
+    /* allocated when the thread records the class first */
+    sxlatch_stat_class_t * volatile classes[SXLATCH_CLASS_MAX];
+};
+
+volatile int32_t __sxlatch_stat_enabled = 0;
+
+/* increased on every enabling, so that holds which began before
+ * disabling are forgotten */
+static volatile uint32_t __sxlatch_stat_epoch = 0;
+
+/* thread blocks are never freed, but handed over to a new thread after
+ * the owner thread exited. The counters keep accumulating. */
+static sxlatch_stat_thread_t * volatile __sxlatch_stat_threads = NULL;
+static __thread sxlatch_stat_thread_t * __sxlatch_stat_my_thread = NULL;
+
+static pthread_once_t __sxlatch_stat_once = PTHREAD_ONCE_INIT;
+static pthread_key_t  __sxlatch_stat_key;
+
+static void __sxlatch_stat_detach( void * arg )
+{
+    sxlatch_stat_thread_t * thr = (sxlatch_stat_thread_t *)arg;
+
+    thr->hold_cnt = 0;
+    mem_barrier();
+    thr->in_use = 0;
+}
+
+static void __sxlatch_stat_init_key( void )
+{
+    pthread_key_create( &__sxlatch_stat_key, __sxlatch_stat_detach );
+}
+
+static sxlatch_stat_thread_t * __sxlatch_stat_attach( void )
+{
+    sxlatch_stat_thread_t * thr = NULL;
+    sxlatch_stat_thread_t * oldhead = NULL;
+
+    pthread_once( &__sxlatch_stat_once, __sxlatch_stat_init_key );
+
+    for( thr = __sxlatch_stat_threads; thr != NULL; thr = thr->next )
+    {
+        if( thr->in_use == 0 &&
+            atomic_cas_32( &(thr->in_use), 0, 1 ) == 0 )
+        {
+            break;
+        }
+    }
+
+    if( thr == NULL )
+    {
+        TRY( posix_memalign( (void **)&thr, 64, sizeof(sxlatch_stat_thread_t) ) != 0 );
+        memset( thr, 0x00, sizeof(sxlatch_stat_thread_t) );
+        thr->in_use = 1;
+
+        do
+        {
+            oldhead   = __sxlatch_stat_threads;
+            thr->next = oldhead;
+        } while( atomic_cas_64( &__sxlatch_stat_threads, oldhead, thr ) != oldhead );
+    }
+
+    pthread_setspecific( __sxlatch_stat_key, thr );
+    __sxlatch_stat_my_thread = thr;
+
+    return thr;
+
+    CATCH_END;
+
+    return NULL;
+}
+
+static inline sxlatch_stat_thread_t * __sxlatch_stat_get_thread( void )
+{
+    sxlatch_stat_thread_t * thr = __sxlatch_stat_my_thread;
+
+    if( __builtin_expect( thr == NULL, 0 ) )
+    {
+        thr = __sxlatch_stat_attach();
+        TRY( thr == NULL );
+    }
+
+    if( thr->epoch != __sxlatch_stat_epoch )
+    {
+        thr->epoch    = __sxlatch_stat_epoch;
+        thr->hold_cnt = 0;
+    }
+
+    return thr;
+
+    CATCH_END;
+
+    return NULL;
+}
+
+static inline int __sxlatch_hist_bucket( uint64_t value )
+{
+    int shift = 0;
+
+    if( value < SXLATCH_HIST_SUB_CNT )
+    {
+        return (int)value;
+    }
+
+    shift = (63 - __builtin_clzll( value )) - SXLATCH_HIST_SUB_BITS;
+
+    return ((shift + 1) << SXLATCH_HIST_SUB_BITS) +
+           (int)((value >> shift) & (SXLATCH_HIST_SUB_CNT - 1));
+}
+
+/* the largest value which falls into the bucket */
+static uint64_t __sxlatch_hist_bucket_upper( int idx )
+{
+    int shift = 0;
+
+    if( idx < SXLATCH_HIST_SUB_CNT )
+    {
+        return (uint64_t)idx;
+    }
+
+    shift = (idx >> SXLATCH_HIST_SUB_BITS) - 1;
+
+    return (((uint64_t)(SXLATCH_HIST_SUB_CNT + (idx & (SXLATCH_HIST_SUB_CNT - 1)))) << shift) +
+           ((1ULL << shift) - 1);
+}
+
+static void __sxlatch_stat_record( const sxlatch_t * r,
+                                   int               mode,
+                                   int               kind,
+                                   uint64_t          ticks )
+{
+    sxlatch_stat_thread_t * thr = __sxlatch_stat_my_thread;
+    sxlatch_stat_class_t  * cls = NULL;
+    sxlatch_histogram_t   * hist = NULL;
+    int latch_class = r->latch_class;
+
+    if( latch_class >= SXLATCH_CLASS_MAX )
+    {
+        latch_class = SXLATCH_CLASS_DEFAULT;
+    }
+
+    cls = thr->classes[latch_class];
+    if( __builtin_expect( cls == NULL, 0 ) )
+    {
+        cls = calloc( 1, sizeof(sxlatch_stat_class_t) );
+        if( cls == NULL )
+        {
+            return;
+        }
+        mem_barrier();
+        thr->classes[latch_class] = cls;
+    }
+
+    hist = &(cls->hist[mode][kind]);
+    hist->count++;
+    hist->sum += ticks;
+    if( hist->max < ticks )
+    {
+        hist->max = ticks;
+    }
+    hist->buckets[__sxlatch_hist_bucket( ticks )]++;
+}
+
+void sxlatch_stat_record_wait( const sxlatch_t * r, int mode, uint64_t ticks )
+{
+    if( __sxlatch_stat_get_thread() == NULL )
+    {
+        return;
+    }
+
+    __sxlatch_stat_record( r, mode, SXLATCH_STAT_WAIT, ticks );
+}
+
+void sxlatch_stat_hold_begin( const sxlatch_t * r, int mode, uint64_t now )
+{
+    sxlatch_stat_thread_t * thr = __sxlatch_stat_get_thread();
+
+    if( thr == NULL || thr->hold_cnt >= SXLATCH_STAT_HOLD_DEPTH )
+    {
+        /* too deep: this hold is not measured */
+        return;
+    }
+
+    thr->holds[thr->hold_cnt].latch = r;
+    thr->holds[thr->hold_cnt].mode  = mode;
+    thr->holds[thr->hold_cnt].begin = now;
+    thr->hold_cnt++;
+}
+
+void sxlatch_stat_hold_end( const sxlatch_t * r, uint64_t now )
+{
+    sxlatch_stat_thread_t * thr = __sxlatch_stat_get_thread();
+    int idx = 0;
+
+    if( thr == NULL )
+    {
+        return;
+    }
+
+    /* latches are released in LIFO order mostly */
+    for( idx = thr->hold_cnt - 1; idx >= 0; idx-- )
+    {
+        if( thr->holds[idx].latch == r )
+        {
+            __sxlatch_stat_record( r,
+                                   thr->holds[idx].mode,
+                                   SXLATCH_STAT_HOLD,
+                                   ( now > thr->holds[idx].begin ) ?
+                                   now - thr->holds[idx].begin : 0 );
+
+            thr->hold_cnt--;
+            if( idx != thr->hold_cnt )
+            {
+                memmove( &(thr->holds[idx]),
+                         &(thr->holds[idx + 1]),
+                         sizeof(sxlatch_stat_hold_t) * (thr->hold_cnt - idx) );
+            }
+            break;
+        }
+    }
+}
+
+int sxlatch_stat_enable( bool enable )
+{
+    if( enable == true )
+    {
+        /* calibrate the tick rate here, not at the first read */
+        (void)get_elapsed_time( 0 );
+        atomic_inc_fetch( &__sxlatch_stat_epoch );
+    }
+
+    mem_barrier();
+    __sxlatch_stat_enabled = (enable == true) ? 1 : 0;
+    mem_barrier();
+
+    return RC_SUCCESS;
+}
+
+/* CAUTION: the counters are owned by the recording threads, so samples
+ * recorded during the reset may survive it. */
+void sxlatch_stat_reset( void )
+{
+    sxlatch_stat_thread_t * thr = NULL;
+    int latch_class = 0;
+
+    for( thr = __sxlatch_stat_threads; thr != NULL; thr = thr->next )
+    {
+        for( latch_class = 0; latch_class < SXLATCH_CLASS_MAX; latch_class++ )
+        {
+            if( thr->classes[latch_class] != NULL )
+            {
+                memset( thr->classes[latch_class], 0x00,
+                        sizeof(sxlatch_stat_class_t) );
+            }
+        }
+    }
+    mem_barrier();
+}
+
+int sxlatch_stat_get_histogram( int                   latch_class,
+                                int                   mode,
+                                int                   kind,
+                                sxlatch_histogram_t * hist )
+{
+    sxlatch_stat_thread_t * thr = NULL;
+    sxlatch_histogram_t   * src = NULL;
+    int idx = 0;
+
+    TRY( hist == NULL );
+    TRY( latch_class < 0 || latch_class >= SXLATCH_CLASS_MAX );
+    TRY( mode < 0 || mode >= SXLATCH_STAT_MODE_MAX );
+    TRY( kind < 0 || kind >= SXLATCH_STAT_KIND_MAX );
+
+    memset( hist, 0x00, sizeof(sxlatch_histogram_t) );
+
+    for( thr = __sxlatch_stat_threads; thr != NULL; thr = thr->next )
+    {
+        if( thr->classes[latch_class] == NULL )
+        {
+            continue;
+        }
+
+        src = &(thr->classes[latch_class]->hist[mode][kind]);
+
+        hist->count += src->count;
+        hist->sum   += src->sum;
+        if( hist->max < src->max )
+        {
+            hist->max = src->max;
+        }
+
+        for( idx = 0; idx < SXLATCH_HIST_BUCKET_CNT; idx++ )
+        {
+            hist->buckets[idx] += src->buckets[idx];
+        }
+    }
+
+    return RC_SUCCESS;
+
+    CATCH_END;
+
+    return RC_FAIL;
+}
+
+uint64_t sxlatch_histogram_percentile( const sxlatch_histogram_t * hist,
+                                       double                      percentile )
+{
+    uint64_t total  = 0;
+    uint64_t target = 0;
+    uint64_t seen   = 0;
+    int idx = 0;
+
+    for( idx = 0; idx < SXLATCH_HIST_BUCKET_CNT; idx++ )
+    {
+        total += hist->buckets[idx];
+    }
+
+    if( total == 0 )
+    {
+        return 0;
+    }
+
+    target = (uint64_t)((double)total * percentile / 100.0);
+    if( target == 0 )
+    {
+        target = 1;
+    }
+
+    for( idx = 0; idx < SXLATCH_HIST_BUCKET_CNT; idx++ )
+    {
+        seen += hist->buckets[idx];
+        if( seen >= target )
+        {
+            break;
+        }
+    }
+
+    return (uint64_t)get_elapsed_time( __sxlatch_hist_bucket_upper( idx ) );
+}
+
+uint64_t sxlatch_histogram_mean( const sxlatch_histogram_t * hist )
+{
+    return ( hist->count == 0 ) ? 0 :
+           (uint64_t)get_elapsed_time( hist->sum / hist->count );
+}
+
+uint64_t sxlatch_histogram_max( const sxlatch_histogram_t * hist )
+{
+    return (uint64_t)get_elapsed_time( hist->max );
+}
+
+void sxlatch_stat_record_session_wait( const sxlatch_t * r,
+                                       session_id_t      session_id,
+                                       int               mode,
+                                       uint64_t          ticks )
+{
+    sxlatch_session_t       * sess  = sxlatch_session_get( session_id );
+    sxlatch_session_waits_t * waits = NULL;
+    sxlatch_session_wait_t  * wait  = NULL;
+    int latch_class = r->latch_class;
+
+    if( sess == NULL )
+    {
+        return;
+    }
+
+    if( latch_class >= SXLATCH_CLASS_MAX )
+    {
+        latch_class = SXLATCH_CLASS_DEFAULT;
+    }
+
+    waits = sess->waits;
+    if( __builtin_expect( waits == NULL, 0 ) )
+    {
+        waits = calloc( 1, sizeof(sxlatch_session_waits_t) );
+        if( waits == NULL )
+        {
+            return;
+        }
+
+        if( atomic_cas_64( &(sess->waits), NULL, waits ) != NULL )
+        {
+            free( waits );
+            waits = sess->waits;
+        }
+    }
+
+    wait = &(waits->waits[latch_class][mode]);
+    wait->wait_cnt++;
+    wait->wait_ticks += ticks;
+}
+
+int sxlatch_stat_get_session_waits( session_id_t              session_id,
+                                    sxlatch_session_waits_t * waits )
+{
+    sxlatch_session_t * sess = sxlatch_session_get( session_id );
+    int latch_class = 0;
+    int mode = 0;
+
+    TRY( sess == NULL || waits == NULL );
+
+    if( sess->waits == NULL )
+    {
+        memset( waits, 0x00, sizeof(sxlatch_session_waits_t) );
+    }
+    else
+    {
+        memcpy( waits, sess->waits, sizeof(sxlatch_session_waits_t) );
+    }
+
+    for( latch_class = 0; latch_class < SXLATCH_CLASS_MAX; latch_class++ )
+    {
+        for( mode = 0; mode < SXLATCH_STAT_MODE_MAX; mode++ )
+        {
+            waits->waits[latch_class][mode].wait_ticks =
+                (uint64_t)get_elapsed_time( waits->waits[latch_class][mode].wait_ticks );
+        }
+    }
+
+    return RC_SUCCESS;
+
+    CATCH_END;
+
+    return RC_FAIL;
+}
+
+/* CAUTION: reset it in the session itself, or the waits counted during
+ * the reset may survive. */
+int sxlatch_stat_reset_session_waits( session_id_t session_id )
+{
+    sxlatch_session_t * sess = sxlatch_session_get( session_id );
+
+    TRY( sess == NULL );
+
+    if( sess->waits != NULL )
+    {
+        memset( sess->waits, 0x00, sizeof(sxlatch_session_waits_t) );
+        mem_barrier();
+    }
+
+    return RC_SUCCESS;
+
+    CATCH_END;
+
+    return RC_FAIL;
+}
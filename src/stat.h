@@ -0,0 +1,86 @@
+#ifndef _STAT_H_
+#define _STAT_H_ 1
+
+#include <stdint.h>
+#include "util.h"
+#include "sxlatch.h"
+
+/* wait/hold time histograms per latch class and mode
+ * Samples are rdtsc() ticks, recorded into buckets owned by the recording
+ * thread(no shared cache line on the hot path). Readers merge all threads
+ * and convert ticks into nanoseconds.
+ *
+ * buckets are log scaled(HDR style): values below SXLATCH_HIST_SUB_CNT get
+ * their own bucket, and every power of two above it is split into
+ * SXLATCH_HIST_SUB_CNT linear sub buckets(relative error < 12.5%). */
+
+#define SXLATCH_STAT_WAIT           0  /* first attempt -> acquired */
+#define SXLATCH_STAT_HOLD           1  /* acquired -> sxlatch_unlock */
+#define SXLATCH_STAT_KIND_MAX       2
+
+#define SXLATCH_STAT_MODE_S         0
+#define SXLATCH_STAT_MODE_X         1
+#define SXLATCH_STAT_MODE_MAX       2
+
+#define SXLATCH_HIST_SUB_BITS       3
+#define SXLATCH_HIST_SUB_CNT        (1 << SXLATCH_HIST_SUB_BITS)
+#define SXLATCH_HIST_BUCKET_CNT     ((64 - SXLATCH_HIST_SUB_BITS + 1) << SXLATCH_HIST_SUB_BITS)
+
+typedef struct _sxlatch_histogram sxlatch_histogram_t;
+struct _sxlatch_histogram
+{
+    uint64_t  count;
+    uint64_t  sum;                 /* ticks */
+    uint64_t  max;                 /* ticks */
+    uint64_t  buckets[SXLATCH_HIST_BUCKET_CNT];
+};
+
+extern volatile int32_t __sxlatch_stat_enabled;
+
+int sxlatch_stat_enable( bool enable );
+void sxlatch_stat_reset( void );
+
+/* merge the histograms of all threads */
+int sxlatch_stat_get_histogram( int                   latch_class,
+                                int                   mode,
+                                int                   kind,
+                                sxlatch_histogram_t * hist );
+
+/* results are nanoseconds */
+uint64_t sxlatch_histogram_percentile( const sxlatch_histogram_t * hist,
+                                       double                      percentile );
+uint64_t sxlatch_histogram_mean( const sxlatch_histogram_t * hist );
+uint64_t sxlatch_histogram_max( const sxlatch_histogram_t * hist );
+
+/* per-session wait accounting(wait events)
+ * Time a session was blocked on latches, by latch class and mode.
+ * Updated on the contended path only: uncontended acquisitions are not
+ * counted. The owning session is the only writer. */
+typedef struct _sxlatch_session_wait sxlatch_session_wait_t;
+struct _sxlatch_session_wait
+{
+    uint64_t  wait_cnt;
+    uint64_t  wait_ticks;   /* sxlatch_stat_get_session_waits(): nsec */
+};
+
+typedef struct _sxlatch_session_waits sxlatch_session_waits_t;
+struct _sxlatch_session_waits
+{
+    sxlatch_session_wait_t  waits[SXLATCH_CLASS_MAX][SXLATCH_STAT_MODE_MAX];
+};
+
+/* copy the waits of the session, in nanoseconds */
+int sxlatch_stat_get_session_waits( session_id_t              session_id,
+                                    sxlatch_session_waits_t * waits );
+int sxlatch_stat_reset_session_waits( session_id_t session_id );
+
+/* hooks called by the latch functions */
+void sxlatch_stat_record_session_wait( const sxlatch_t * r,
+                                       session_id_t      session_id,
+                                       int               mode,
+                                       uint64_t          ticks );
+void sxlatch_stat_record_wait( const sxlatch_t * r, int mode, uint64_t ticks );
+void sxlatch_stat_hold_begin( const sxlatch_t * r, int mode, uint64_t now );
+void sxlatch_stat_hold_end( const sxlatch_t * r, uint64_t now );
+
+#endif /* _STAT_H_ */
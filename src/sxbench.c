@@ -0,0 +1,644 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "sxlatch.h"
+#include "stat.h"
+#include "rand_r.h"
+#include "atomic.h"
+#include "util.h"
+
+/* sxbench: latch micro benchmarks
+ * usage: sxbench [-t threads] [-d msec] [-w write%] [-p policy] [-b] [-r latches]
+ *
+ * rw: threads take one latch in S or X(write% of the operations), touch
+ *     the protected data and do some work outside. Reports throughput and
+ *     the wait time percentiles of S and X, per policy and mix. Without
+ *     -w/-p, runs the 90/10 and 50/50 mixes under every policy.
+ * backoff(-b): the rw workload on a DEFAULT latch(or -p), write-heavy
+ *     (90% X without -w), with and without the randomized CAS backoff.
+ *     Reports throughput and the failed CASes per operation.
+ * recovery(-r): SXBENCH_RECOVERY_DEAD_CNT sessions die holding `latches`
+ *     latches each(S and X alternately), the threads block for X on some
+ *     of them, and sxlatch_recover_session() cleans the dead sessions up.
+ *     Reports the recovery time and the time-to-unblock of the waiters. */
+
+#define SXBENCH_DEFAULT_THREADS     8
+#define SXBENCH_DEFAULT_MSEC        1000
+#define SXBENCH_DATA_CNT            16     /* cache lines under the latch */
+#define SXBENCH_THINK_LOOPS         200    /* work outside the latch */
+#define SXBENCH_RECOVERY_DEAD_CNT   4
+#define SXBENCH_RECOVERY_SETTLE_MSEC 100   /* until the waiters block */
+
+typedef struct _sxbench_conf sxbench_conf_t;
+struct _sxbench_conf
+{
+    int   thread_cnt;
+    int   msec;
+    int   write_pct;     /* -1: 10 and 50 */
+    int   policy;        /* -1: all */
+    bool  backoff;       /* run the backoff benchmark */
+    int   recovery;      /* latches per dead session, 0: no recovery run */
+};
+
+typedef struct _sxbench_shared sxbench_shared_t;
+struct _sxbench_shared
+{
+    sxlatch_t          latch;
+    int                write_pct;
+    volatile int32_t   stop;
+    volatile uint64_t  data[SXBENCH_DATA_CNT][8];
+};
+
+typedef struct _sxbench_thread sxbench_thread_t;
+struct _sxbench_thread
+{
+    pthread_t          thread;
+    sxbench_shared_t * shared;
+    session_id_t       session_id;
+    uint64_t           ops;
+    uint64_t           cas_fails;
+} __attribute__((aligned(64)));
+
+typedef struct _sxbench_recovery sxbench_recovery_t;
+struct _sxbench_recovery
+{
+    sxlatch_t *        latches;
+    int                latch_cnt;    /* per dead session */
+};
+
+typedef struct _sxbench_victim sxbench_victim_t;
+struct _sxbench_victim
+{
+    pthread_t            thread;
+    sxbench_recovery_t * rec;
+    session_id_t         session_id;
+    int                  latch_idx;  /* survivor: the latch waited for */
+    int                  ret;
+    uint64_t             acquired;   /* survivor: get_time_nsec() */
+} __attribute__((aligned(64)));
+
+static const char * __sxbench_policy_name[SXLATCH_POLICY_MAX] = {
+    "default",
+    "phase-fair",
+    "reader-pref",
+    "writer-pref",
+    "biased",
+    "asymmetric",
+    "bounded"
+};
+
+static void * __sxbench_rw_main( void * arg )
+{
+    sxbench_thread_t * thr    = (sxbench_thread_t *)arg;
+    sxbench_shared_t * shared = thr->shared;
+    RNG rng;
+    uint64_t sum = 0;
+    int idx = 0;
+    volatile int loops = 0;
+
+    RNG_init( &rng, (uint32_t)thr->session_id * 7919, 0, 100 );
+    __sxlatch_cas_fail_cnt = 0;
+
+    while( shared->stop == 0 )
+    {
+        if( (int)RNG_generate( &rng ) < shared->write_pct )
+        {
+            sxlatch_wrlock( &(shared->latch), thr->session_id );
+            for( idx = 0; idx < SXBENCH_DATA_CNT; idx++ )
+            {
+                shared->data[idx][0]++;
+            }
+        }
+        else
+        {
+            sxlatch_rdlock( &(shared->latch), thr->session_id );
+            for( idx = 0; idx < SXBENCH_DATA_CNT; idx++ )
+            {
+                sum += shared->data[idx][0];
+            }
+        }
+        sxlatch_unlock( &(shared->latch), thr->session_id );
+
+        thr->ops++;
+
+        for( loops = 0; loops < SXBENCH_THINK_LOOPS; loops++ )
+        {
+            /* think */
+        }
+    }
+
+    thr->cas_fails = __sxlatch_cas_fail_cnt;
+
+    return (void *)(uintptr_t)sum;
+}
+
+/* run the rw threads on shared for conf->msec */
+static int __sxbench_run_threads( const sxbench_conf_t * conf,
+                                  sxbench_shared_t *     shared,
+                                  sxbench_thread_t *     threads,
+                                  uint64_t *             ops,
+                                  uint64_t *             cas_fails )
+{
+    int idx = 0;
+
+    *ops       = 0;
+    *cas_fails = 0;
+
+    for( idx = 0; idx < conf->thread_cnt; idx++ )
+    {
+        threads[idx].shared     = shared;
+        threads[idx].session_id = idx + 1;
+        TRY( pthread_create( &(threads[idx].thread), NULL,
+                             __sxbench_rw_main, &(threads[idx]) ) != 0 );
+    }
+
+    thread_sleep( conf->msec / 1000, (uint64_t)(conf->msec % 1000) * 1000 );
+    shared->stop = 1;
+
+    for( idx = 0; idx < conf->thread_cnt; idx++ )
+    {
+        pthread_join( threads[idx].thread, NULL );
+        *ops       += threads[idx].ops;
+        *cas_fails += threads[idx].cas_fails;
+    }
+
+    return RC_SUCCESS;
+
+    CATCH_END;
+
+    /* let the threads already started go */
+    shared->stop = 1;
+    while( --idx >= 0 )
+    {
+        pthread_join( threads[idx].thread, NULL );
+    }
+
+    return RC_FAIL;
+}
+
+static int __sxbench_rw( const sxbench_conf_t * conf, int policy, int write_pct )
+{
+    sxbench_shared_t * shared = NULL;
+    sxbench_thread_t * threads = NULL;
+    sxlatch_histogram_t hist[SXLATCH_STAT_MODE_MAX];
+    sxlatch_attr_t attr;
+    uint64_t ops = 0;
+    uint64_t cas_fails = 0;
+
+    shared  = calloc( 1, sizeof(sxbench_shared_t) );
+    threads = calloc( conf->thread_cnt, sizeof(sxbench_thread_t) );
+    TRY( shared == NULL || threads == NULL );
+
+    sxlatch_attr_init( &attr );
+    TRY( sxlatch_attr_setpolicy( &attr, policy ) != RC_SUCCESS );
+    TRY( sxlatch_init_attr( &(shared->latch), &attr ) != RC_SUCCESS );
+    shared->write_pct = write_pct;
+
+    sxlatch_stat_reset();
+    sxlatch_stat_enable( true );
+
+    TRY_GOTO( __sxbench_run_threads( conf, shared, threads,
+                                     &ops, &cas_fails ) != RC_SUCCESS,
+              err_stat );
+
+    sxlatch_stat_enable( false );
+
+    sxlatch_stat_get_histogram( SXLATCH_CLASS_DEFAULT, SXLATCH_STAT_MODE_S,
+                                SXLATCH_STAT_WAIT, &(hist[SXLATCH_STAT_MODE_S]) );
+    sxlatch_stat_get_histogram( SXLATCH_CLASS_DEFAULT, SXLATCH_STAT_MODE_X,
+                                SXLATCH_STAT_WAIT, &(hist[SXLATCH_STAT_MODE_X]) );
+
+    printf( "%-11s %3d/%-3d %12.0f %10llu %10llu %12llu %10llu %10llu %12llu\n",
+            __sxbench_policy_name[policy],
+            100 - write_pct, write_pct,
+            (double)ops * 1000.0 / conf->msec,
+            (unsigned long long)sxlatch_histogram_percentile( &(hist[0]), 50.0 ),
+            (unsigned long long)sxlatch_histogram_percentile( &(hist[0]), 99.0 ),
+            (unsigned long long)sxlatch_histogram_max( &(hist[0]) ),
+            (unsigned long long)sxlatch_histogram_percentile( &(hist[1]), 50.0 ),
+            (unsigned long long)sxlatch_histogram_percentile( &(hist[1]), 99.0 ),
+            (unsigned long long)sxlatch_histogram_max( &(hist[1]) ) );
+
+    sxlatch_destroy( &(shared->latch) );
+    free( threads );
+    free( shared );
+
+    return RC_SUCCESS;
+
+    CATCH( err_stat )
+    {
+        sxlatch_stat_enable( false );
+    }
+    CATCH_END;
+
+    free( threads );
+    free( shared );
+
+    return RC_FAIL;
+}
+
+static int __sxbench_backoff( const sxbench_conf_t * conf,
+                              int                    policy,
+                              int                    backoff_max,
+                              int                    write_pct )
+{
+    sxbench_shared_t * shared = NULL;
+    sxbench_thread_t * threads = NULL;
+    sxlatch_attr_t attr;
+    uint64_t ops = 0;
+    uint64_t cas_fails = 0;
+
+    shared  = calloc( 1, sizeof(sxbench_shared_t) );
+    threads = calloc( conf->thread_cnt, sizeof(sxbench_thread_t) );
+    TRY( shared == NULL || threads == NULL );
+
+    sxlatch_attr_init( &attr );
+    TRY( sxlatch_attr_setpolicy( &attr, policy ) != RC_SUCCESS );
+    TRY( sxlatch_init_attr( &(shared->latch), &attr ) != RC_SUCCESS );
+    shared->write_pct = write_pct;
+
+    __sxlatch_cas_backoff_max = backoff_max;
+    TRY( __sxbench_run_threads( conf, shared, threads,
+                                &ops, &cas_fails ) != RC_SUCCESS );
+    __sxlatch_cas_backoff_max = SXLATCH_CAS_BACKOFF_MAX;
+
+    printf( "%-11s %3d/%-3d %12.0f %14llu %12.3f\n",
+            ( backoff_max > 0 ) ? "backoff" : "no-backoff",
+            100 - write_pct, write_pct,
+            (double)ops * 1000.0 / conf->msec,
+            (unsigned long long)cas_fails,
+            ( ops > 0 ) ? (double)cas_fails / ops : 0.0 );
+
+    sxlatch_destroy( &(shared->latch) );
+    free( threads );
+    free( shared );
+
+    return RC_SUCCESS;
+
+    CATCH_END;
+
+    __sxlatch_cas_backoff_max = SXLATCH_CAS_BACKOFF_MAX;
+    free( threads );
+    free( shared );
+
+    return RC_FAIL;
+}
+
+static int __sxbench_run_backoff( const sxbench_conf_t * conf )
+{
+    int write_pct = ( conf->write_pct >= 0 ) ? conf->write_pct : 90;
+    int policy    = ( conf->policy >= 0 ) ? conf->policy : SXLATCH_POLICY_DEFAULT;
+
+    printf( "backoff: %d threads, %d msec per run, %s policy\n",
+            conf->thread_cnt, conf->msec, __sxbench_policy_name[policy] );
+    printf( "%-11s %7s %12s %14s %12s\n",
+            "cas retry", "S/X", "ops/sec", "failed CASes", "fails/op" );
+
+    TRY( __sxbench_backoff( conf, policy, 0, write_pct ) != RC_SUCCESS );
+    TRY( __sxbench_backoff( conf, policy, SXLATCH_CAS_BACKOFF_MAX, write_pct ) != RC_SUCCESS );
+
+    return RC_SUCCESS;
+
+    CATCH_END;
+
+    return RC_FAIL;
+}
+
+/* takes its latches and dies with them */
+static void * __sxbench_dead_main( void * arg )
+{
+    sxbench_victim_t * v = (sxbench_victim_t *)arg;
+    sxlatch_t * latches = v->rec->latches + (size_t)v->latch_idx;
+    int idx = 0;
+
+    v->ret = RC_SUCCESS;
+
+    for( idx = 0; idx < v->rec->latch_cnt; idx++ )
+    {
+        if( ( ( idx % 2 == 0 ) ? sxlatch_rdlock( &(latches[idx]), v->session_id )
+                               : sxlatch_wrlock( &(latches[idx]), v->session_id ) )
+            != RC_SUCCESS )
+        {
+            v->ret = RC_FAIL;
+            break;
+        }
+    }
+
+    return NULL;
+}
+
+static void * __sxbench_survivor_main( void * arg )
+{
+    sxbench_victim_t * v = (sxbench_victim_t *)arg;
+    sxlatch_t * latch = &(v->rec->latches[v->latch_idx]);
+
+    v->ret = sxlatch_wrlock( latch, v->session_id );
+    v->acquired = get_time_nsec();
+
+    if( v->ret == RC_SUCCESS )
+    {
+        sxlatch_unlock( latch, v->session_id );
+    }
+
+    return NULL;
+}
+
+static int __sxbench_cmp_u64( const void * a, const void * b )
+{
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+
+    return ( x < y ) ? -1 : ( x > y ) ? 1 : 0;
+}
+
+static int __sxbench_recovery( const sxbench_conf_t * conf, int policy )
+{
+    sxbench_recovery_t rec;
+    sxbench_victim_t * dead = NULL;
+    sxbench_victim_t * survivors = NULL;
+    sxlatch_recover_stat_t stat;
+    sxlatch_attr_t attr;
+    uint64_t * unblock = NULL;
+    uint64_t released = 0;
+    uint64_t begin = 0;
+    uint64_t end = 0;
+    int total = SXBENCH_RECOVERY_DEAD_CNT * conf->recovery;
+    int started = 0;
+    int idx = 0;
+
+    memset( &rec, 0x00, sizeof(rec) );
+    rec.latch_cnt = conf->recovery;
+    rec.latches   = calloc( total, sizeof(sxlatch_t) );
+    dead          = calloc( SXBENCH_RECOVERY_DEAD_CNT, sizeof(sxbench_victim_t) );
+    survivors     = calloc( conf->thread_cnt, sizeof(sxbench_victim_t) );
+    unblock       = calloc( conf->thread_cnt, sizeof(uint64_t) );
+    TRY( rec.latches == NULL || dead == NULL || survivors == NULL || unblock == NULL );
+
+    (void)sxlatch_attr_init( &attr );
+    (void)sxlatch_attr_setpolicy( &attr, policy );
+    for( idx = 0; idx < total; idx++ )
+    {
+        TRY( sxlatch_init_attr( &(rec.latches[idx]), &attr ) != RC_SUCCESS );
+    }
+
+    sxlatch_session_track_holds( true );
+
+    /* the dead sessions: 1 ~ SXBENCH_RECOVERY_DEAD_CNT */
+    for( idx = 0; idx < SXBENCH_RECOVERY_DEAD_CNT; idx++ )
+    {
+        dead[idx].rec        = &rec;
+        dead[idx].session_id = idx + 1;
+        dead[idx].latch_idx  = idx * conf->recovery;
+        TRY_GOTO( pthread_create( &(dead[idx].thread), NULL,
+                                  __sxbench_dead_main, &(dead[idx]) ) != 0,
+                  err_untrack );
+        pthread_join( dead[idx].thread, NULL );
+        TRY_GOTO( dead[idx].ret != RC_SUCCESS, err_untrack );
+    }
+
+    /* the survivors wait for X on latches spread over all of them */
+    for( started = 0; started < conf->thread_cnt; started++ )
+    {
+        survivors[started].rec        = &rec;
+        survivors[started].session_id = SXBENCH_RECOVERY_DEAD_CNT + started + 1;
+        survivors[started].latch_idx  = (int)((int64_t)started * total / conf->thread_cnt);
+        TRY_GOTO( pthread_create( &(survivors[started].thread), NULL,
+                                  __sxbench_survivor_main, &(survivors[started]) ) != 0,
+                  err_recover );
+    }
+
+    thread_sleep( 0, SXBENCH_RECOVERY_SETTLE_MSEC * 1000 );
+
+    begin = get_time_nsec();
+    for( idx = 0; idx < SXBENCH_RECOVERY_DEAD_CNT; idx++ )
+    {
+        TRY_GOTO( sxlatch_recover_session( dead[idx].session_id, 0, &stat ) != RC_SUCCESS,
+                  err_join );
+        released += stat.released;
+    }
+    end = get_time_nsec();
+
+    for( idx = 0; idx < conf->thread_cnt; idx++ )
+    {
+        pthread_join( survivors[idx].thread, NULL );
+        TRY_GOTO( survivors[idx].ret != RC_SUCCESS, err_untrack );
+        unblock[idx] = ( survivors[idx].acquired > begin ) ?
+                       survivors[idx].acquired - begin : 0;
+    }
+
+    sxlatch_session_track_holds( false );
+
+    qsort( unblock, conf->thread_cnt, sizeof(uint64_t), __sxbench_cmp_u64 );
+
+    printf( "%-11s %10llu %12.1f %14.0f %12.1f %12.1f\n",
+            __sxbench_policy_name[policy],
+            (unsigned long long)released,
+            (double)(end - begin) / 1000.0,
+            ( end > begin ) ? (double)released * 1e9 / (end - begin) : 0.0,
+            (double)unblock[conf->thread_cnt / 2] / 1000.0,
+            (double)unblock[conf->thread_cnt - 1] / 1000.0 );
+
+    (void)sxlatch_destroy_bulk( rec.latches, total, sizeof(sxlatch_t), 0 );
+    free( unblock );
+    free( survivors );
+    free( dead );
+    free( rec.latches );
+
+    return RC_SUCCESS;
+
+    CATCH( err_recover )
+    {
+        /* let the survivors already started go */
+        for( idx = 0; idx < SXBENCH_RECOVERY_DEAD_CNT; idx++ )
+        {
+            (void)sxlatch_recover_session( dead[idx].session_id, 0, &stat );
+        }
+        while( --started >= 0 )
+        {
+            pthread_join( survivors[started].thread, NULL );
+        }
+        sxlatch_session_track_holds( false );
+    }
+    CATCH( err_join )
+    {
+        for( idx = 0; idx < conf->thread_cnt; idx++ )
+        {
+            pthread_join( survivors[idx].thread, NULL );
+        }
+        sxlatch_session_track_holds( false );
+    }
+    CATCH( err_untrack )
+    {
+        sxlatch_session_track_holds( false );
+    }
+    CATCH_END;
+
+    free( unblock );
+    free( survivors );
+    free( dead );
+    free( rec.latches );
+
+    return RC_FAIL;
+}
+
+static int __sxbench_run_recovery( const sxbench_conf_t * conf )
+{
+    int policy = 0;
+
+    printf( "recovery: %d dead sessions x %d latches(S/X 50/50), %d waiters\n",
+            SXBENCH_RECOVERY_DEAD_CNT, conf->recovery, conf->thread_cnt );
+    printf( "%-11s %10s %12s %14s %12s %12s\n",
+            "policy", "released", "recover us", "latches/sec",
+            "unblock p50", "unblock max" );
+
+    for( policy = 0; policy < SXLATCH_POLICY_MAX; policy++ )
+    {
+        if( ( conf->policy >= 0 ) ? ( policy != conf->policy )
+                                  : ( policy != SXLATCH_POLICY_DEFAULT ) )
+        {
+            continue;
+        }
+
+        TRY( __sxbench_recovery( conf, policy ) != RC_SUCCESS );
+    }
+
+    return RC_SUCCESS;
+
+    CATCH_END;
+
+    return RC_FAIL;
+}
+
+static int __sxbench_run_rw( const sxbench_conf_t * conf )
+{
+    static const int mixes[] = { 10, 50 };
+    int policy = 0;
+    int mix = 0;
+
+    printf( "rw: %d threads, %d msec per run, wait time in nsec\n",
+            conf->thread_cnt, conf->msec );
+    printf( "%-11s %7s %12s %10s %10s %12s %10s %10s %12s\n",
+            "policy", "S/X", "ops/sec",
+            "S p50", "S p99", "S max", "X p50", "X p99", "X max" );
+
+    for( mix = 0; mix < (int)(sizeof(mixes) / sizeof(mixes[0])); mix++ )
+    {
+        if( conf->write_pct >= 0 && mix > 0 )
+        {
+            break;
+        }
+
+        for( policy = 0; policy < SXLATCH_POLICY_MAX; policy++ )
+        {
+            if( conf->policy >= 0 && policy != conf->policy )
+            {
+                continue;
+            }
+
+            TRY( __sxbench_rw( conf, policy,
+                               ( conf->write_pct >= 0 ) ?
+                               conf->write_pct : mixes[mix] ) != RC_SUCCESS );
+        }
+    }
+
+    return RC_SUCCESS;
+
+    CATCH_END;
+
+    return RC_FAIL;
+}
+
+static int __sxbench_parse_policy( const char * name )
+{
+    int policy = 0;
+
+    for( policy = 0; policy < SXLATCH_POLICY_MAX; policy++ )
+    {
+        if( strcmp( name, __sxbench_policy_name[policy] ) == 0 )
+        {
+            return policy;
+        }
+    }
+
+    return -1;
+}
+
+int main( int argc, char * argv[] )
+{
+    sxbench_conf_t conf;
+    int opt = 0;
+
+    conf.thread_cnt = SXBENCH_DEFAULT_THREADS;
+    conf.msec       = SXBENCH_DEFAULT_MSEC;
+    conf.write_pct  = -1;
+    conf.policy     = -1;
+    conf.backoff    = false;
+    conf.recovery   = 0;
+
+    while( (opt = getopt( argc, argv, "t:d:w:p:br:" )) != -1 )
+    {
+        switch( opt )
+        {
+            case 't':
+                conf.thread_cnt = atoi( optarg );
+                break;
+            case 'd':
+                conf.msec = atoi( optarg );
+                break;
+            case 'w':
+                conf.write_pct = atoi( optarg );
+                break;
+            case 'p':
+                conf.policy = __sxbench_parse_policy( optarg );
+                if( conf.policy < 0 )
+                {
+                    goto usage;
+                }
+                break;
+            case 'b':
+                conf.backoff = true;
+                break;
+            case 'r':
+                conf.recovery = atoi( optarg );
+                if( conf.recovery <= 0 )
+                {
+                    goto usage;
+                }
+                break;
+            default:
+                goto usage;
+        }
+    }
+
+    if( conf.thread_cnt <= 0 || conf.msec <= 0 || conf.write_pct > 100 )
+    {
+        goto usage;
+    }
+
+    if( conf.recovery > 0 )
+    {
+        return ( __sxbench_run_recovery( &conf ) == RC_SUCCESS ) ? 0 : 1;
+    }
+
+    if( conf.backoff == true )
+    {
+        return ( __sxbench_run_backoff( &conf ) == RC_SUCCESS ) ? 0 : 1;
+    }
+
+    return ( __sxbench_run_rw( &conf ) == RC_SUCCESS ) ? 0 : 1;
+
+usage:
+    fprintf( stderr,
+             "usage: %s [-t threads] [-d msec] [-w write%%] [-p policy] [-b]\n"
+             "               [-r latches]\n"
+             "  policy: default, phase-fair, reader-pref, writer-pref, biased,\n"
+             "          asymmetric, bounded\n"
+             "  -b:     CAS backoff benchmark\n"
+             "  -r:     recovery benchmark, latches per dead session\n",
+             argv[0] );
+
+    return 1;
+}
@@ -9,6 +9,13 @@
 #include "util.h"
 #include "atomic.h"
 #include "rand_r.h"
+#include "session.h"
+#include "trace.h"
+#include "stat.h"
+#include "profile.h"
+#include "asym.h"
+#include "inflate.h"
+#include "async.h"
 
 #define DEFAULT_SXLATCH_X_YIELD_LOOP_COUNT    10
 #define DEFAULT_TASK_YIELD_LOOP_COUNT 10
@@ -22,15 +29,20 @@ int __sxlatch_X_yield_loop_cnt = DEFAULT_SXLATCH_X_YIELD_LOOP_COUNT;
 int __sxlatch_yield_loop_cnt =
     (DEFAULT_YIELD_LOOP_COUNT * DEFAULT_TASK_YIELD_LOOP_COUNT); // 100,000
 
+int __sxlatch_cas_backoff_max = SXLATCH_CAS_BACKOFF_MAX;
+__thread uint64_t __sxlatch_cas_fail_cnt = 0;
+
 extern long task_get_intlock_timeout( void );
 
 
-#if 1 // need to implement with session structure
-bool is_session_interrupted( void /* session_t sess */ )
+/* a waiter gives up: a one-shot interrupt is taken */
+bool is_session_interrupted( sxlatch_session_t * sess )
 {
-    return false;
+    return sxlatch_session_take_interrupt( sess );
 }
 
+#if 1 // need to implement with session structure
+
 int get_session_id( void /* session_t sess */ )
 {
     /* In open source version of latch,
@@ -59,6 +71,8 @@ int sxlatch_trysxlock( sxlatch_t * r, session_id_t session_id );
 int sxlatch_intrdlock( sxlatch_t * r, session_id_t session_id );
 int sxlatch_intwrlock( sxlatch_t * r, session_id_t session_id );
 int sxlatch_unlock( sxlatch_t * r, session_id_t session_id );
+int sxlatch_rdunlock( sxlatch_t * r, session_id_t session_id );
+int sxlatch_wrunlock( sxlatch_t * r, session_id_t session_id );
 
 
 int __sxlatch_unlock_for_recovery( sxlatch_t * r,
@@ -66,6 +80,569 @@ int __sxlatch_unlock_for_recovery( sxlatch_t * r,
                                    int         request_session_id );
 int sxlatch_set_cleanup_progress( sxlatch_t * r, bool is_cleanup );
 
+static void __sxlatch_unblock_x( sxlatch_t * r, session_id_t session_id );
+
+/* reader/writer policy
+ * Every latch is bound to one row of __sxlatch_policy_ops at
+ * sxlatch_init_attr(): the public functions jump through it and the
+ * policy is never tested on the acquisition paths. */
+typedef struct _sxlatch_policy_ops sxlatch_policy_ops_t;
+struct _sxlatch_policy_ops
+{
+    int (*Xlock)( sxlatch_t * r, session_id_t session_id, const void * caller );
+    int (*intXlock)( sxlatch_t * r, session_id_t session_id, const void * caller );
+    int (*rdlock)( sxlatch_t * r, session_id_t session_id, const void * caller );
+    int (*tryrdlock)( sxlatch_t * r, session_id_t session_id );
+    int (*wrlock)( sxlatch_t * r, session_id_t session_id, const void * caller );
+    int (*trywrlock)( sxlatch_t * r, session_id_t session_id );
+    int (*intrdlock)( sxlatch_t * r, session_id_t session_id, const void * caller );
+    int (*intwrlock)( sxlatch_t * r, session_id_t session_id, const void * caller );
+    int (*unlock)( sxlatch_t * r, session_id_t session_id );
+    /* release of a known mode, without the dispatch on value */
+    int (*rdunlock)( sxlatch_t * r, session_id_t session_id );
+    int (*wrunlock)( sxlatch_t * r, session_id_t session_id );
+    /* X was taken on value without the policy(no session):
+     * wait until the holders which the policy keeps aside are gone */
+    int (*settle)( sxlatch_t * r );
+};
+
+static int __sxlatch_Xlock_default( sxlatch_t *  r,
+                                    session_id_t session_id,
+                                    const void * caller );
+static int __sxlatch_intXlock_default( sxlatch_t *  r,
+                                       session_id_t session_id,
+                                       const void * caller );
+static int __sxlatch_rdlock_default( sxlatch_t *  r,
+                                     session_id_t session_id,
+                                     const void * caller );
+static int __sxlatch_tryrdlock_default( sxlatch_t * r, session_id_t session_id );
+static int __sxlatch_wrlock_default( sxlatch_t *  r,
+                                     session_id_t session_id,
+                                     const void * caller );
+static int __sxlatch_trywrlock_default( sxlatch_t * r, session_id_t session_id );
+static int __sxlatch_intrdlock_default( sxlatch_t *  r,
+                                        session_id_t session_id,
+                                        const void * caller );
+static int __sxlatch_intwrlock_default( sxlatch_t *  r,
+                                        session_id_t session_id,
+                                        const void * caller );
+static int __sxlatch_unlock_default( sxlatch_t * r, session_id_t session_id );
+static int __sxlatch_rdunlock_default( sxlatch_t * r, session_id_t session_id );
+static int __sxlatch_wrunlock_default( sxlatch_t * r, session_id_t session_id );
+static int __sxlatch_settle_default( sxlatch_t * r );
+
+static int __sxlatch_rdlock_phase_fair( sxlatch_t *  r,
+                                        session_id_t session_id,
+                                        const void * caller );
+static int __sxlatch_intrdlock_phase_fair( sxlatch_t *  r,
+                                           session_id_t session_id,
+                                           const void * caller );
+static int __sxlatch_unlock_phase_fair( sxlatch_t * r, session_id_t session_id );
+
+static int __sxlatch_rdlock_reader_pref( sxlatch_t *  r,
+                                         session_id_t session_id,
+                                         const void * caller );
+static int __sxlatch_tryrdlock_reader_pref( sxlatch_t * r, session_id_t session_id );
+static int __sxlatch_intrdlock_reader_pref( sxlatch_t *  r,
+                                            session_id_t session_id,
+                                            const void * caller );
+
+static int __sxlatch_rdlock_writer_pref( sxlatch_t *  r,
+                                         session_id_t session_id,
+                                         const void * caller );
+static int __sxlatch_tryrdlock_writer_pref( sxlatch_t * r, session_id_t session_id );
+static int __sxlatch_wrlock_writer_pref( sxlatch_t *  r,
+                                         session_id_t session_id,
+                                         const void * caller );
+static int __sxlatch_intrdlock_writer_pref( sxlatch_t *  r,
+                                            session_id_t session_id,
+                                            const void * caller );
+static int __sxlatch_intwrlock_writer_pref( sxlatch_t *  r,
+                                            session_id_t session_id,
+                                            const void * caller );
+
+static int __sxlatch_Xlock_biased( sxlatch_t *  r,
+                                   session_id_t session_id,
+                                   const void * caller );
+static int __sxlatch_intXlock_biased( sxlatch_t *  r,
+                                      session_id_t session_id,
+                                      const void * caller );
+static int __sxlatch_rdlock_biased( sxlatch_t *  r,
+                                    session_id_t session_id,
+                                    const void * caller );
+static int __sxlatch_tryrdlock_biased( sxlatch_t * r, session_id_t session_id );
+static int __sxlatch_wrlock_biased( sxlatch_t *  r,
+                                    session_id_t session_id,
+                                    const void * caller );
+static int __sxlatch_trywrlock_biased( sxlatch_t * r, session_id_t session_id );
+static int __sxlatch_intrdlock_biased( sxlatch_t *  r,
+                                       session_id_t session_id,
+                                       const void * caller );
+static int __sxlatch_intwrlock_biased( sxlatch_t *  r,
+                                       session_id_t session_id,
+                                       const void * caller );
+static int __sxlatch_unlock_biased( sxlatch_t * r, session_id_t session_id );
+static int __sxlatch_revoke_biased( sxlatch_t * r );
+
+static int __sxlatch_Xlock_asym( sxlatch_t *  r,
+                                 session_id_t session_id,
+                                 const void * caller );
+static int __sxlatch_intXlock_asym( sxlatch_t *  r,
+                                    session_id_t session_id,
+                                    const void * caller );
+static int __sxlatch_rdlock_asym( sxlatch_t *  r,
+                                  session_id_t session_id,
+                                  const void * caller );
+static int __sxlatch_tryrdlock_asym( sxlatch_t * r, session_id_t session_id );
+static int __sxlatch_wrlock_asym( sxlatch_t *  r,
+                                  session_id_t session_id,
+                                  const void * caller );
+static int __sxlatch_trywrlock_asym( sxlatch_t * r, session_id_t session_id );
+static int __sxlatch_intrdlock_asym( sxlatch_t *  r,
+                                     session_id_t session_id,
+                                     const void * caller );
+static int __sxlatch_intwrlock_asym( sxlatch_t *  r,
+                                     session_id_t session_id,
+                                     const void * caller );
+static int __sxlatch_unlock_asym( sxlatch_t * r, session_id_t session_id );
+static int __sxlatch_drain_asym( sxlatch_t * r );
+
+static int __sxlatch_rdlock_inflated( sxlatch_t *  r,
+                                      session_id_t session_id,
+                                      const void * caller );
+static int __sxlatch_tryrdlock_inflated( sxlatch_t * r, session_id_t session_id );
+static int __sxlatch_intrdlock_inflated( sxlatch_t *  r,
+                                         session_id_t session_id,
+                                         const void * caller );
+static int __sxlatch_unlock_inflated( sxlatch_t * r, session_id_t session_id );
+static int __sxlatch_drain_inflated( sxlatch_t * r );
+static inline int __sxlatch_x_drain( sxlatch_t *         r,
+                                     int64_t             xvalue,
+                                     sxlatch_session_t * sess );
+static void __sxlatch_inflate( sxlatch_t * r );
+
+static int __sxlatch_rdlock_bounded( sxlatch_t *  r,
+                                     session_id_t session_id,
+                                     const void * caller );
+static int __sxlatch_tryrdlock_bounded( sxlatch_t * r, session_id_t session_id );
+static int __sxlatch_intrdlock_bounded( sxlatch_t *  r,
+                                        session_id_t session_id,
+                                        const void * caller );
+static int __sxlatch_unlock_bounded( sxlatch_t * r, session_id_t session_id );
+static int __sxlatch_rdunlock_bounded( sxlatch_t * r, session_id_t session_id );
+
+static const sxlatch_policy_ops_t __sxlatch_policy_ops[SXLATCH_POLICY_MAX + 1] = {
+    /* SXLATCH_POLICY_DEFAULT */
+    {
+        __sxlatch_Xlock_default,
+        __sxlatch_intXlock_default,
+        __sxlatch_rdlock_default,
+        __sxlatch_tryrdlock_default,
+        __sxlatch_wrlock_default,
+        __sxlatch_trywrlock_default,
+        __sxlatch_intrdlock_default,
+        __sxlatch_intwrlock_default,
+        __sxlatch_unlock_default,
+        __sxlatch_rdunlock_default,
+        __sxlatch_wrunlock_default,
+        __sxlatch_settle_default
+    },
+    /* SXLATCH_POLICY_PHASE_FAIR: writers are the default ones */
+    {
+        __sxlatch_Xlock_default,
+        __sxlatch_intXlock_default,
+        __sxlatch_rdlock_phase_fair,
+        __sxlatch_tryrdlock_default,
+        __sxlatch_wrlock_default,
+        __sxlatch_trywrlock_default,
+        __sxlatch_intrdlock_phase_fair,
+        __sxlatch_intwrlock_default,
+        __sxlatch_unlock_phase_fair,
+        __sxlatch_rdunlock_default,
+        __sxlatch_unlock_phase_fair,
+        __sxlatch_settle_default
+    },
+    /* SXLATCH_POLICY_READER_PREF */
+    {
+        __sxlatch_Xlock_default,
+        __sxlatch_intXlock_default,
+        __sxlatch_rdlock_reader_pref,
+        __sxlatch_tryrdlock_reader_pref,
+        __sxlatch_wrlock_default,
+        __sxlatch_trywrlock_default,
+        __sxlatch_intrdlock_reader_pref,
+        __sxlatch_intwrlock_default,
+        __sxlatch_unlock_default,
+        __sxlatch_rdunlock_default,
+        __sxlatch_wrunlock_default,
+        __sxlatch_settle_default
+    },
+    /* SXLATCH_POLICY_WRITER_PREF */
+    {
+        __sxlatch_Xlock_default,
+        __sxlatch_intXlock_default,
+        __sxlatch_rdlock_writer_pref,
+        __sxlatch_tryrdlock_writer_pref,
+        __sxlatch_wrlock_writer_pref,
+        __sxlatch_trywrlock_default,
+        __sxlatch_intrdlock_writer_pref,
+        __sxlatch_intwrlock_writer_pref,
+        __sxlatch_unlock_default,
+        __sxlatch_rdunlock_default,
+        __sxlatch_wrunlock_default,
+        __sxlatch_settle_default
+    },
+    /* SXLATCH_POLICY_BIASED */
+    {
+        __sxlatch_Xlock_biased,
+        __sxlatch_intXlock_biased,
+        __sxlatch_rdlock_biased,
+        __sxlatch_tryrdlock_biased,
+        __sxlatch_wrlock_biased,
+        __sxlatch_trywrlock_biased,
+        __sxlatch_intrdlock_biased,
+        __sxlatch_intwrlock_biased,
+        __sxlatch_unlock_biased,
+        __sxlatch_unlock_biased,
+        __sxlatch_unlock_biased,
+        __sxlatch_revoke_biased
+    },
+    /* SXLATCH_POLICY_ASYMMETRIC */
+    {
+        __sxlatch_Xlock_asym,
+        __sxlatch_intXlock_asym,
+        __sxlatch_rdlock_asym,
+        __sxlatch_tryrdlock_asym,
+        __sxlatch_wrlock_asym,
+        __sxlatch_trywrlock_asym,
+        __sxlatch_intrdlock_asym,
+        __sxlatch_intwrlock_asym,
+        __sxlatch_unlock_asym,
+        __sxlatch_unlock_asym,
+        __sxlatch_unlock_asym,
+        __sxlatch_drain_asym
+    },
+    /* SXLATCH_POLICY_BOUNDED: writers are the default ones */
+    {
+        __sxlatch_Xlock_default,
+        __sxlatch_intXlock_default,
+        __sxlatch_rdlock_bounded,
+        __sxlatch_tryrdlock_bounded,
+        __sxlatch_wrlock_default,
+        __sxlatch_trywrlock_default,
+        __sxlatch_intrdlock_bounded,
+        __sxlatch_intwrlock_default,
+        __sxlatch_unlock_bounded,
+        __sxlatch_rdunlock_bounded,
+        __sxlatch_wrunlock_default,
+        __sxlatch_settle_default
+    },
+    /* SXLATCH_POLICY_INFLATED(inflate.h): a DEFAULT latch under contention,
+     * the default writers drain the shards themselves */
+    {
+        __sxlatch_Xlock_default,
+        __sxlatch_intXlock_default,
+        __sxlatch_rdlock_inflated,
+        __sxlatch_tryrdlock_inflated,
+        __sxlatch_wrlock_default,
+        __sxlatch_trywrlock_default,
+        __sxlatch_intrdlock_inflated,
+        __sxlatch_intwrlock_default,
+        __sxlatch_unlock_inflated,
+        __sxlatch_unlock_inflated,
+        __sxlatch_unlock_inflated,
+        __sxlatch_drain_inflated
+    }
+};
+
+/* S admission of a policy: may a reader add itself to oldvalue?
+ * The reader paths are templates instantiated once per policy with a
+ * constant admission function, which is inlined. */
+typedef bool (*sxlatch_admit_func_t)( sxlatch_t * r, int64_t oldvalue );
+
+/* default: not while a writer is in or blocks */
+static inline bool __sxlatch_admit_default( sxlatch_t * r, int64_t oldvalue )
+{
+    (void)r;
+    return ( SXLATCH_GET_MODE( oldvalue ) == SXLATCH_MODE_S ) ? true : false;
+}
+
+/* reader preference: a blocking writer does not stop readers,
+ * it waits until no reader is left */
+static inline bool __sxlatch_admit_reader_pref( sxlatch_t * r, int64_t oldvalue )
+{
+    (void)r;
+    return ( SXLATCH_GET_MODE( oldvalue ) != SXLATCH_MODE_X_ACQUIRED ) ? true : false;
+}
+
+/* writer preference: not while any writer waits(policy_word: waiting
+ * writers), so writers go one after another before the readers */
+static inline bool __sxlatch_admit_writer_pref( sxlatch_t * r, int64_t oldvalue )
+{
+    return ( SXLATCH_GET_MODE( oldvalue ) == SXLATCH_MODE_S &&
+             r->policy_word == 0 ) ? true : false;
+}
+
+/* bounded share: as default, below the share limit(aux_word) only */
+static inline bool __sxlatch_admit_bounded( sxlatch_t * r, int64_t oldvalue )
+{
+    int32_t limit = r->aux_word;
+
+    return ( SXLATCH_GET_MODE( oldvalue ) == SXLATCH_MODE_S &&
+             ( limit <= 0 ||
+               SXLATCH_GET_SHARED_CNT( oldvalue ) < (int64_t)limit ) ) ? true : false;
+}
+
+#define SXLATCH_BOUNDED_PARK_USEC     1000
+
+/* shared_cnt is the low half of value(little endian): readers parked at
+ * the share limit sleep on it, any leaving reader changes it */
+static inline volatile int32_t * __sxlatch_shared_cnt_word( sxlatch_t * r )
+{
+    return (volatile int32_t *)&(SXLATCH_GET_VALUE( r ));
+}
+
+/* a reader refused by the share limit sleeps until a reader leaves
+ * (policy_word: parked readers). false: refused by a writer, wait as
+ * the default readers do. */
+static inline bool __sxlatch_park_bounded( sxlatch_t * r, int64_t oldvalue )
+{
+    if( SXLATCH_GET_MODE( oldvalue ) != SXLATCH_MODE_S )
+    {
+        return false;
+    }
+
+    atomic_fetch_inc( &(r->policy_word) );
+    (void)futex_wait( __sxlatch_shared_cnt_word( r ),
+                      (int32_t)SXLATCH_GET_SHARED_CNT( oldvalue ),
+                      SXLATCH_BOUNDED_PARK_USEC );
+    atomic_fetch_dec( &(r->policy_word) );
+
+    return true;
+}
+
+/* a CAS on value failed: back off for a random number of PAUSEs below
+ * a window which doubles at each failure of the loop(*backoff: 0 at its
+ * start) up to __sxlatch_cas_backoff_max, so that retries spread out
+ * instead of colliding again */
+static inline void __sxlatch_cas_backoff( uint32_t * backoff )
+{
+    uint32_t spins = 0;
+
+    __sxlatch_cas_fail_cnt++;
+
+    if( __sxlatch_cas_backoff_max <= 0 )
+    {
+        return;
+    }
+
+    if( *backoff == 0 )
+    {
+        *backoff = SXLATCH_CAS_BACKOFF_MIN;
+    }
+    else if( *backoff < (uint32_t)__sxlatch_cas_backoff_max )
+    {
+        *backoff <<= 1;
+    }
+
+    spins = RNG_thread_generate() % *backoff;
+    while( spins-- > 0 )
+    {
+        cpu_relax();
+    }
+}
+
+/* publish the latch which the session waits for(watchdog) */
+static inline void __sxlatch_set_waiting( sxlatch_session_t * sess,
+                                          sxlatch_t         * r )
+{
+    if( sess != NULL )
+    {
+        sess->waiting_latch = r;
+
+        /* the wait is over: a one-shot interrupt was for it only */
+        if( r == NULL && sess->interrupted == SXLATCH_SESSION_INTERRUPT_ONCE )
+        {
+            sxlatch_session_drop_interrupt_once( sess );
+        }
+    }
+}
+
+/* owner-aware spinning
+ * Spinning for an X held by a session which is off cpu cannot make any
+ * progress: park until the owner runs again. The park is bounded since X
+ * may also be released on behalf of the owner(recovery), and an int*lock
+ * waiter sees its interrupt at the next round at the latest.
+ * The default writers and the readers of the rw templates park; the
+ * waits of PHASE_FAIR readers, inflated shards, ASYMMETRIC and BIASED
+ * do not. */
+#define SXLATCH_OWNER_PARK_USEC     1000
+
+static inline bool __sxlatch_park_on_owner( int64_t value )
+{
+    sxlatch_session_t * owner = NULL;
+
+    if( SXLATCH_GET_MODE( value ) != SXLATCH_MODE_X_ACQUIRED )
+    {
+        return false;
+    }
+
+    owner = sxlatch_session_find( (session_id_t)SXLATCH_GET_SESSION_ID( value ) );
+    if( owner == NULL || owner->off_cpu <= 0 )
+    {
+        return false;
+    }
+
+    sxlatch_session_wait_on_cpu( owner, SXLATCH_OWNER_PARK_USEC );
+
+    return true;
+}
+
+/* contention score of a DEFAULT latch(aux_word)
+ * A failed CAS on value, or a reader which steps back for a writer, raises
+ * it and an acquisition without any retry lowers it: it only grows under
+ * sustained contention. Readers overlapping each other do not raise it:
+ * their fetch-and-add never fails. A step back is two atomic writes to
+ * value under a writer's CAS; readers of an inflated latch only read
+ * value, so those writes are what inflation takes off the writers. The
+ * latch inflates when the score reaches __sxlatch_inflate_threshold. The
+ * score is a hint, its updates are plain. */
+static inline void __sxlatch_on_cas_failure( sxlatch_t * r )
+{
+    if( r->policy == SXLATCH_POLICY_DEFAULT &&
+        __sxlatch_inflate_threshold > 0 &&
+        ++(r->aux_word) >= __sxlatch_inflate_threshold )
+    {
+        __sxlatch_inflate( r );
+    }
+}
+
+static inline void __sxlatch_on_cas_success( sxlatch_t * r )
+{
+    if( r->aux_word > 0 )
+    {
+        r->aux_word--;
+    }
+}
+
+/* optimistic S entry(DEFAULT): count in with one fetch-and-add, and step
+ * back if a writer was in. The X releases subtract their bits, so a count
+ * which is stepping back is never lost. Readers overlapping each other do
+ * not conflict: only a step back counts as contention. */
+static inline bool __sxlatch_enter_s_xadd( sxlatch_t * r, bool inflatable )
+{
+    int64_t oldvalue = atomic_fetch_add( &(SXLATCH_GET_VALUE( r )), 1 );
+
+    if( SXLATCH_GET_MODE( oldvalue ) != SXLATCH_MODE_S )
+    {
+        (void)atomic_fetch_sub( &(SXLATCH_GET_VALUE( r )), 1 );
+        if( inflatable == true )
+        {
+            __sxlatch_on_cas_failure( r );
+        }
+        return false;
+    }
+
+    if( inflatable == true )
+    {
+        __sxlatch_on_cas_success( r );
+    }
+
+    return true;
+}
+
+/* instrumentation hooks(trace, statistics)
+ * mode: BF_LATCH_MODE_S or BF_LATCH_MODE_X_ACQUIRED */
+static inline uint64_t __sxlatch_on_request( sxlatch_t *  r,
+                                             session_id_t session_id,
+                                             int          mode )
+{
+    SXLATCH_TRACE( r, SXLATCH_TRACE_REQUEST, session_id, mode );
+
+    return ( __builtin_expect( __sxlatch_stat_enabled, 0 ) ) ? get_time() : 0;
+}
+
+static inline void __sxlatch_on_acquire( sxlatch_t *  r,
+                                         session_id_t session_id,
+                                         int          mode,
+                                         uint64_t     wait_begin )
+{
+    uint64_t now = 0;
+    int stat_mode = ( mode == BF_LATCH_MODE_S ) ?
+                    SXLATCH_STAT_MODE_S : SXLATCH_STAT_MODE_X;
+
+    SXLATCH_TRACE( r, SXLATCH_TRACE_ACQUIRE, session_id, mode );
+
+    if( __builtin_expect( __sxlatch_stat_enabled, 0 ) )
+    {
+        now = get_time();
+        if( wait_begin != 0 )
+        {
+            sxlatch_stat_record_wait( r, stat_mode, now - wait_begin );
+        }
+        sxlatch_stat_hold_begin( r, stat_mode, now );
+    }
+}
+
+/* contention hooks: called in the slow path only
+ * __sxlatch_on_contention(): the first backoff of an acquisition
+ * __sxlatch_on_contended_acquire(): the acquisition finally succeeded
+ * __sxlatch_on_contended_fail(): the acquisition gave up */
+static inline uint64_t __sxlatch_on_contention( void )
+{
+    return get_time();
+}
+
+static inline void __sxlatch_on_contended_acquire( sxlatch_t *  r,
+                                                   session_id_t session_id,
+                                                   int          mode,
+                                                   uint64_t     contended_at,
+                                                   const void * caller )
+{
+    uint64_t waited = 0;
+
+    if( contended_at != 0 )
+    {
+        waited = get_time() - contended_at;
+
+        sxlatch_stat_record_session_wait( r, session_id,
+                                          ( mode == BF_LATCH_MODE_S ) ?
+                                          SXLATCH_STAT_MODE_S : SXLATCH_STAT_MODE_X,
+                                          waited );
+
+        if( __sxlatch_profile_period != 0 )
+        {
+            sxlatch_profile_record( caller, mode, waited );
+        }
+    }
+}
+
+static inline void __sxlatch_on_contended_fail( sxlatch_t *  r,
+                                                session_id_t session_id,
+                                                int          mode,
+                                                uint64_t     contended_at )
+{
+    if( contended_at != 0 )
+    {
+        sxlatch_stat_record_session_wait( r, session_id,
+                                          ( mode == BF_LATCH_MODE_S ) ?
+                                          SXLATCH_STAT_MODE_S : SXLATCH_STAT_MODE_X,
+                                          get_time() - contended_at );
+    }
+}
+
+static inline void __sxlatch_on_release( sxlatch_t *  r,
+                                         session_id_t session_id,
+                                         int          mode )
+{
+    SXLATCH_TRACE( r, SXLATCH_TRACE_RELEASE, session_id, mode );
+
+    if( __builtin_expect( __sxlatch_stat_enabled, 0 ) )
+    {
+        sxlatch_stat_hold_end( r, get_time() );
+    }
+}
+
 bool sxlatch_is_unlock( sxlatch_t * r )
 {
     return ( r != NULL && r->value == SXLATCH_UNLOCKED ) ?
@@ -78,35 +655,215 @@ int sxlatch_init( sxlatch_t * r )
     return RC_SUCCESS;
 }
 
-#define SESSION_WAIT_TIME_UNIT      10	/* 10 msec. */
-#define SESSION_RDLOCK_TIMEOUT   (100 * SESSION_WAIT_TIME_UNIT)	/* 1 sec. */
+int sxlatch_attr_init( sxlatch_attr_t * attr )
+{
+    TRY( attr == NULL );
+
+    memset( attr, 0x00, sizeof(sxlatch_attr_t) );
+    attr->latch_class = SXLATCH_CLASS_DEFAULT;
+    attr->policy      = SXLATCH_POLICY_DEFAULT;
 
-int sxlatch_destroy( sxlatch_t * r )
+    return RC_SUCCESS;
+
+    CATCH_END;
+
+    return RC_FAIL;
+}
+
+int sxlatch_attr_setclass( sxlatch_attr_t * attr, int latch_class )
+{
+    TRY( attr == NULL );
+    TRY( latch_class < 0 || latch_class >= SXLATCH_CLASS_MAX );
+
+    attr->latch_class = latch_class;
+
+    return RC_SUCCESS;
+
+    CATCH_END;
+
+    return RC_FAIL;
+}
+
+int sxlatch_attr_setpolicy( sxlatch_attr_t * attr, int policy )
+{
+    TRY( attr == NULL );
+    TRY( policy < 0 || policy >= SXLATCH_POLICY_MAX );
+
+    attr->policy = policy;
+
+    return RC_SUCCESS;
+
+    CATCH_END;
+
+    return RC_FAIL;
+}
+
+int sxlatch_attr_setsharelimit( sxlatch_attr_t * attr, int share_limit )
+{
+    TRY( attr == NULL || share_limit < 0 );
+
+    attr->share_limit = share_limit;
+
+    return RC_SUCCESS;
+
+    CATCH_END;
+
+    return RC_FAIL;
+}
+
+int sxlatch_init_attr( sxlatch_t * r, const sxlatch_attr_t * attr )
+{
+    memset( r, 0x00, sizeof(sxlatch_t) );
+
+    if( attr != NULL )
+    {
+        TRY( attr->latch_class < 0 || attr->latch_class >= SXLATCH_CLASS_MAX );
+        TRY( attr->policy < 0 || attr->policy >= SXLATCH_POLICY_MAX );
+        r->latch_class = (uint16_t)attr->latch_class;
+        r->policy      = (uint8_t)attr->policy;
+
+        if( r->policy == SXLATCH_POLICY_BOUNDED )
+        {
+            TRY( attr->share_limit < 0 );
+            r->aux_word = attr->share_limit;
+        }
+
+        if( ( r->policy == SXLATCH_POLICY_BIASED ||
+              r->policy == SXLATCH_POLICY_ASYMMETRIC ) &&
+            process_membarrier_supported() == false )
+        {
+            /* revocation cannot be done */
+            r->policy = SXLATCH_POLICY_DEFAULT;
+        }
+    }
+
+    return RC_SUCCESS;
+
+    CATCH_END;
+
+    return RC_FAIL;
+}
+
+/* destroy drain
+ * A latch being cleaned up(cleanup_in_progress_cnt) and still held is
+ * waited for before it is destroyed. The recovery wakes the destroyers
+ * up when it releases a latch or finishes its cleanup: drain_seq is the
+ * futex word, drain_waiters tells whether anyone sleeps on it. */
+static volatile int32_t __sxlatch_drain_seq     = 0;
+static volatile int32_t __sxlatch_drain_waiters = 0;
+
+static inline bool __sxlatch_is_draining( sxlatch_t * r )
+{
+    return ( r->cleanup_in_progress_cnt > 0 &&
+             SXLATCH_GET_VALUE( r ) != SXLATCH_UNLOCKED ) ? true : false;
+}
+
+static void __sxlatch_drain_notify( void )
 {
-    int elapsed_sleep_time = 0;
-    /* 비정상종료 세션을 처리중일 수 있으므로 대기한다.
-     * 그러나, 무한정 대기할수는 없다.*/
-    while( r->cleanup_in_progress_cnt > 0 &&
-           SXLATCH_GET_VALUE( r ) != SXLATCH_UNLOCKED )
+    atomic_inc_fetch( &__sxlatch_drain_seq );
+
+    if( __sxlatch_drain_waiters > 0 )
+    {
+        (void)futex_wake( &__sxlatch_drain_seq, 0 /* all */ );
+    }
+    SXLATCH_ASYNC_NOTIFY();
+}
+
+/* wait until r drained, at most timeout_msec since begin(get_time()) */
+static int __sxlatch_wait_drain( sxlatch_t * r, uint64_t begin, uint64_t timeout_msec )
+{
+    uint64_t timeout_usec = timeout_msec * 1000;
+    uint64_t elapsed_usec = 0;
+    int32_t seq = 0;
+
+    while( true )
     {
-        /* 1 초만 대기한다 */
-        if( elapsed_sleep_time >= SESSION_RDLOCK_TIMEOUT )
+        /* read before the check: a release after it moves the sequence */
+        seq = __sxlatch_drain_seq;
+        mem_barrier();
+
+        if( __sxlatch_is_draining( r ) == false )
+        {
             break;
+        }
+
+        elapsed_usec = (uint64_t)(get_elapsed_time( get_time() - begin ) / 1000.0);
+        TRY( elapsed_usec >= timeout_usec );
+
+        atomic_inc_fetch( &__sxlatch_drain_waiters );
+        (void)futex_wait( &__sxlatch_drain_seq, seq, timeout_usec - elapsed_usec );
+        atomic_dec_fetch( &__sxlatch_drain_waiters );
+    }
+
+    return RC_SUCCESS;
+
+    CATCH_END;
 
-        thread_sleep( 0, 1 );
+    return RC_ERR_LOCK_TIMEOUT;
+}
 
-        elapsed_sleep_time  += SESSION_WAIT_TIME_UNIT;
+static void __sxlatch_release( sxlatch_t * r )
+{
+    if( r->policy == SXLATCH_POLICY_INFLATED )
+    {
+        sxlatch_inflated_free( r->policy_word );
+        sxlatch_inflate_count( false );
     }
 
     memset( r, 0x00, sizeof(sxlatch_t) );
+}
+
+int sxlatch_destroy( sxlatch_t * r )
+{
+    return sxlatch_destroy_timed( r, SXLATCH_DESTROY_TIMEOUT_MSEC );
+}
+
+int sxlatch_destroy_timed( sxlatch_t * r, uint64_t timeout_msec )
+{
+    /* a dead session may be cleaned up: wait for it, but not forever */
+    TRY( __sxlatch_wait_drain( r, get_time(), timeout_msec ) != RC_SUCCESS );
+
+    __sxlatch_release( r );
 
     return RC_SUCCESS;
+
+    CATCH_END;
+
+    return RC_ERR_LOCK_TIMEOUT;
+}
+
+int sxlatch_destroy_bulk( sxlatch_t * first,
+                          size_t      cnt,
+                          size_t      stride,
+                          uint64_t    timeout_msec )
+{
+    uint64_t begin = get_time();
+    sxlatch_t * r = NULL;
+    size_t idx = 0;
+    int ret = RC_SUCCESS;
+
+    for( idx = 0; idx < cnt; idx++ )
+    {
+        r = (sxlatch_t *)((char *)first + idx * stride);
+
+        /* one deadline for all of them */
+        if( __sxlatch_wait_drain( r, begin, timeout_msec ) != RC_SUCCESS )
+        {
+            ret = RC_ERR_LOCK_TIMEOUT;
+            continue;
+        }
+
+        __sxlatch_release( r );
+    }
+
+    return ret;
 }
 
 int sxlatch_Xlock_no_session( sxlatch_t * r )
 {
     int yield_cnt = __sxlatch_X_yield_loop_cnt;
     int ret       = 0;
+    uint64_t wait_begin = 0;
     int64_t oldvalue = SXLATCH_UNLOCKED;
     int64_t newvalue = 0;
     bool continue_loop = true;
@@ -117,6 +874,8 @@ int sxlatch_Xlock_no_session( sxlatch_t * r )
     newvalue = SXLATCH_MAKE_LATCH_VALUE( SXLATCH_MODE_X_ACQUIRED,
                                          session_id,
                                          0 /* shared cnt */);
+    wait_begin = __sxlatch_on_request( r, session_id, BF_LATCH_MODE_X_ACQUIRED );
+
     while( continue_loop == true )
     {
         mem_barrier();
@@ -128,6 +887,8 @@ int sxlatch_Xlock_no_session( sxlatch_t * r )
                                            newvalue ) )
             {
                 /* success to aqcire X latch */
+                (void)__sxlatch_policy_ops[r->policy].settle( r );
+                __sxlatch_on_acquire( r, session_id, BF_LATCH_MODE_X_ACQUIRED, wait_begin );
                 continue_loop = false;
                 continue;
             }
@@ -152,6 +913,7 @@ int sxlatch_Xlock_no_session( sxlatch_t * r )
 
     CATCH( err_cleanup_progress )
     {
+        SXLATCH_TRACE( r, SXLATCH_TRACE_TIMEOUT, session_id, BF_LATCH_MODE_X_ACQUIRED );
         ret = RC_ERR_LOCK_TIMEOUT;
     }
     CATCH_END;
@@ -162,6 +924,7 @@ int sxlatch_Xlock_no_session( sxlatch_t * r )
 int sxlatch_unlock_no_session( sxlatch_t * r )
 {
     volatile int64_t oldvalue = 0;
+    uint32_t backoff = 0;
 
     bool continue_loop = true;
 
@@ -169,23 +932,33 @@ int sxlatch_unlock_no_session( sxlatch_t * r )
     {
         oldvalue = SXLATCH_GET_VALUE( r );
 
+        /* keep the count of optimistic readers stepping back */
         if( oldvalue == atomic_cas_64( &(SXLATCH_GET_VALUE( r )),
                                        oldvalue,
-                                       SXLATCH_UNLOCKED ) )
+                                       SXLATCH_GET_SHARED_CNT( oldvalue ) ) )
         {
             /* success to aqcire X latch */
+            __sxlatch_on_release( r, SXLATCH_MAX_SESSION_ID, BF_LATCH_MODE_X_ACQUIRED );
             continue_loop = false;
             break;
         }
+
+        __sxlatch_cas_backoff( &backoff );
     }
 
+    SXLATCH_ASYNC_NOTIFY();
+
     return RC_SUCCESS;
 }
 
-int sxlatch_Xlock( sxlatch_t * r, session_id_t session_id )
+static int __sxlatch_Xlock_default( sxlatch_t *  r,
+                                    session_id_t session_id,
+                                    const void * caller )
 {
     int yield_cnt = __sxlatch_X_yield_loop_cnt;
     int ret       = 0;
+    uint64_t wait_begin = 0;
+    uint64_t contended_at = 0;
     int64_t oldvalue = SXLATCH_UNLOCKED;
     int64_t newvalue = 0;
 
@@ -196,6 +969,8 @@ int sxlatch_Xlock( sxlatch_t * r, session_id_t session_id )
     newvalue = SXLATCH_MAKE_LATCH_VALUE( SXLATCH_MODE_X_ACQUIRED,
                                          session_id,
                                          0 /* shared cnt */);
+    wait_begin = __sxlatch_on_request( r, session_id, BF_LATCH_MODE_X_ACQUIRED );
+
     while( continue_loop == true )
     {
         mem_barrier();
@@ -207,13 +982,26 @@ int sxlatch_Xlock( sxlatch_t * r, session_id_t session_id )
                                            newvalue ) )
             {
                 /* success to aqcire X latch */
+                (void)__sxlatch_x_drain( r, newvalue, NULL );
+                __sxlatch_on_acquire( r, session_id, BF_LATCH_MODE_X_ACQUIRED, wait_begin );
+                __sxlatch_on_contended_acquire( r, session_id, BF_LATCH_MODE_X_ACQUIRED, contended_at,
+                                                 caller );
                 continue_loop = false;
                 continue;
             }
         }
 
 
-        if( yield_cnt-- > 0 )
+        if( contended_at == 0 )
+        {
+            contended_at = __sxlatch_on_contention();
+        }
+
+        if( __sxlatch_park_on_owner( SXLATCH_GET_VALUE( r ) ) == true )
+        {
+            /* the owner was off cpu */
+        }
+        else if( yield_cnt-- > 0 )
         {
             sched_yield();
         }
@@ -232,6 +1020,7 @@ int sxlatch_Xlock( sxlatch_t * r, session_id_t session_id )
 
     CATCH( err_cleanup_progress )
     {
+        SXLATCH_TRACE( r, SXLATCH_TRACE_TIMEOUT, session_id, BF_LATCH_MODE_X_ACQUIRED );
         ret = RC_ERR_LOCK_TIMEOUT;
     }
     CATCH_END;
@@ -239,22 +1028,30 @@ int sxlatch_Xlock( sxlatch_t * r, session_id_t session_id )
     return ret;
 }
 
-int sxlatch_intXlock( sxlatch_t * r, session_id_t session_id )
+static int __sxlatch_intXlock_default( sxlatch_t *  r,
+                                       session_id_t session_id,
+                                       const void * caller )
 {
     int yield_cnt = __sxlatch_X_yield_loop_cnt;
     int ret       = 0;
+    uint64_t wait_begin = 0;
+    uint64_t contended_at = 0;
     int64_t oldvalue = SXLATCH_UNLOCKED;
     int64_t newvalue = 0;
     bool continue_loop = true;
+    sxlatch_session_t * sess = sxlatch_session_get( session_id );
 
     TRY_GOTO( r->cleanup_in_progress_cnt > 0, err_cleanup_progress );
 
     newvalue = SXLATCH_MAKE_LATCH_VALUE( SXLATCH_MODE_X_ACQUIRED,
                                          session_id,
                                          0 /* shared cnt */);
+    wait_begin = __sxlatch_on_request( r, session_id, BF_LATCH_MODE_X_ACQUIRED );
+    __sxlatch_set_waiting( sess, r );
+
     while( continue_loop == true )
     {
-        TRY_GOTO( is_session_interrupted(), err_was_interrupted );
+        TRY_GOTO( is_session_interrupted( sess ), err_was_interrupted );
 
         mem_barrier();
 
@@ -265,12 +1062,26 @@ int sxlatch_intXlock( sxlatch_t * r, session_id_t session_id )
                                            newvalue ) )
             {
                 /* success to aqcire X latch */
+                TRY_GOTO( __sxlatch_x_drain( r, newvalue, sess ) != RC_SUCCESS,
+                          err_was_interrupted );
+                __sxlatch_on_acquire( r, session_id, BF_LATCH_MODE_X_ACQUIRED, wait_begin );
+                __sxlatch_on_contended_acquire( r, session_id, BF_LATCH_MODE_X_ACQUIRED, contended_at,
+                                                 caller );
                 continue_loop = false;
                 continue;
             }
         }
 
-        if( yield_cnt-- > 0 )
+        if( contended_at == 0 )
+        {
+            contended_at = __sxlatch_on_contention();
+        }
+
+        if( __sxlatch_park_on_owner( SXLATCH_GET_VALUE( r ) ) == true )
+        {
+            /* the owner was off cpu */
+        }
+        else if( yield_cnt-- > 0 )
         {
             sched_yield();
         }
@@ -280,63 +1091,120 @@ int sxlatch_intXlock( sxlatch_t * r, session_id_t session_id )
 
             if( __latch_use_sleep )
             {
-                thread_sleep( 0, 1 );
+                /* wakes up at once when the session is interrupted */
+                sxlatch_session_sleep( sess, 1 );
             }
 
             TRY_GOTO( ret != RC_SUCCESS, err_timeout );
         }
     }
 
+    __sxlatch_set_waiting( sess, NULL );
+
     return RC_SUCCESS;
 
     CATCH( err_cleanup_progress )
     {
+        SXLATCH_TRACE( r, SXLATCH_TRACE_TIMEOUT, session_id, BF_LATCH_MODE_X_ACQUIRED );
         ret = RC_ERR_LOCK_TIMEOUT;
     }
     CATCH( err_timeout )
     {
+        SXLATCH_TRACE( r, SXLATCH_TRACE_TIMEOUT, session_id, BF_LATCH_MODE_X_ACQUIRED );
         ret = RC_ERR_LOCK_TIMEOUT;
     }
     CATCH( err_was_interrupted )
     {
+        SXLATCH_TRACE( r, SXLATCH_TRACE_INTERRUPT, session_id, BF_LATCH_MODE_X_ACQUIRED );
         ret = RC_ERR_LOCK_INTERRUPTED;
     }
     CATCH_END;
 
+    __sxlatch_set_waiting( sess, NULL );
+    __sxlatch_on_contended_fail( r, session_id, BF_LATCH_MODE_X_ACQUIRED, contended_at );
+
     return ret;
 }
 
 
-int sxlatch_rdlock( sxlatch_t * r, session_id_t session_id )
+static inline __attribute__((always_inline))
+int __sxlatch_rdlock_template( sxlatch_t *          r,
+                               session_id_t         session_id,
+                               const void *         caller,
+                               sxlatch_admit_func_t admit,
+                               bool                 inflatable,
+                               bool                 bounded,
+                               bool                 xadd )
 {
     int  yield_cnt = __sxlatch_yield_loop_cnt;
     int64_t oldvalue = 0LL;
     int      ret = 0;
+    uint64_t wait_begin = 0;
+    uint64_t contended_at = 0;
+    bool     retried = false;
+    uint32_t backoff = 0;
 
     TRY_GOTO( r->cleanup_in_progress_cnt > 0, err_cleanup_progress );
 
+    wait_begin = __sxlatch_on_request( r, session_id, BF_LATCH_MODE_S );
+
     while( true )
     {
         oldvalue = SXLATCH_GET_VALUE( r );
 
-        if( SXLATCH_GET_MODE( oldvalue ) == SXLATCH_MODE_S )
+        if( admit( r, oldvalue ) == true )
         {
-            if( oldvalue == atomic_cas_64( &(SXLATCH_GET_VALUE( r )),
-                                           oldvalue,
-                                           oldvalue + 1 ) )
+            if( ( xadd == true ) ?
+                __sxlatch_enter_s_xadd( r, inflatable ) :
+                ( oldvalue == atomic_cas_64( &(SXLATCH_GET_VALUE( r )),
+                                             oldvalue,
+                                             oldvalue + 1 ) ) )
             {
+                if( xadd == false && inflatable == true && retried == false )
+                {
+                    __sxlatch_on_cas_success( r );
+                }
+                __sxlatch_on_acquire( r, session_id, BF_LATCH_MODE_S, wait_begin );
+                __sxlatch_on_contended_acquire( r, session_id, BF_LATCH_MODE_S, contended_at,
+                                                 caller );
                 ret = RC_SUCCESS;
                 break;
             }
+            else if( xadd == true )
+            {
+                /* a writer came in: wait for it */
+                continue;
+            }
             else
             {
                 /* try again */
+                if( inflatable == true )
+                {
+                    retried = true;
+                    __sxlatch_on_cas_failure( r );
+                }
+                __sxlatch_cas_backoff( &backoff );
                 continue;
             }
         }
         else
         {
-            if( yield_cnt-- > 0 )
+            if( contended_at == 0 )
+            {
+                contended_at = __sxlatch_on_contention();
+            }
+
+            if( bounded == true &&
+                __sxlatch_park_bounded( r, oldvalue ) == true )
+            {
+                continue;
+            }
+
+            if( __sxlatch_park_on_owner( oldvalue ) == true )
+            {
+                /* the owner was off cpu */
+            }
+            else if( yield_cnt-- > 0 )
             {
                 sched_yield();
             }
@@ -356,6 +1224,7 @@ int sxlatch_rdlock( sxlatch_t * r, session_id_t session_id )
 
     CATCH( err_cleanup_progress )
     {
+        SXLATCH_TRACE( r, SXLATCH_TRACE_TIMEOUT, session_id, BF_LATCH_MODE_S );
         ret = RC_ERR_LOCK_TIMEOUT;
     }
     CATCH_END;
@@ -363,27 +1232,34 @@ int sxlatch_rdlock( sxlatch_t * r, session_id_t session_id )
     return ret;
 }
 
-int sxlatch_tryrdlock( sxlatch_t * r, session_id_t session_id )
+static inline __attribute__((always_inline))
+int __sxlatch_tryrdlock_template( sxlatch_t *          r,
+                                  session_id_t         session_id,
+                                  sxlatch_admit_func_t admit )
 {
     int ret = 0;
     int64_t oldvalue = SXLATCH_GET_VALUE( r );
 
     TRY_GOTO( r->cleanup_in_progress_cnt > 0, err_cleanup_progress );
 
-    TRY_GOTO( SXLATCH_GET_MODE( oldvalue ) != SXLATCH_MODE_S, err_busy );
+    TRY_GOTO( admit( r, oldvalue ) == false, err_busy );
 
     TRY_GOTO( oldvalue != atomic_cas_64( &(SXLATCH_GET_VALUE( r )),
                                          oldvalue,
                                          oldvalue + 1 ), err_busy );
 
+    __sxlatch_on_acquire( r, session_id, BF_LATCH_MODE_S, 0 /* no wait */ );
+
     return RC_SUCCESS;
 
     CATCH( err_cleanup_progress )
     {
+        SXLATCH_TRACE( r, SXLATCH_TRACE_TIMEOUT, session_id, BF_LATCH_MODE_S );
         ret = RC_ERR_LOCK_TIMEOUT;
     }
     CATCH( err_busy )
     {
+        SXLATCH_TRACE( r, SXLATCH_TRACE_BUSY, session_id, BF_LATCH_MODE_S );
         ret = EBUSY;
     }
     CATCH_END;
@@ -391,16 +1267,23 @@ int sxlatch_tryrdlock( sxlatch_t * r, session_id_t session_id )
     return ret;
 }
 
-int sxlatch_wrlock( sxlatch_t * r, session_id_t session_id )
+static int __sxlatch_wrlock_default( sxlatch_t *  r,
+                                     session_id_t session_id,
+                                     const void * caller )
 {
     int yield_cnt = __sxlatch_yield_loop_cnt;
     int ret       = 0;
+    uint64_t wait_begin = 0;
+    uint64_t contended_at = 0;
     volatile int64_t oldvalue = 0;
     int64_t newvalue = 0;
+    uint32_t backoff = 0;
     bool continue_loop = true;
 
     TRY_GOTO( r->cleanup_in_progress_cnt > 0, err_cleanup_progress );
 
+    wait_begin = __sxlatch_on_request( r, session_id, BF_LATCH_MODE_X_ACQUIRED );
+
     while( continue_loop == true )
     {
         oldvalue = SXLATCH_GET_VALUE( r );
@@ -418,11 +1301,14 @@ int sxlatch_wrlock( sxlatch_t * r, session_id_t session_id )
                                                newvalue ) )
                 {
                     /* We've got the X_BLOCK, waiting for the unlocking S modes */
+                    SXLATCH_TRACE( r, SXLATCH_TRACE_X_BLOCKED, session_id, BF_LATCH_MODE_X_ACQUIRED );
                     continue;
                 }
                 else
                 {
                     /* try again without yield() */
+                    __sxlatch_on_cas_failure( r );
+                    __sxlatch_cas_backoff( &backoff );
                     continue;
                 }
                 break;
@@ -441,6 +1327,10 @@ int sxlatch_wrlock( sxlatch_t * r, session_id_t session_id )
                                                        newvalue ) )
                         {
                             /* success to aqcire X latch */
+                            (void)__sxlatch_x_drain( r, newvalue, NULL );
+                            __sxlatch_on_acquire( r, session_id, BF_LATCH_MODE_X_ACQUIRED, wait_begin );
+                            __sxlatch_on_contended_acquire( r, session_id, BF_LATCH_MODE_X_ACQUIRED, contended_at,
+                                                             caller );
                             continue_loop = false;
                             continue;
                         }
@@ -449,6 +1339,7 @@ int sxlatch_wrlock( sxlatch_t * r, session_id_t session_id )
                             /* this has some problems.
                              * It's maybe related to 'volatile' keyword.
                              * So, try to acquire again */
+                            __sxlatch_cas_backoff( &backoff );
                             continue;
                         }
                     }
@@ -478,7 +1369,16 @@ int sxlatch_wrlock( sxlatch_t * r, session_id_t session_id )
                 break;
         }
 
-        if( yield_cnt-- > 0 )
+        if( contended_at == 0 )
+        {
+            contended_at = __sxlatch_on_contention();
+        }
+
+        if( __sxlatch_park_on_owner( oldvalue ) == true )
+        {
+            /* the owner was off cpu */
+        }
+        else if( yield_cnt-- > 0 )
         {
             sched_yield();
         }
@@ -497,6 +1397,7 @@ int sxlatch_wrlock( sxlatch_t * r, session_id_t session_id )
 
     CATCH( err_cleanup_progress )
     {
+        SXLATCH_TRACE( r, SXLATCH_TRACE_TIMEOUT, session_id, BF_LATCH_MODE_X_ACQUIRED );
         ret = RC_ERR_LOCK_TIMEOUT;
     }
     CATCH_END;
@@ -504,7 +1405,7 @@ int sxlatch_wrlock( sxlatch_t * r, session_id_t session_id )
     return ret;
 }
 
-int sxlatch_trywrlock( sxlatch_t * r, session_id_t session_id )
+static int __sxlatch_trywrlock_default( sxlatch_t * r, session_id_t session_id )
 {
     int ret = RC_FAIL;
     int64_t oldvalue = 0;
@@ -526,14 +1427,28 @@ int sxlatch_trywrlock( sxlatch_t * r, session_id_t session_id )
                                           newvalue ),
               err_busy );
 
+    if( r->policy == SXLATCH_POLICY_INFLATED )
+    {
+        if( sxlatch_inflated_readers( sxlatch_inflated_get( r->policy_word ) ) != 0 )
+        {
+            /* readers are in the shards: give X back */
+            (void)atomic_fetch_sub( &(SXLATCH_GET_VALUE(r)), newvalue );
+            TRY_GOTO( true, err_busy );
+        }
+    }
+
+    __sxlatch_on_acquire( r, session_id, BF_LATCH_MODE_X_ACQUIRED, 0 /* no wait */ );
+
     return RC_SUCCESS;
 
     CATCH( err_cleanup_progress )
     {
+        SXLATCH_TRACE( r, SXLATCH_TRACE_TIMEOUT, session_id, BF_LATCH_MODE_X_ACQUIRED );
         ret = RC_ERR_LOCK_TIMEOUT;
     }
     CATCH( err_busy )
     {
+        SXLATCH_TRACE( r, SXLATCH_TRACE_BUSY, session_id, BF_LATCH_MODE_X_ACQUIRED );
         /* X or SX locked already */
         ret = RC_ERR_LOCK_BUSY;
     }
@@ -546,6 +1461,7 @@ int sxlatch_set_cleanup_progress( sxlatch_t * r, bool is_cleanup )
 {
     int oldvalue = 0;
     int newvalue = 0;
+    uint32_t backoff = 0;
 
     /* FIXME: add logic that checking process type
      * caller process should be Main or Sub-DAEMON process,
@@ -563,10 +1479,16 @@ int sxlatch_set_cleanup_progress( sxlatch_t * r, bool is_cleanup )
         }
         else
         {
+            __sxlatch_cas_backoff( &backoff );
             continue;
         }
     }
 
+    if( is_cleanup == false )
+    {
+        __sxlatch_drain_notify();
+    }
+
     return RC_SUCCESS;
 }
 
@@ -658,10 +1580,14 @@ int __sxlatch_unlock_for_recovery( sxlatch_t * r,
 
     sxlatch_unlock_callback unlock = NULL;
     int cur_mode = SXLATCH_GET_MODE_IDX(SXLATCH_GET_VALUE(r));
+    int ret = RC_SUCCESS;
 
     unlock = __sxlatch_unlock_callback[request_latch_mode][cur_mode];
 
-    return unlock( r, request_session_id);
+    ret = unlock( r, request_session_id);
+    __sxlatch_drain_notify();
+
+    return ret;
 
     CATCH_END;
 
@@ -675,6 +1601,7 @@ int  __sxlatch_unlock_internal_s( sxlatch_t * r,
 {
     int64_t oldvalue = 0;
     int64_t newvalue = 0;
+    uint32_t backoff = 0;
 
     bool  continue_loop = true;
 
@@ -718,6 +1645,7 @@ int  __sxlatch_unlock_internal_s( sxlatch_t * r,
                 else
                 {
                     /* try again */
+                    __sxlatch_cas_backoff( &backoff );
                 }
                 break;
 
@@ -817,7 +1745,7 @@ int  __sxlatch_unlock_internal_x_acquired( sxlatch_t * r,
                 case SXLATCH_MODE_X_ACQUIRED:
                     if( oldvalue == atomic_cas_64( &(SXLATCH_GET_VALUE( r )),
                                                    oldvalue,
-                                                   SXLATCH_UNLOCKED ) )
+                                                   SXLATCH_GET_SHARED_CNT( oldvalue ) ) )
                     {
                         continue_loop = false;
                         continue;
@@ -860,11 +1788,12 @@ int __sxlatch_unlock_internal_do_nothing( sxlatch_t * r,
     return RC_SUCCESS;
 }
 
-int sxlatch_unlock( sxlatch_t * r, session_id_t session_id )
+static int __sxlatch_unlock_default( sxlatch_t * r, session_id_t session_id )
 {
     int ret = RC_SUCCESS;
     volatile int64_t oldvalue = 0;
     int64_t newvalue = 0;
+    uint32_t backoff = 0;
 
     bool continue_loop = true;
 
@@ -886,29 +1815,34 @@ int sxlatch_unlock( sxlatch_t * r, session_id_t session_id )
                                                oldvalue,
                                                newvalue ) )
                 {
+                    __sxlatch_on_release( r, session_id, BF_LATCH_MODE_S );
                     continue_loop = false;
                     continue;
                 }
                 else
                 {
                     /* try again */
+                    __sxlatch_cas_backoff( &backoff );
                 }
                 break;
 
             case SXLATCH_MODE_X_ACQUIRED:
                 if( SXLATCH_GET_SESSION_ID( oldvalue ) == session_id )
                 {
+                    /* keep the count of optimistic readers stepping back */
                     if( oldvalue == atomic_cas_64( &(SXLATCH_GET_VALUE( r )),
                                                    oldvalue,
-                                                   SXLATCH_UNLOCKED ) )
+                                                   SXLATCH_GET_SHARED_CNT( oldvalue ) ) )
                     {
                         /* success to aqcire X latch */
+                        __sxlatch_on_release( r, session_id, BF_LATCH_MODE_X_ACQUIRED );
                         continue_loop = false;
                         continue;
                     }
                     else
                     {
                         /* try again */
+                        __sxlatch_cas_backoff( &backoff );
                     }
                 }
                 else
@@ -937,37 +1871,109 @@ int sxlatch_unlock( sxlatch_t * r, session_id_t session_id )
     return RC_FAIL;
 }
 
-int sxlatch_intrdlock( sxlatch_t * r, session_id_t session_id )
+/* the caller holds S: one fetch-and-sub */
+static int __sxlatch_rdunlock_default( sxlatch_t * r, session_id_t session_id )
+{
+    (void)atomic_fetch_dec( &(SXLATCH_GET_VALUE( r )) );
+    __sxlatch_on_release( r, session_id, BF_LATCH_MODE_S );
+
+    return RC_SUCCESS;
+}
+
+/* the caller holds X: subtract the mode and the owner, what is left is
+ * the count of optimistic readers stepping back(0 when none) */
+static int __sxlatch_wrunlock_default( sxlatch_t * r, session_id_t session_id )
+{
+    (void)atomic_fetch_sub( &(SXLATCH_GET_VALUE( r )),
+                            SXLATCH_MAKE_LATCH_VALUE( SXLATCH_MODE_X_ACQUIRED,
+                                                      session_id,
+                                                      0 /* shared cnt */ ) );
+    __sxlatch_on_release( r, session_id, BF_LATCH_MODE_X_ACQUIRED );
+
+    return RC_SUCCESS;
+}
+
+static inline __attribute__((always_inline))
+int __sxlatch_intrdlock_template( sxlatch_t *          r,
+                                  session_id_t         session_id,
+                                  const void *         caller,
+                                  sxlatch_admit_func_t admit,
+                                  bool                 inflatable,
+                                  bool                 bounded,
+                                  bool                 xadd )
 {
     int  yield_cnt = __sxlatch_yield_loop_cnt;
     int64_t oldvalue = 0LL;
     int      ret = 0;
+    uint64_t wait_begin = 0;
+    uint64_t contended_at = 0;
+    bool     retried = false;
+    uint32_t backoff = 0;
+    sxlatch_session_t * sess = sxlatch_session_get( session_id );
 
     TRY_GOTO( r->cleanup_in_progress_cnt > 0, err_cleanup_progress );
 
+    wait_begin = __sxlatch_on_request( r, session_id, BF_LATCH_MODE_S );
+    __sxlatch_set_waiting( sess, r );
+
     while( true )
     {
-        TRY_GOTO( is_session_interrupted(), err_was_interrupted );
+        TRY_GOTO( is_session_interrupted( sess ), err_was_interrupted );
 
         oldvalue = SXLATCH_GET_VALUE( r );
 
-        if( SXLATCH_GET_MODE( oldvalue ) == SXLATCH_MODE_S )
+        if( admit( r, oldvalue ) == true )
         {
-            if( oldvalue == atomic_cas_64( &(SXLATCH_GET_VALUE( r )),
-                                           oldvalue,
-                                           oldvalue + 1 ) )
+            if( ( xadd == true ) ?
+                __sxlatch_enter_s_xadd( r, inflatable ) :
+                ( oldvalue == atomic_cas_64( &(SXLATCH_GET_VALUE( r )),
+                                             oldvalue,
+                                             oldvalue + 1 ) ) )
             {
+                if( xadd == false && inflatable == true && retried == false )
+                {
+                    __sxlatch_on_cas_success( r );
+                }
+                __sxlatch_on_acquire( r, session_id, BF_LATCH_MODE_S, wait_begin );
+                __sxlatch_on_contended_acquire( r, session_id, BF_LATCH_MODE_S, contended_at,
+                                                 caller );
                 break;
             }
+            else if( xadd == true )
+            {
+                /* a writer came in: wait for it */
+                continue;
+            }
             else
             {
                 /* try again */
+                if( inflatable == true )
+                {
+                    retried = true;
+                    __sxlatch_on_cas_failure( r );
+                }
+                __sxlatch_cas_backoff( &backoff );
                 continue;
             }
         }
         else
         {
-            if( yield_cnt-- > 0 )
+            if( contended_at == 0 )
+            {
+                contended_at = __sxlatch_on_contention();
+            }
+
+            if( bounded == true &&
+                __sxlatch_park_bounded( r, oldvalue ) == true )
+            {
+                continue;
+            }
+
+            if( __sxlatch_park_on_owner( oldvalue ) == true )
+            {
+                /* the owner was off cpu */
+            }
+            else if( yield_cnt-- > 0 )
             {
                 sched_yield();
             }
@@ -977,7 +1983,7 @@ int sxlatch_intrdlock( sxlatch_t * r, session_id_t session_id )
 
                 if( __latch_use_sleep )
                 {
-                    thread_sleep( 0, 1 );
+                    sxlatch_session_sleep( sess, 1 );
                 }
 
                 TRY( ret != RC_SUCCESS );
@@ -985,36 +1991,53 @@ int sxlatch_intrdlock( sxlatch_t * r, session_id_t session_id )
         }
     }
 
+    __sxlatch_set_waiting( sess, NULL );
+
     return RC_SUCCESS;
 
     CATCH( err_cleanup_progress )
     {
+        SXLATCH_TRACE( r, SXLATCH_TRACE_TIMEOUT, session_id, BF_LATCH_MODE_S );
         ret = RC_ERR_LOCK_TIMEOUT;
     }
     CATCH( err_was_interrupted )
     {
+        SXLATCH_TRACE( r, SXLATCH_TRACE_INTERRUPT, session_id, BF_LATCH_MODE_S );
         ret = RC_ERR_LOCK_INTERRUPTED;
     }
     CATCH_END;
 
+    __sxlatch_set_waiting( sess, NULL );
+    __sxlatch_on_contended_fail( r, session_id, BF_LATCH_MODE_S, contended_at );
+
     return ret;
 }
 
-int sxlatch_intwrlock( sxlatch_t * r, session_id_t session_id )
+static int __sxlatch_intwrlock_default( sxlatch_t *  r,
+                                        session_id_t session_id,
+                                        const void * caller )
 {
     int yield_cnt = __sxlatch_yield_loop_cnt;
     int ret       = 0;
+    uint64_t wait_begin = 0;
+    uint64_t contended_at = 0;
     int64_t oldvalue = 0;
     int64_t newvalue = 0;
 
+    uint32_t backoff = 0;
+
     bool this_blocked_other_process = false;
     bool continue_loop = true;
+    sxlatch_session_t * sess = sxlatch_session_get( session_id );
 
     TRY_GOTO( r->cleanup_in_progress_cnt > 0, err_cleanup_progress );
 
+    wait_begin = __sxlatch_on_request( r, session_id, BF_LATCH_MODE_X_ACQUIRED );
+    __sxlatch_set_waiting( sess, r );
+
     while( continue_loop == true )
     {
-        TRY_GOTO( is_session_interrupted(), err_was_interrupted );
+        TRY_GOTO( is_session_interrupted( sess ), err_was_interrupted );
 
         oldvalue = SXLATCH_GET_VALUE( r );
 
@@ -1031,12 +2054,15 @@ int sxlatch_intwrlock( sxlatch_t * r, session_id_t session_id )
                                                newvalue ) )
                 {
                     /* wait for rest S modes */
+                    SXLATCH_TRACE( r, SXLATCH_TRACE_X_BLOCKED, session_id, BF_LATCH_MODE_X_ACQUIRED );
                     this_blocked_other_process = true;
                     continue ;
                 }
                 else
                 {
                     /* try again */
+                    __sxlatch_on_cas_failure( r );
+                    __sxlatch_cas_backoff( &backoff );
                     continue;
                 }
                 break;
@@ -1055,6 +2081,11 @@ int sxlatch_intwrlock( sxlatch_t * r, session_id_t session_id )
                                                        newvalue ) )
                         {
                             /* success to aqcire X latch */
+                            TRY_GOTO( __sxlatch_x_drain( r, newvalue, sess ) != RC_SUCCESS,
+                                      err_was_interrupted );
+                            __sxlatch_on_acquire( r, session_id, BF_LATCH_MODE_X_ACQUIRED, wait_begin );
+                            __sxlatch_on_contended_acquire( r, session_id, BF_LATCH_MODE_X_ACQUIRED, contended_at,
+                                                             caller );
                             continue_loop = false;
                             continue;
                         }
@@ -1063,6 +2094,7 @@ int sxlatch_intwrlock( sxlatch_t * r, session_id_t session_id )
                             /* this has some problems.
                              * It's maybe related to 'volatile' keyword.
                              * So, try to acquire again */
+                            __sxlatch_cas_backoff( &backoff );
                             continue;
                         }
                     }
@@ -1093,7 +2125,16 @@ int sxlatch_intwrlock( sxlatch_t * r, session_id_t session_id )
 
         }
 
-        if( yield_cnt-- > 0 )
+        if( contended_at == 0 )
+        {
+            contended_at = __sxlatch_on_contention();
+        }
+
+        if( __sxlatch_park_on_owner( oldvalue ) == true )
+        {
+            /* the owner was off cpu */
+        }
+        else if( yield_cnt-- > 0 )
         {
             sched_yield();
         }
@@ -1103,55 +2144,1941 @@ int sxlatch_intwrlock( sxlatch_t * r, session_id_t session_id )
 
             if( __latch_use_sleep )
             {
-                thread_sleep( 0, 1 );
+                sxlatch_session_sleep( sess, 1 );
             }
-
         }
     }
 
+    __sxlatch_set_waiting( sess, NULL );
+
     return RC_SUCCESS;
 
     CATCH( err_cleanup_progress )
     {
+        SXLATCH_TRACE( r, SXLATCH_TRACE_TIMEOUT, session_id, BF_LATCH_MODE_X_ACQUIRED );
         ret = RC_ERR_LOCK_TIMEOUT;
     }
     CATCH( err_timeout )
     {
-        while( true )
+        SXLATCH_TRACE( r, SXLATCH_TRACE_TIMEOUT, session_id, BF_LATCH_MODE_X_ACQUIRED );
+        /* 자신이 X 래치를 거는 중 timeout된 경우, 풀어주고 나가야 함 */
+        if( this_blocked_other_process == true )
         {
-            oldvalue = SXLATCH_GET_VALUE( r );
-            /* 자신이 X 래치를 거는 중 timeout된 경우, 풀어주고 나가야 함 */
-            if( (this_blocked_other_process == true) &&
-                (SXLATCH_GET_SESSION_ID( oldvalue ) == session_id) &&
-                (SXLATCH_GET_MODE( oldvalue ) != SXLATCH_MODE_S) )
+            __sxlatch_unblock_x( r, session_id );
+        }
+        ret = RC_ERR_LOCK_TIMEOUT;
+    }
+    CATCH( err_was_interrupted )
+    {
+        SXLATCH_TRACE( r, SXLATCH_TRACE_INTERRUPT, session_id, BF_LATCH_MODE_X_ACQUIRED );
+        /* interrupted while holding X_BLOCKED: give S modes back */
+        if( this_blocked_other_process == true )
+        {
+            __sxlatch_unblock_x( r, session_id );
+        }
+        ret = RC_ERR_LOCK_INTERRUPTED;
+    }
+    CATCH_END;
 
-            {
-                newvalue = SXLATCH_MAKE_LATCH_VALUE( SXLATCH_MODE_S,
-                                                     0, /* meaningless */
-                                                     SXLATCH_GET_SHARED_CNT(oldvalue) );
+    __sxlatch_set_waiting( sess, NULL );
+    __sxlatch_on_contended_fail( r, session_id, BF_LATCH_MODE_X_ACQUIRED, contended_at );
 
-                if( oldvalue == atomic_cas_64( &(SXLATCH_GET_VALUE( r )),
-                                               oldvalue,
-                                               newvalue ) )
-                {
-                    break;
-                }
+    return ret;
+}
 
-            }
-            else
+/* roll back X_BLOCKED which was marked by session_id */
+static void __sxlatch_unblock_x( sxlatch_t * r, session_id_t session_id )
+{
+    int64_t oldvalue = 0;
+    int64_t newvalue = 0;
+
+    while( true )
+    {
+        oldvalue = SXLATCH_GET_VALUE( r );
+        if( (SXLATCH_GET_SESSION_ID( oldvalue ) == session_id) &&
+            (SXLATCH_GET_MODE( oldvalue ) == SXLATCH_MODE_X_BLOCKED) )
+        {
+            newvalue = SXLATCH_MAKE_LATCH_VALUE( SXLATCH_MODE_S,
+                                                 0, /* meaningless */
+                                                 SXLATCH_GET_SHARED_CNT(oldvalue) );
+
+            if( oldvalue == atomic_cas_64( &(SXLATCH_GET_VALUE( r )),
+                                           oldvalue,
+                                           newvalue ) )
             {
-                /* something was wrong, but this session cannot this latch.
-                 * Because other session has acquired this latch already. */
                 break;
             }
         }
-        ret = RC_ERR_LOCK_TIMEOUT;
+        else
+        {
+            /* something was wrong, but this session cannot this latch.
+             * Because other session has acquired this latch already. */
+            break;
+        }
     }
-    CATCH( err_was_interrupted )
+}
+
+/* policy instances of the reader templates */
+static int __sxlatch_rdlock_default( sxlatch_t *  r,
+                                     session_id_t session_id,
+                                     const void * caller )
+{
+    return __sxlatch_rdlock_template( r, session_id, caller,
+                                      __sxlatch_admit_default, true, false, true );
+}
+
+static int __sxlatch_tryrdlock_default( sxlatch_t * r, session_id_t session_id )
+{
+    return __sxlatch_tryrdlock_template( r, session_id,
+                                         __sxlatch_admit_default );
+}
+
+static int __sxlatch_intrdlock_default( sxlatch_t *  r,
+                                        session_id_t session_id,
+                                        const void * caller )
+{
+    return __sxlatch_intrdlock_template( r, session_id, caller,
+                                         __sxlatch_admit_default, true, false, true );
+}
+
+static int __sxlatch_rdlock_reader_pref( sxlatch_t *  r,
+                                         session_id_t session_id,
+                                         const void * caller )
+{
+    return __sxlatch_rdlock_template( r, session_id, caller,
+                                      __sxlatch_admit_reader_pref, false, false, false );
+}
+
+static int __sxlatch_tryrdlock_reader_pref( sxlatch_t * r, session_id_t session_id )
+{
+    return __sxlatch_tryrdlock_template( r, session_id,
+                                         __sxlatch_admit_reader_pref );
+}
+
+static int __sxlatch_intrdlock_reader_pref( sxlatch_t *  r,
+                                            session_id_t session_id,
+                                            const void * caller )
+{
+    return __sxlatch_intrdlock_template( r, session_id, caller,
+                                         __sxlatch_admit_reader_pref, false, false, false );
+}
+
+static int __sxlatch_rdlock_writer_pref( sxlatch_t *  r,
+                                         session_id_t session_id,
+                                         const void * caller )
+{
+    return __sxlatch_rdlock_template( r, session_id, caller,
+                                      __sxlatch_admit_writer_pref, false, false, false );
+}
+
+static int __sxlatch_tryrdlock_writer_pref( sxlatch_t * r, session_id_t session_id )
+{
+    return __sxlatch_tryrdlock_template( r, session_id,
+                                         __sxlatch_admit_writer_pref );
+}
+
+static int __sxlatch_intrdlock_writer_pref( sxlatch_t *  r,
+                                            session_id_t session_id,
+                                            const void * caller )
+{
+    return __sxlatch_intrdlock_template( r, session_id, caller,
+                                         __sxlatch_admit_writer_pref, false, false, false );
+}
+
+/* writer preference: a writer counts itself in policy_word from the
+ * request until it holds X(or gives up) */
+static int __sxlatch_wrlock_writer_pref( sxlatch_t *  r,
+                                         session_id_t session_id,
+                                         const void * caller )
+{
+    int ret = 0;
+
+    atomic_fetch_inc( &(r->policy_word) );
+    ret = __sxlatch_wrlock_default( r, session_id, caller );
+    atomic_fetch_dec( &(r->policy_word) );
+
+    return ret;
+}
+
+static int __sxlatch_intwrlock_writer_pref( sxlatch_t *  r,
+                                            session_id_t session_id,
+                                            const void * caller )
+{
+    int ret = 0;
+
+    atomic_fetch_inc( &(r->policy_word) );
+    ret = __sxlatch_intwrlock_default( r, session_id, caller );
+    atomic_fetch_dec( &(r->policy_word) );
+
+    return ret;
+}
+
+/* bounded share policy
+ * aux_word: share limit, policy_word: readers parked at the limit */
+static int __sxlatch_rdlock_bounded( sxlatch_t *  r,
+                                     session_id_t session_id,
+                                     const void * caller )
+{
+    return __sxlatch_rdlock_template( r, session_id, caller,
+                                      __sxlatch_admit_bounded, false, true, false );
+}
+
+static int __sxlatch_tryrdlock_bounded( sxlatch_t * r, session_id_t session_id )
+{
+    return __sxlatch_tryrdlock_template( r, session_id,
+                                         __sxlatch_admit_bounded );
+}
+
+static int __sxlatch_intrdlock_bounded( sxlatch_t *  r,
+                                        session_id_t session_id,
+                                        const void * caller )
+{
+    return __sxlatch_intrdlock_template( r, session_id, caller,
+                                         __sxlatch_admit_bounded, false, true, false );
+}
+
+static int __sxlatch_unlock_bounded( sxlatch_t * r, session_id_t session_id )
+{
+    int ret = __sxlatch_unlock_default( r, session_id );
+
+    /* the shared count moved: one parked reader may come in */
+    if( r->policy_word > 0 )
     {
-        ret = RC_ERR_LOCK_INTERRUPTED;
+        (void)futex_wake( __sxlatch_shared_cnt_word( r ), 1 );
     }
-    CATCH_END;
 
     return ret;
 }
+
+static int __sxlatch_rdunlock_bounded( sxlatch_t * r, session_id_t session_id )
+{
+    int ret = __sxlatch_rdunlock_default( r, session_id );
+
+    if( r->policy_word > 0 )
+    {
+        (void)futex_wake( __sxlatch_shared_cnt_word( r ), 1 );
+    }
+
+    return ret;
+}
+
+int sxlatch_set_share_limit( sxlatch_t * r, int share_limit )
+{
+    TRY( r == NULL || r->policy != SXLATCH_POLICY_BOUNDED || share_limit < 0 );
+
+    r->aux_word = share_limit;
+    mem_barrier();
+
+    if( r->policy_word > 0 )
+    {
+        (void)futex_wake( __sxlatch_shared_cnt_word( r ), 0 /* all */ );
+    }
+
+    return RC_SUCCESS;
+
+    CATCH_END;
+
+    return RC_FAIL;
+}
+
+/* default policy: value is the whole latch already */
+static int __sxlatch_settle_default( sxlatch_t * r )
+{
+    (void)r;
+
+    return RC_SUCCESS;
+}
+
+/* biased policy
+ * policy_word: 0(no bias yet) | OWNER + session id | REVOKING | REVOKED
+ * The bias owner enters by adding its hold to aux_word and checking
+ * policy_word again, and leaves by taking it back: no atomic instruction,
+ * as only the owner writes aux_word. aux_word counts nested S and X holds
+ * apart, and the bias is free when both counts are 0.
+ * A revoker marks REVOKING and runs membarrier(2): after the barrier, the
+ * owner either has seen REVOKING(and takes the plain protocol) or its
+ * hold is visible to the revoker, which waits for the hold to end. */
+#define SXLATCH_BIAS_OWNER           ((int32_t)0x10000000)
+#define SXLATCH_BIAS_REVOKING        ((int32_t)0x20000000)
+#define SXLATCH_BIAS_REVOKED         ((int32_t)0x40000000)
+#define SXLATCH_BIAS_MAKE( sid )     (SXLATCH_BIAS_OWNER | (int32_t)(sid))
+#define SXLATCH_BIAS_IS_OWNER( w, sid )   \
+  (((w) & ~SXLATCH_BIAS_REVOKING) == SXLATCH_BIAS_MAKE( sid ))
+
+#define SXLATCH_BIAS_HOLD_S          ((int32_t)0x00000001)
+#define SXLATCH_BIAS_HOLD_X          ((int32_t)0x00010000)
+#define SXLATCH_BIAS_HOLD_S_MASK     ((int32_t)0x0000FFFF)
+#define SXLATCH_BIAS_HOLD_X_MASK     ((int32_t)0x7FFF0000)
+
+#define SXLATCH_BIAS_ENTERED         0  /* held through the bias */
+#define SXLATCH_BIAS_NONE            1  /* use the plain protocol */
+#define SXLATCH_BIAS_BUSY            2  /* try: the bias is in use */
+
+static inline int __sxlatch_bias_enter( sxlatch_t *  r,
+                                        session_id_t session_id,
+                                        int32_t      hold,
+                                        bool         try_only )
+{
+    int32_t word = r->policy_word;
+
+    if( word == SXLATCH_BIAS_REVOKED || r->cleanup_in_progress_cnt > 0 )
+    {
+        return SXLATCH_BIAS_NONE;
+    }
+
+    if( word == 0 )
+    {
+        /* one-time bias to the first session */
+        word = atomic_cas_32( &(r->policy_word), 0, SXLATCH_BIAS_MAKE( session_id ) );
+        if( word == 0 )
+        {
+            word = SXLATCH_BIAS_MAKE( session_id );
+        }
+    }
+
+    if( word == SXLATCH_BIAS_MAKE( session_id ) )
+    {
+        r->aux_word = r->aux_word + hold;
+        compiler_barrier();
+
+        if( __atomic_load_n( &(r->policy_word), __ATOMIC_ACQUIRE ) == word )
+        {
+            return SXLATCH_BIAS_ENTERED;
+        }
+
+        /* revocation has begun: the outer holds(if any) stay */
+        __atomic_store_n( &(r->aux_word), r->aux_word - hold, __ATOMIC_RELEASE );
+        return SXLATCH_BIAS_NONE;
+    }
+
+    if( SXLATCH_BIAS_IS_OWNER( word, session_id ) )
+    {
+        /* the owner itself while revoking */
+        return SXLATCH_BIAS_NONE;
+    }
+
+    if( try_only == true &&
+        ( r->aux_word != 0 || (word & SXLATCH_BIAS_REVOKING) != 0 ) )
+    {
+        return SXLATCH_BIAS_BUSY;
+    }
+
+    __sxlatch_revoke_biased( r );
+
+    return SXLATCH_BIAS_NONE;
+}
+
+static int __sxlatch_revoke_biased( sxlatch_t * r )
+{
+    int32_t word = 0;
+
+    while( true )
+    {
+        word = r->policy_word;
+        if( word == SXLATCH_BIAS_REVOKED )
+        {
+            return RC_SUCCESS;
+        }
+
+        if( (word & SXLATCH_BIAS_REVOKING) == 0 )
+        {
+            if( word == atomic_cas_32( &(r->policy_word),
+                                       word,
+                                       word | SXLATCH_BIAS_REVOKING ) )
+            {
+                break;
+            }
+            continue;
+        }
+
+        /* another session is revoking */
+        sched_yield();
+    }
+
+    /* the handshake with the owner(supported: sxlatch_init_attr()) */
+    (void)process_membarrier();
+
+    while( r->aux_word != 0 )
+    {
+        /* the owner is in its critical section */
+        sched_yield();
+    }
+
+    mem_barrier();
+    r->policy_word = SXLATCH_BIAS_REVOKED;
+    mem_barrier();
+
+    return RC_SUCCESS;
+}
+
+static int __sxlatch_Xlock_biased( sxlatch_t *  r,
+                                   session_id_t session_id,
+                                   const void * caller )
+{
+    if( __sxlatch_bias_enter( r, session_id, SXLATCH_BIAS_HOLD_X, false ) ==
+        SXLATCH_BIAS_ENTERED )
+    {
+        __sxlatch_on_acquire( r, session_id, BF_LATCH_MODE_X_ACQUIRED, 0 /* no wait */ );
+        return RC_SUCCESS;
+    }
+
+    return __sxlatch_Xlock_default( r, session_id, caller );
+}
+
+static int __sxlatch_intXlock_biased( sxlatch_t *  r,
+                                      session_id_t session_id,
+                                      const void * caller )
+{
+    if( __sxlatch_bias_enter( r, session_id, SXLATCH_BIAS_HOLD_X, false ) ==
+        SXLATCH_BIAS_ENTERED )
+    {
+        __sxlatch_on_acquire( r, session_id, BF_LATCH_MODE_X_ACQUIRED, 0 /* no wait */ );
+        return RC_SUCCESS;
+    }
+
+    return __sxlatch_intXlock_default( r, session_id, caller );
+}
+
+static int __sxlatch_rdlock_biased( sxlatch_t *  r,
+                                    session_id_t session_id,
+                                    const void * caller )
+{
+    if( __sxlatch_bias_enter( r, session_id, SXLATCH_BIAS_HOLD_S, false ) ==
+        SXLATCH_BIAS_ENTERED )
+    {
+        __sxlatch_on_acquire( r, session_id, BF_LATCH_MODE_S, 0 /* no wait */ );
+        return RC_SUCCESS;
+    }
+
+    return __sxlatch_rdlock_default( r, session_id, caller );
+}
+
+static int __sxlatch_tryrdlock_biased( sxlatch_t * r, session_id_t session_id )
+{
+    switch( __sxlatch_bias_enter( r, session_id, SXLATCH_BIAS_HOLD_S, true ) )
+    {
+        case SXLATCH_BIAS_ENTERED:
+            __sxlatch_on_acquire( r, session_id, BF_LATCH_MODE_S, 0 /* no wait */ );
+            return RC_SUCCESS;
+
+        case SXLATCH_BIAS_BUSY:
+            SXLATCH_TRACE( r, SXLATCH_TRACE_BUSY, session_id, BF_LATCH_MODE_S );
+            return EBUSY;
+
+        default:
+            break;
+    }
+
+    return __sxlatch_tryrdlock_default( r, session_id );
+}
+
+static int __sxlatch_wrlock_biased( sxlatch_t *  r,
+                                    session_id_t session_id,
+                                    const void * caller )
+{
+    if( __sxlatch_bias_enter( r, session_id, SXLATCH_BIAS_HOLD_X, false ) ==
+        SXLATCH_BIAS_ENTERED )
+    {
+        __sxlatch_on_acquire( r, session_id, BF_LATCH_MODE_X_ACQUIRED, 0 /* no wait */ );
+        return RC_SUCCESS;
+    }
+
+    return __sxlatch_wrlock_default( r, session_id, caller );
+}
+
+static int __sxlatch_trywrlock_biased( sxlatch_t * r, session_id_t session_id )
+{
+    switch( __sxlatch_bias_enter( r, session_id, SXLATCH_BIAS_HOLD_X, true ) )
+    {
+        case SXLATCH_BIAS_ENTERED:
+            __sxlatch_on_acquire( r, session_id, BF_LATCH_MODE_X_ACQUIRED, 0 /* no wait */ );
+            return RC_SUCCESS;
+
+        case SXLATCH_BIAS_BUSY:
+            SXLATCH_TRACE( r, SXLATCH_TRACE_BUSY, session_id, BF_LATCH_MODE_X_ACQUIRED );
+            return RC_ERR_LOCK_BUSY;
+
+        default:
+            break;
+    }
+
+    return __sxlatch_trywrlock_default( r, session_id );
+}
+
+static int __sxlatch_intrdlock_biased( sxlatch_t *  r,
+                                       session_id_t session_id,
+                                       const void * caller )
+{
+    if( __sxlatch_bias_enter( r, session_id, SXLATCH_BIAS_HOLD_S, false ) ==
+        SXLATCH_BIAS_ENTERED )
+    {
+        __sxlatch_on_acquire( r, session_id, BF_LATCH_MODE_S, 0 /* no wait */ );
+        return RC_SUCCESS;
+    }
+
+    return __sxlatch_intrdlock_default( r, session_id, caller );
+}
+
+static int __sxlatch_intwrlock_biased( sxlatch_t *  r,
+                                       session_id_t session_id,
+                                       const void * caller )
+{
+    if( __sxlatch_bias_enter( r, session_id, SXLATCH_BIAS_HOLD_X, false ) ==
+        SXLATCH_BIAS_ENTERED )
+    {
+        __sxlatch_on_acquire( r, session_id, BF_LATCH_MODE_X_ACQUIRED, 0 /* no wait */ );
+        return RC_SUCCESS;
+    }
+
+    return __sxlatch_intwrlock_default( r, session_id, caller );
+}
+
+static int __sxlatch_unlock_biased( sxlatch_t * r, session_id_t session_id )
+{
+    int32_t holds = r->aux_word;
+    int32_t hold  = 0;
+
+    if( holds != 0 && SXLATCH_BIAS_IS_OWNER( r->policy_word, session_id ) )
+    {
+        /* nested holds: X is given back first */
+        hold = ( (holds & SXLATCH_BIAS_HOLD_X_MASK) != 0 ) ?
+               SXLATCH_BIAS_HOLD_X : SXLATCH_BIAS_HOLD_S;
+        __atomic_store_n( &(r->aux_word), holds - hold, __ATOMIC_RELEASE );
+        __sxlatch_on_release( r, session_id,
+                              ( hold == SXLATCH_BIAS_HOLD_X ) ?
+                              BF_LATCH_MODE_X_ACQUIRED : BF_LATCH_MODE_S );
+        return RC_SUCCESS;
+    }
+
+    return __sxlatch_unlock_default( r, session_id );
+}
+
+/* asymmetric-fence policy
+ * A reader stores the latch into a slot of its thread(asym.h) and reads
+ * value: while the mode is S, it holds S without any atomic instruction.
+ * Otherwise it takes the slot back and waits as a plain reader on value.
+ * Writers take X on value as usual, then run membarrier(2), after which
+ * every slot store is visible or the reader has seen the writer's mode,
+ * and wait until no slot holds the latch. */
+static inline bool __sxlatch_asym_enter( sxlatch_t * r, session_id_t session_id )
+{
+    sxlatch_asym_slots_t * slots = __sxlatch_asym_my_slots;
+    int idx = 0;
+
+    if( __builtin_expect( slots == NULL, 0 ) )
+    {
+        slots = sxlatch_asym_attach();
+        if( slots == NULL )
+        {
+            return false;
+        }
+    }
+
+    idx = slots->top;
+    if( idx == SXLATCH_ASYM_SLOT_CNT || r->cleanup_in_progress_cnt > 0 )
+    {
+        return false;
+    }
+
+    /* the session first, for the recovery */
+    slots->sessions[idx] = session_id;
+    slots->latches[idx]  = r;
+    compiler_barrier();
+
+    if( SXLATCH_GET_MODE( __atomic_load_n( &(SXLATCH_GET_VALUE( r )), __ATOMIC_ACQUIRE ) ) ==
+        SXLATCH_MODE_S )
+    {
+        slots->top = idx + 1;
+        return true;
+    }
+
+    /* a writer is in */
+    __atomic_store_n( &(slots->latches[idx]), NULL, __ATOMIC_RELEASE );
+
+    return false;
+}
+
+static inline bool __sxlatch_asym_leave( sxlatch_t * r )
+{
+    sxlatch_asym_slots_t * slots = __sxlatch_asym_my_slots;
+    int idx = 0;
+
+    if( slots == NULL )
+    {
+        return false;
+    }
+
+    for( idx = slots->top - 1; idx >= 0; idx-- )
+    {
+        if( slots->latches[idx] == r )
+        {
+            __atomic_store_n( &(slots->latches[idx]), NULL, __ATOMIC_RELEASE );
+
+            while( slots->top > 0 && slots->latches[slots->top - 1] == NULL )
+            {
+                slots->top--;
+            }
+            return true;
+        }
+    }
+
+    /* S was taken on value */
+    return false;
+}
+
+static int __sxlatch_drain_asym( sxlatch_t * r )
+{
+    /* the handshake with the readers(supported: sxlatch_init_attr()) */
+    (void)process_membarrier();
+
+    while( sxlatch_asym_is_read( r ) == true )
+    {
+        sched_yield();
+    }
+
+    return RC_SUCCESS;
+}
+
+static int __sxlatch_Xlock_asym( sxlatch_t *  r,
+                                 session_id_t session_id,
+                                 const void * caller )
+{
+    int ret = __sxlatch_Xlock_default( r, session_id, caller );
+
+    if( ret == RC_SUCCESS )
+    {
+        __sxlatch_drain_asym( r );
+    }
+
+    return ret;
+}
+
+static int __sxlatch_intXlock_asym( sxlatch_t *  r,
+                                    session_id_t session_id,
+                                    const void * caller )
+{
+    int ret = __sxlatch_intXlock_default( r, session_id, caller );
+
+    if( ret == RC_SUCCESS )
+    {
+        __sxlatch_drain_asym( r );
+    }
+
+    return ret;
+}
+
+static int __sxlatch_wrlock_asym( sxlatch_t *  r,
+                                  session_id_t session_id,
+                                  const void * caller )
+{
+    int ret = __sxlatch_wrlock_default( r, session_id, caller );
+
+    if( ret == RC_SUCCESS )
+    {
+        __sxlatch_drain_asym( r );
+    }
+
+    return ret;
+}
+
+static int __sxlatch_intwrlock_asym( sxlatch_t *  r,
+                                     session_id_t session_id,
+                                     const void * caller )
+{
+    int ret = __sxlatch_intwrlock_default( r, session_id, caller );
+
+    if( ret == RC_SUCCESS )
+    {
+        __sxlatch_drain_asym( r );
+    }
+
+    return ret;
+}
+
+static int __sxlatch_trywrlock_asym( sxlatch_t * r, session_id_t session_id )
+{
+    int ret = __sxlatch_trywrlock_default( r, session_id );
+
+    if( ret == RC_SUCCESS )
+    {
+        (void)process_membarrier();
+
+        if( sxlatch_asym_is_read( r ) == true )
+        {
+            /* readers are in: give X back */
+            __sxlatch_unlock_default( r, session_id );
+            SXLATCH_TRACE( r, SXLATCH_TRACE_BUSY, session_id, BF_LATCH_MODE_X_ACQUIRED );
+            ret = RC_ERR_LOCK_BUSY;
+        }
+    }
+
+    return ret;
+}
+
+static int __sxlatch_rdlock_asym( sxlatch_t *  r,
+                                  session_id_t session_id,
+                                  const void * caller )
+{
+    if( __sxlatch_asym_enter( r, session_id ) == true )
+    {
+        __sxlatch_on_acquire( r, session_id, BF_LATCH_MODE_S, 0 /* no wait */ );
+        return RC_SUCCESS;
+    }
+
+    return __sxlatch_rdlock_default( r, session_id, caller );
+}
+
+static int __sxlatch_tryrdlock_asym( sxlatch_t * r, session_id_t session_id )
+{
+    if( __sxlatch_asym_enter( r, session_id ) == true )
+    {
+        __sxlatch_on_acquire( r, session_id, BF_LATCH_MODE_S, 0 /* no wait */ );
+        return RC_SUCCESS;
+    }
+
+    return __sxlatch_tryrdlock_default( r, session_id );
+}
+
+static int __sxlatch_intrdlock_asym( sxlatch_t *  r,
+                                     session_id_t session_id,
+                                     const void * caller )
+{
+    if( __sxlatch_asym_enter( r, session_id ) == true )
+    {
+        __sxlatch_on_acquire( r, session_id, BF_LATCH_MODE_S, 0 /* no wait */ );
+        return RC_SUCCESS;
+    }
+
+    return __sxlatch_intrdlock_default( r, session_id, caller );
+}
+
+static int __sxlatch_unlock_asym( sxlatch_t * r, session_id_t session_id )
+{
+    if( __sxlatch_asym_leave( r ) == true )
+    {
+        __sxlatch_on_release( r, session_id, BF_LATCH_MODE_S );
+        return RC_SUCCESS;
+    }
+
+    return __sxlatch_unlock_default( r, session_id );
+}
+
+/* inflated latches(inflate.h)
+ * policy_word: index of the side structure, aux_word: unused.
+ * A reader adds itself to its shard, then reads value: while the mode is
+ * S and the latch is still inflated to the same structure, it holds S.
+ * Otherwise it takes the shard back and waits. The shard counts are
+ * atomic, so a writer which took X on value only has to wait until the
+ * shards are empty, as it waits for the readers in value. S taken through
+ * a shard is remembered by the session(session.h), so any thread may
+ * release it for the session. */
+#define SXLATCH_INFLATE_PARK_USEC    1000
+
+#define SXLATCH_INFLATE_ENTERED      0      /* S is held through a shard */
+#define SXLATCH_INFLATE_NONE         1      /* use the plain protocol */
+#define SXLATCH_INFLATE_WAIT         2      /* a writer is in */
+
+/* inflate a DEFAULT latch: no X is needed. A writer reads the policy after
+ * its CAS on value; if it still saw DEFAULT, a reader which comes through
+ * the shards later finds the writer in value. */
+static void __sxlatch_inflate( sxlatch_t * r )
+{
+    int32_t idx = 0;
+
+    r->aux_word = 0;
+
+    if( r->policy_word != 0 )
+    {
+        return;
+    }
+
+    idx = sxlatch_inflated_alloc( r );
+    if( idx == 0 )
+    {
+        /* the pool is full: stay compact */
+        return;
+    }
+
+    if( atomic_cas_32( &(r->policy_word), 0, idx ) != 0 )
+    {
+        sxlatch_inflated_free( idx );
+        return;
+    }
+
+    mem_barrier();
+    r->policy = SXLATCH_POLICY_INFLATED;
+    mem_barrier();
+
+    sxlatch_inflate_count( true );
+}
+
+/* the X holder deflates the latch: the shards are drained */
+static void __sxlatch_deflate( sxlatch_t * r, sxlatch_inflated_t * p )
+{
+    uint64_t now   = get_time();
+    uint64_t reads = 0;
+    int32_t  idx   = 0;
+
+    if( get_elapsed_time( now - p->epoch_begin ) <
+        (double)__sxlatch_deflate_msec * 1000000.0 )
+    {
+        return;
+    }
+
+    reads = sxlatch_inflated_reads( p );
+    if( reads - p->epoch_reads >= (uint64_t)__sxlatch_deflate_reads )
+    {
+        /* still hot: next window */
+        p->epoch_begin = now;
+        p->epoch_reads = reads;
+        return;
+    }
+
+    r->policy = SXLATCH_POLICY_DEFAULT;
+    mem_barrier();
+
+    idx            = r->policy_word;
+    r->policy_word = 0;
+    r->aux_word    = 0;
+
+    sxlatch_inflated_free( idx );
+    sxlatch_inflate_count( false );
+}
+
+static inline int __sxlatch_inflated_enter( sxlatch_t * r, session_id_t session_id )
+{
+    int32_t idx = r->policy_word;
+    sxlatch_inflated_t * p = sxlatch_inflated_get( idx );
+    sxlatch_inflate_shard_t * shard = NULL;
+    sxlatch_session_t * sess = NULL;
+    sxlatch_session_shard_holds_t * holds = NULL;
+
+    /* a proxy(the async granter) takes S on value: the shard holds of a
+     * session are changed by the threads of the session only */
+    if( p == NULL || r->cleanup_in_progress_cnt > 0 || __sxlatch_hold_by_proxy != 0 )
+    {
+        return SXLATCH_INFLATE_NONE;
+    }
+
+    sess  = sxlatch_session_get( session_id );
+    holds = ( sess != NULL ) ? sxlatch_session_get_shard_holds( sess ) : NULL;
+    if( holds == NULL || holds->cnt == SXLATCH_SESSION_SHARD_HOLD_CNT )
+    {
+        return SXLATCH_INFLATE_NONE;
+    }
+
+    shard = sxlatch_inflated_my_shard( p );
+    atomic_fetch_inc( &(shard->readers) );
+
+    if( p->latch == r && r->policy_word == idx )
+    {
+        if( SXLATCH_GET_MODE( SXLATCH_GET_VALUE( r ) ) == SXLATCH_MODE_S )
+        {
+            shard->reads++;
+
+            holds->holds[holds->cnt].latch   = r;
+            holds->holds[holds->cnt].readers = &(shard->readers);
+            holds->cnt++;
+
+            return SXLATCH_INFLATE_ENTERED;
+        }
+
+        atomic_fetch_dec( &(shard->readers) );
+        return SXLATCH_INFLATE_WAIT;
+    }
+
+    /* deflated meanwhile */
+    atomic_fetch_dec( &(shard->readers) );
+    return SXLATCH_INFLATE_NONE;
+}
+
+static inline bool __sxlatch_inflated_leave( sxlatch_t * r, session_id_t session_id )
+{
+    sxlatch_session_t * sess = sxlatch_session_get( session_id );
+    sxlatch_session_shard_holds_t * holds = ( sess != NULL ) ? sess->shard_holds : NULL;
+    int hold = 0;
+
+    if( holds == NULL )
+    {
+        return false;
+    }
+
+    for( hold = holds->cnt - 1; hold >= 0; hold-- )
+    {
+        if( holds->holds[hold].latch == r )
+        {
+            atomic_fetch_dec( holds->holds[hold].readers );
+
+            holds->cnt--;
+            for( ; hold < holds->cnt; hold++ )
+            {
+                holds->holds[hold] = holds->holds[hold + 1];
+            }
+            return true;
+        }
+    }
+
+    /* S was taken on value */
+    return false;
+}
+
+/* sleep in the waiter queue until the writer releases */
+static void __sxlatch_inflated_park( sxlatch_t * r )
+{
+    sxlatch_inflated_t * p = sxlatch_inflated_get( r->policy_word );
+    int32_t seq = 0;
+
+    if( p == NULL )
+    {
+        return;
+    }
+
+    seq = p->wake_seq;
+    atomic_fetch_inc( &(p->waiters) );
+
+    if( SXLATCH_GET_MODE( SXLATCH_GET_VALUE( r ) ) != SXLATCH_MODE_S &&
+        r->policy == SXLATCH_POLICY_INFLATED )
+    {
+        p->parks++;
+        (void)futex_wait( &(p->wake_seq), seq, SXLATCH_INFLATE_PARK_USEC );
+    }
+
+    atomic_fetch_dec( &(p->waiters) );
+}
+
+static void __sxlatch_inflated_wake( sxlatch_inflated_t * p )
+{
+    atomic_inc_fetch( &(p->wake_seq) );
+    if( p->waiters > 0 )
+    {
+        futex_wake( &(p->wake_seq), 0 /* all */ );
+    }
+}
+
+/* wait until the shard readers are gone. sess: the waiter gives up when
+ * it is interrupted(RC_ERR_LOCK_INTERRUPTED), NULL: it does not */
+static int __sxlatch_drain_shards( sxlatch_inflated_t * p, sxlatch_session_t * sess )
+{
+    int yield_cnt = __sxlatch_X_yield_loop_cnt;
+
+    while( sxlatch_inflated_readers( p ) != 0 )
+    {
+        TRY( sess != NULL && is_session_interrupted( sess ) );
+
+        if( yield_cnt-- > 0 )
+        {
+            sched_yield();
+        }
+        else
+        {
+            yield_cnt = __sxlatch_X_yield_loop_cnt;
+
+            if( __latch_use_sleep )
+            {
+                thread_sleep( 0, 1 );
+            }
+        }
+    }
+
+    return RC_SUCCESS;
+
+    CATCH_END;
+
+    return RC_ERR_LOCK_INTERRUPTED;
+}
+
+static int __sxlatch_drain_inflated( sxlatch_t * r )
+{
+    sxlatch_inflated_t * p = sxlatch_inflated_get( r->policy_word );
+
+    return ( p != NULL ) ? __sxlatch_drain_shards( p, NULL ) : RC_SUCCESS;
+}
+
+/* X(xvalue) was just taken on value: an inflated latch waits for its
+ * shard readers, as long as they hold S. An interrupted int*lock() gives
+ * X back. */
+static inline int __sxlatch_x_drain( sxlatch_t *         r,
+                                     int64_t             xvalue,
+                                     sxlatch_session_t * sess )
+{
+    sxlatch_inflated_t * p = NULL;
+
+    if( r->policy != SXLATCH_POLICY_INFLATED )
+    {
+        return RC_SUCCESS;
+    }
+
+    p = sxlatch_inflated_get( r->policy_word );
+    TRY( p != NULL && __sxlatch_drain_shards( p, sess ) != RC_SUCCESS );
+
+    return RC_SUCCESS;
+
+    CATCH_END;
+
+    (void)atomic_fetch_sub( &(SXLATCH_GET_VALUE( r )), xvalue );
+    __sxlatch_inflated_wake( p );
+
+    return RC_ERR_LOCK_INTERRUPTED;
+}
+
+static int __sxlatch_rdlock_inflated( sxlatch_t *  r,
+                                      session_id_t session_id,
+                                      const void * caller )
+{
+    int yield_cnt = __sxlatch_X_yield_loop_cnt;
+    uint64_t contended_at = 0;
+
+    while( true )
+    {
+        switch( __sxlatch_inflated_enter( r, session_id ) )
+        {
+            case SXLATCH_INFLATE_ENTERED:
+                __sxlatch_on_acquire( r, session_id, BF_LATCH_MODE_S, contended_at );
+                __sxlatch_on_contended_acquire( r, session_id, BF_LATCH_MODE_S, contended_at,
+                                                 caller );
+                return RC_SUCCESS;
+
+            case SXLATCH_INFLATE_NONE:
+                __sxlatch_on_contended_fail( r, session_id, BF_LATCH_MODE_S, contended_at );
+                return __sxlatch_rdlock_default( r, session_id, caller );
+
+            default:
+                break;
+        }
+
+        if( contended_at == 0 )
+        {
+            contended_at = __sxlatch_on_contention();
+        }
+
+        if( yield_cnt-- > 0 )
+        {
+            sched_yield();
+        }
+        else
+        {
+            __sxlatch_inflated_park( r );
+        }
+    }
+}
+
+static int __sxlatch_tryrdlock_inflated( sxlatch_t * r, session_id_t session_id )
+{
+    switch( __sxlatch_inflated_enter( r, session_id ) )
+    {
+        case SXLATCH_INFLATE_ENTERED:
+            __sxlatch_on_acquire( r, session_id, BF_LATCH_MODE_S, 0 /* no wait */ );
+            return RC_SUCCESS;
+
+        case SXLATCH_INFLATE_WAIT:
+            SXLATCH_TRACE( r, SXLATCH_TRACE_BUSY, session_id, BF_LATCH_MODE_S );
+            return EBUSY;
+
+        default:
+            break;
+    }
+
+    return __sxlatch_tryrdlock_default( r, session_id );
+}
+
+/* the interruptible wait is the one of the plain protocol */
+static int __sxlatch_intrdlock_inflated( sxlatch_t *  r,
+                                         session_id_t session_id,
+                                         const void * caller )
+{
+    if( __sxlatch_inflated_enter( r, session_id ) == SXLATCH_INFLATE_ENTERED )
+    {
+        __sxlatch_on_acquire( r, session_id, BF_LATCH_MODE_S, 0 /* no wait */ );
+        return RC_SUCCESS;
+    }
+
+    return __sxlatch_intrdlock_default( r, session_id, caller );
+}
+
+static int __sxlatch_unlock_inflated( sxlatch_t * r, session_id_t session_id )
+{
+    sxlatch_inflated_t * p = NULL;
+    int64_t oldvalue = 0;
+    int ret = 0;
+
+    if( __sxlatch_inflated_leave( r, session_id ) == true )
+    {
+        __sxlatch_on_release( r, session_id, BF_LATCH_MODE_S );
+        return RC_SUCCESS;
+    }
+
+    oldvalue = SXLATCH_GET_VALUE( r );
+    if( SXLATCH_GET_MODE( oldvalue ) != SXLATCH_MODE_X_ACQUIRED ||
+        SXLATCH_GET_SESSION_ID( oldvalue ) != session_id )
+    {
+        /* S on value: the session holds none in the shards */
+        TRY( SXLATCH_GET_SHARED_CNT( oldvalue ) == 0 );
+        return __sxlatch_unlock_default( r, session_id );
+    }
+
+    /* X is held: the side structure cannot change under us */
+    p = sxlatch_inflated_get( r->policy_word );
+    if( p != NULL )
+    {
+        p->writes++;
+        __sxlatch_deflate( r, p );
+    }
+
+    ret = __sxlatch_unlock_default( r, session_id );
+
+    if( p != NULL )
+    {
+        __sxlatch_inflated_wake( p );
+    }
+
+    return ret;
+
+    CATCH_END;
+
+    return RC_FAIL;
+}
+
+/* phase-fair policy
+ * policy_word: | phase(8 bits) | readers waiting for the writer(24 bits) |
+ * A reader which finds a writer in(X_BLOCKED or X_ACQUIRED) registers in
+ * the current phase and waits. Releasing X, the writer closes the phase:
+ * it takes the registered count, opens the next phase and turns the latch
+ * into S with that count, so the waiting readers are in before any other
+ * writer can block. A reader which sees the writer gone while the phase
+ * is unchanged(X_BLOCKED rolled back, recovery) takes its registration back.
+ * The phase cannot wrap around a waiting reader: once granted, its S count
+ * keeps every writer out until it unlocks. */
+#define SXLATCH_PF_PHASE_SHIFT      24
+#define SXLATCH_PF_MASK_CNT         ((int32_t)0x00FFFFFF)
+#define SXLATCH_PF_GET_PHASE( w )   (((uint32_t)(w)) >> SXLATCH_PF_PHASE_SHIFT)
+#define SXLATCH_PF_GET_CNT( w )     ((w) & SXLATCH_PF_MASK_CNT)
+#define SXLATCH_PF_NEXT_PHASE( w )  \
+  ((int32_t)((SXLATCH_PF_GET_PHASE( w ) + 1) << SXLATCH_PF_PHASE_SHIFT))
+
+#define SXLATCH_PF_GRANTED          0  /* S is held */
+#define SXLATCH_PF_RETRY            1  /* the writer left: try S again */
+#define SXLATCH_PF_INTERRUPTED      2
+
+/* wait for the end of the writer phase
+ * sess: NULL if the wait cannot be interrupted */
+static int __sxlatch_pf_wait( sxlatch_t * r, sxlatch_session_t * sess )
+{
+    int  yield_cnt = __sxlatch_yield_loop_cnt;
+    uint32_t phase = 0;
+    int32_t  word  = 0;
+    uint32_t backoff = 0;
+    bool interrupted = false;
+
+    phase = SXLATCH_PF_GET_PHASE( atomic_fetch_inc( &(r->policy_word) ) );
+
+    while( true )
+    {
+        word = r->policy_word;
+
+        if( SXLATCH_PF_GET_PHASE( word ) != phase )
+        {
+            /* granted: the writer publishes the S count right after */
+            while( SXLATCH_GET_MODE( SXLATCH_GET_VALUE( r ) ) == SXLATCH_MODE_X_ACQUIRED )
+            {
+                mem_barrier();
+            }
+            return SXLATCH_PF_GRANTED;
+        }
+
+        /* once taken, a one-shot interrupt is not seen again */
+        interrupted = ( interrupted == true ) ? true : is_session_interrupted( sess );
+
+        if( interrupted == true ||
+            SXLATCH_GET_MODE( SXLATCH_GET_VALUE( r ) ) == SXLATCH_MODE_S )
+        {
+            if( word == atomic_cas_32( &(r->policy_word), word, word - 1 ) )
+            {
+                return ( interrupted == true ) ?
+                       SXLATCH_PF_INTERRUPTED : SXLATCH_PF_RETRY;
+            }
+
+            /* granted or another reader came: check again */
+            __sxlatch_cas_backoff( &backoff );
+            continue;
+        }
+
+        if( yield_cnt-- > 0 )
+        {
+            sched_yield();
+        }
+        else
+        {
+            yield_cnt = __sxlatch_yield_loop_cnt;
+
+            if( __latch_use_sleep )
+            {
+                if( sess != NULL )
+                {
+                    sxlatch_session_sleep( sess, 1 );
+                }
+                else
+                {
+                    thread_sleep( 0, 1 );
+                }
+            }
+        }
+    }
+}
+
+static int __sxlatch_rdlock_phase_fair( sxlatch_t *  r,
+                                        session_id_t session_id,
+                                        const void * caller )
+{
+    int64_t oldvalue = 0LL;
+    int      ret = 0;
+    uint64_t wait_begin = 0;
+    uint64_t contended_at = 0;
+    uint32_t backoff = 0;
+
+    TRY_GOTO( r->cleanup_in_progress_cnt > 0, err_cleanup_progress );
+
+    wait_begin = __sxlatch_on_request( r, session_id, BF_LATCH_MODE_S );
+
+    while( true )
+    {
+        oldvalue = SXLATCH_GET_VALUE( r );
+
+        if( SXLATCH_GET_MODE( oldvalue ) == SXLATCH_MODE_S )
+        {
+            if( oldvalue == atomic_cas_64( &(SXLATCH_GET_VALUE( r )),
+                                           oldvalue,
+                                           oldvalue + 1 ) )
+            {
+                break;
+            }
+
+            /* try again */
+            __sxlatch_cas_backoff( &backoff );
+            continue;
+        }
+
+        if( contended_at == 0 )
+        {
+            contended_at = __sxlatch_on_contention();
+        }
+
+        if( __sxlatch_pf_wait( r, NULL ) == SXLATCH_PF_GRANTED )
+        {
+            break;
+        }
+    }
+
+    __sxlatch_on_acquire( r, session_id, BF_LATCH_MODE_S, wait_begin );
+    __sxlatch_on_contended_acquire( r, session_id, BF_LATCH_MODE_S, contended_at,
+                                     caller );
+
+    return RC_SUCCESS;
+
+    CATCH( err_cleanup_progress )
+    {
+        SXLATCH_TRACE( r, SXLATCH_TRACE_TIMEOUT, session_id, BF_LATCH_MODE_S );
+        ret = RC_ERR_LOCK_TIMEOUT;
+    }
+    CATCH_END;
+
+    return ret;
+}
+
+static int __sxlatch_intrdlock_phase_fair( sxlatch_t *  r,
+                                           session_id_t session_id,
+                                           const void * caller )
+{
+    int64_t oldvalue = 0LL;
+    int      ret = 0;
+    uint64_t wait_begin = 0;
+    uint64_t contended_at = 0;
+    uint32_t backoff = 0;
+    sxlatch_session_t * sess = sxlatch_session_get( session_id );
+
+    TRY_GOTO( r->cleanup_in_progress_cnt > 0, err_cleanup_progress );
+
+    wait_begin = __sxlatch_on_request( r, session_id, BF_LATCH_MODE_S );
+    __sxlatch_set_waiting( sess, r );
+
+    while( true )
+    {
+        TRY_GOTO( is_session_interrupted( sess ), err_was_interrupted );
+
+        oldvalue = SXLATCH_GET_VALUE( r );
+
+        if( SXLATCH_GET_MODE( oldvalue ) == SXLATCH_MODE_S )
+        {
+            if( oldvalue == atomic_cas_64( &(SXLATCH_GET_VALUE( r )),
+                                           oldvalue,
+                                           oldvalue + 1 ) )
+            {
+                break;
+            }
+
+            /* try again */
+            __sxlatch_cas_backoff( &backoff );
+            continue;
+        }
+
+        if( contended_at == 0 )
+        {
+            contended_at = __sxlatch_on_contention();
+        }
+
+        ret = __sxlatch_pf_wait( r, sess );
+        if( ret == SXLATCH_PF_GRANTED )
+        {
+            break;
+        }
+        TRY_GOTO( ret == SXLATCH_PF_INTERRUPTED, err_was_interrupted );
+    }
+
+    __sxlatch_set_waiting( sess, NULL );
+    __sxlatch_on_acquire( r, session_id, BF_LATCH_MODE_S, wait_begin );
+    __sxlatch_on_contended_acquire( r, session_id, BF_LATCH_MODE_S, contended_at,
+                                     caller );
+
+    return RC_SUCCESS;
+
+    CATCH( err_cleanup_progress )
+    {
+        SXLATCH_TRACE( r, SXLATCH_TRACE_TIMEOUT, session_id, BF_LATCH_MODE_S );
+        ret = RC_ERR_LOCK_TIMEOUT;
+    }
+    CATCH( err_was_interrupted )
+    {
+        SXLATCH_TRACE( r, SXLATCH_TRACE_INTERRUPT, session_id, BF_LATCH_MODE_S );
+        ret = RC_ERR_LOCK_INTERRUPTED;
+    }
+    CATCH_END;
+
+    __sxlatch_set_waiting( sess, NULL );
+    __sxlatch_on_contended_fail( r, session_id, BF_LATCH_MODE_S, contended_at );
+
+    return ret;
+}
+
+static int __sxlatch_unlock_phase_fair( sxlatch_t * r, session_id_t session_id )
+{
+    int64_t oldvalue = SXLATCH_GET_VALUE( r );
+    int32_t word = 0;
+    uint32_t backoff = 0;
+
+    if( SXLATCH_GET_MODE( oldvalue ) != SXLATCH_MODE_X_ACQUIRED )
+    {
+        /* S: nothing to hand over */
+        return __sxlatch_unlock_default( r, session_id );
+    }
+
+    TRY( SXLATCH_GET_SESSION_ID( oldvalue ) != session_id );
+
+    /* close the writer phase: readers keep registering meanwhile */
+    while( true )
+    {
+        word = r->policy_word;
+        if( word == atomic_cas_32( &(r->policy_word),
+                                   word,
+                                   SXLATCH_PF_NEXT_PHASE( word ) ) )
+        {
+            break;
+        }
+        __sxlatch_cas_backoff( &backoff );
+    }
+
+    /* admit the readers of the closed phase(UNLOCKED if none).
+     * Nobody else changes X_ACQUIRED of this session. */
+    while( oldvalue != atomic_cas_64( &(SXLATCH_GET_VALUE( r )),
+                                      oldvalue,
+                                      SXLATCH_MAKE_LATCH_VALUE( SXLATCH_MODE_S,
+                                                                0,
+                                                                SXLATCH_PF_GET_CNT( word ) ) ) )
+    {
+        oldvalue = SXLATCH_GET_VALUE( r );
+    }
+
+    __sxlatch_on_release( r, session_id, BF_LATCH_MODE_X_ACQUIRED );
+
+    return RC_SUCCESS;
+
+    CATCH_END;
+
+    return RC_FAIL;
+}
+
+/* public entry points: dispatch to the policy of the latch.
+ * With hold tracking on, the request and its result go to the hold log
+ * of the session(session.h). */
+#define SXLATCH_TRACK_HOLDS()    \
+  __builtin_expect( __sxlatch_hold_track_enabled != 0 && __sxlatch_hold_by_proxy == 0, 0 )
+
+int sxlatch_Xlock( sxlatch_t * r, session_id_t session_id )
+{
+    int ret = 0;
+
+    if( SXLATCH_TRACK_HOLDS() )
+    {
+        sxlatch_session_hold_request( session_id, r, BF_LATCH_MODE_X_ACQUIRED );
+    }
+
+    ret = __sxlatch_policy_ops[r->policy].Xlock( r, session_id,
+                                                 __builtin_return_address( 0 ) );
+
+    if( SXLATCH_TRACK_HOLDS() )
+    {
+        sxlatch_session_hold_result( session_id, r,
+                                     ( ret == RC_SUCCESS ) ? true : false );
+    }
+
+    return ret;
+}
+
+int sxlatch_intXlock( sxlatch_t * r, session_id_t session_id )
+{
+    int ret = 0;
+
+    if( SXLATCH_TRACK_HOLDS() )
+    {
+        sxlatch_session_hold_request( session_id, r, BF_LATCH_MODE_X_ACQUIRED );
+    }
+
+    ret = __sxlatch_policy_ops[r->policy].intXlock( r, session_id,
+                                                    __builtin_return_address( 0 ) );
+
+    if( SXLATCH_TRACK_HOLDS() )
+    {
+        sxlatch_session_hold_result( session_id, r,
+                                     ( ret == RC_SUCCESS ) ? true : false );
+    }
+
+    return ret;
+}
+
+int sxlatch_rdlock( sxlatch_t * r, session_id_t session_id )
+{
+    int ret = 0;
+
+    if( SXLATCH_TRACK_HOLDS() )
+    {
+        sxlatch_session_hold_request( session_id, r, BF_LATCH_MODE_S );
+    }
+
+    ret = __sxlatch_policy_ops[r->policy].rdlock( r, session_id,
+                                                  __builtin_return_address( 0 ) );
+
+    if( SXLATCH_TRACK_HOLDS() )
+    {
+        sxlatch_session_hold_result( session_id, r,
+                                     ( ret == RC_SUCCESS ) ? true : false );
+    }
+
+    return ret;
+}
+
+int sxlatch_tryrdlock( sxlatch_t * r, session_id_t session_id )
+{
+    int ret = 0;
+
+    if( SXLATCH_TRACK_HOLDS() )
+    {
+        sxlatch_session_hold_request( session_id, r, BF_LATCH_MODE_S );
+    }
+
+    ret = __sxlatch_policy_ops[r->policy].tryrdlock( r, session_id );
+
+    if( SXLATCH_TRACK_HOLDS() )
+    {
+        sxlatch_session_hold_result( session_id, r,
+                                     ( ret == RC_SUCCESS ) ? true : false );
+    }
+
+    return ret;
+}
+
+int sxlatch_wrlock( sxlatch_t * r, session_id_t session_id )
+{
+    int ret = 0;
+
+    if( SXLATCH_TRACK_HOLDS() )
+    {
+        sxlatch_session_hold_request( session_id, r, BF_LATCH_MODE_X_ACQUIRED );
+    }
+
+    ret = __sxlatch_policy_ops[r->policy].wrlock( r, session_id,
+                                                  __builtin_return_address( 0 ) );
+
+    if( SXLATCH_TRACK_HOLDS() )
+    {
+        sxlatch_session_hold_result( session_id, r,
+                                     ( ret == RC_SUCCESS ) ? true : false );
+    }
+
+    return ret;
+}
+
+int sxlatch_trywrlock( sxlatch_t * r, session_id_t session_id )
+{
+    int ret = 0;
+
+    if( SXLATCH_TRACK_HOLDS() )
+    {
+        sxlatch_session_hold_request( session_id, r, BF_LATCH_MODE_X_ACQUIRED );
+    }
+
+    ret = __sxlatch_policy_ops[r->policy].trywrlock( r, session_id );
+
+    if( SXLATCH_TRACK_HOLDS() )
+    {
+        sxlatch_session_hold_result( session_id, r,
+                                     ( ret == RC_SUCCESS ) ? true : false );
+    }
+
+    return ret;
+}
+
+/* a writer which does not wait(async.h): the steps of sxlatch_wrlock(),
+ * one call at a time. The X_BLOCKED mark stays between the calls. */
+static int __sxlatch_trywrlock_mark( sxlatch_t * r, session_id_t session_id )
+{
+    int ret = RC_FAIL;
+    int64_t oldvalue = 0;
+    int64_t newvalue = 0;
+
+    TRY_GOTO( r->cleanup_in_progress_cnt > 0, err_cleanup_progress );
+
+    while( true )
+    {
+        oldvalue = SXLATCH_GET_VALUE( r );
+
+        if( oldvalue == SXLATCH_UNLOCKED ||
+            ( SXLATCH_GET_MODE( oldvalue ) == SXLATCH_MODE_X_BLOCKED &&
+              session_id == (int)SXLATCH_GET_SESSION_ID( oldvalue ) &&
+              SXLATCH_GET_SHARED_CNT( oldvalue ) == 0 ) )
+        {
+            newvalue = SXLATCH_MAKE_LATCH_VALUE( SXLATCH_MODE_X_ACQUIRED,
+                                                 session_id,
+                                                 0 /* shared cnt */ );
+            if( oldvalue != atomic_cas_64( &(SXLATCH_GET_VALUE( r )),
+                                           oldvalue,
+                                           newvalue ) )
+            {
+                continue;
+            }
+
+            if( r->policy == SXLATCH_POLICY_INFLATED &&
+                sxlatch_inflated_readers( sxlatch_inflated_get( r->policy_word ) ) != 0 )
+            {
+                /* readers are in the shards: keep the mark only */
+                (void)atomic_fetch_add( &(SXLATCH_GET_VALUE( r )),
+                                        SXLATCH_MODE_X_BLOCKED - SXLATCH_MODE_X_ACQUIRED );
+                TRY_GOTO( oldvalue == SXLATCH_UNLOCKED, err_marked );
+                TRY_GOTO( true, err_busy );
+            }
+
+            if( oldvalue != SXLATCH_UNLOCKED &&
+                r->policy == SXLATCH_POLICY_WRITER_PREF )
+            {
+                atomic_fetch_dec( &(r->policy_word) );
+            }
+            break;
+        }
+
+        TRY_GOTO( SXLATCH_GET_MODE( oldvalue ) != SXLATCH_MODE_S, err_busy );
+
+        newvalue = SXLATCH_MAKE_LATCH_VALUE( SXLATCH_MODE_X_BLOCKED,
+                                             session_id,
+                                             SXLATCH_GET_SHARED_CNT( oldvalue ) );
+        if( oldvalue == atomic_cas_64( &(SXLATCH_GET_VALUE( r )),
+                                       oldvalue,
+                                       newvalue ) )
+        {
+            /* a waiting writer of WRITER_PREF while the mark is ours */
+            if( r->policy == SXLATCH_POLICY_WRITER_PREF )
+            {
+                atomic_fetch_inc( &(r->policy_word) );
+            }
+            TRY_GOTO( true, err_marked );
+        }
+    }
+
+    __sxlatch_on_acquire( r, session_id, BF_LATCH_MODE_X_ACQUIRED, 0 /* no wait */ );
+
+    return RC_SUCCESS;
+
+    CATCH( err_cleanup_progress )
+    {
+        SXLATCH_TRACE( r, SXLATCH_TRACE_TIMEOUT, session_id, BF_LATCH_MODE_X_ACQUIRED );
+        ret = RC_ERR_LOCK_TIMEOUT;
+    }
+    CATCH( err_marked )
+    {
+        SXLATCH_TRACE( r, SXLATCH_TRACE_X_BLOCKED, session_id, BF_LATCH_MODE_X_ACQUIRED );
+        ret = RC_ERR_LOCK_BUSY;
+    }
+    CATCH( err_busy )
+    {
+        SXLATCH_TRACE( r, SXLATCH_TRACE_BUSY, session_id, BF_LATCH_MODE_X_ACQUIRED );
+        ret = RC_ERR_LOCK_BUSY;
+    }
+    CATCH_END;
+
+    return ret;
+}
+
+int sxlatch_trywrlock_mark( sxlatch_t * r, session_id_t session_id )
+{
+    int ret = RC_FAIL;
+
+    /* the writers of the policy must be the default ones */
+    TRY( __sxlatch_policy_ops[r->policy].trywrlock != __sxlatch_trywrlock_default );
+
+    if( SXLATCH_TRACK_HOLDS() )
+    {
+        sxlatch_session_hold_request( session_id, r, BF_LATCH_MODE_X_ACQUIRED );
+    }
+
+    ret = __sxlatch_trywrlock_mark( r, session_id );
+
+    if( SXLATCH_TRACK_HOLDS() )
+    {
+        sxlatch_session_hold_result( session_id, r,
+                                     ( ret == RC_SUCCESS ) ? true : false );
+    }
+
+    return ret;
+
+    CATCH_END;
+
+    return ret;
+}
+
+int sxlatch_trywrlock_unmark( sxlatch_t * r, session_id_t session_id )
+{
+    int64_t oldvalue = SXLATCH_GET_VALUE( r );
+
+    TRY( SXLATCH_GET_MODE( oldvalue ) != SXLATCH_MODE_X_BLOCKED ||
+         session_id != (int)SXLATCH_GET_SESSION_ID( oldvalue ) );
+
+    /* only this session moves the mark */
+    __sxlatch_unblock_x( r, session_id );
+
+    if( r->policy == SXLATCH_POLICY_WRITER_PREF )
+    {
+        atomic_fetch_dec( &(r->policy_word) );
+    }
+    SXLATCH_ASYNC_NOTIFY();
+
+    return RC_SUCCESS;
+
+    CATCH_END;
+
+    return RC_FAIL;
+}
+
+int sxlatch_intrdlock( sxlatch_t * r, session_id_t session_id )
+{
+    int ret = 0;
+
+    if( SXLATCH_TRACK_HOLDS() )
+    {
+        sxlatch_session_hold_request( session_id, r, BF_LATCH_MODE_S );
+    }
+
+    ret = __sxlatch_policy_ops[r->policy].intrdlock( r, session_id,
+                                                     __builtin_return_address( 0 ) );
+
+    if( SXLATCH_TRACK_HOLDS() )
+    {
+        sxlatch_session_hold_result( session_id, r,
+                                     ( ret == RC_SUCCESS ) ? true : false );
+    }
+
+    return ret;
+}
+
+int sxlatch_intwrlock( sxlatch_t * r, session_id_t session_id )
+{
+    int ret = 0;
+
+    if( SXLATCH_TRACK_HOLDS() )
+    {
+        sxlatch_session_hold_request( session_id, r, BF_LATCH_MODE_X_ACQUIRED );
+    }
+
+    ret = __sxlatch_policy_ops[r->policy].intwrlock( r, session_id,
+                                                     __builtin_return_address( 0 ) );
+
+    if( SXLATCH_TRACK_HOLDS() )
+    {
+        sxlatch_session_hold_result( session_id, r,
+                                     ( ret == RC_SUCCESS ) ? true : false );
+    }
+
+    return ret;
+}
+
+int sxlatch_unlock( sxlatch_t * r, session_id_t session_id )
+{
+    int ret = 0;
+
+    if( SXLATCH_TRACK_HOLDS() )
+    {
+        sxlatch_session_hold_release( session_id, r );
+    }
+
+    ret = __sxlatch_policy_ops[r->policy].unlock( r, session_id );
+    SXLATCH_ASYNC_NOTIFY();
+
+    return ret;
+}
+
+int sxlatch_rdunlock( sxlatch_t * r, session_id_t session_id )
+{
+    int ret = 0;
+
+    if( SXLATCH_TRACK_HOLDS() )
+    {
+        sxlatch_session_hold_release( session_id, r );
+    }
+
+    ret = __sxlatch_policy_ops[r->policy].rdunlock( r, session_id );
+    SXLATCH_ASYNC_NOTIFY();
+
+    return ret;
+}
+
+int sxlatch_wrunlock( sxlatch_t * r, session_id_t session_id )
+{
+    int ret = 0;
+
+    if( SXLATCH_TRACK_HOLDS() )
+    {
+        sxlatch_session_hold_release( session_id, r );
+    }
+
+    ret = __sxlatch_policy_ops[r->policy].wrunlock( r, session_id );
+    SXLATCH_ASYNC_NOTIFY();
+
+    return ret;
+}
+
+int sxlatch_interrupt_session( session_id_t session_id )
+{
+    return sxlatch_session_interrupt( session_id );
+}
+
+int sxlatch_clear_session_interrupt( session_id_t session_id )
+{
+    return sxlatch_session_clear_interrupt( session_id );
+}
+
+/* value-word holds: the recovery matrix applies. PHASE_FAIR and BOUNDED
+ * hand over or wake in their unlock, which works on value by session id. */
+static inline bool __sxlatch_recoverable( sxlatch_t * r )
+{
+    return ( r->policy != SXLATCH_POLICY_PHASE_FAIR &&
+             r->policy != SXLATCH_POLICY_BOUNDED ) ? true : false;
+}
+
+/* a hold which the policy keeps out of value(the shards of INFLATED, the
+ * reader slots of ASYMMETRIC, the bias), taken back for a dead session:
+ * false if the session holds the latch on value */
+static bool __sxlatch_recover_aside( sxlatch_t *  r,
+                                     int          mode,
+                                     session_id_t session_id )
+{
+    int32_t hold = 0;
+    int32_t mask = 0;
+
+    switch( r->policy )
+    {
+        case SXLATCH_POLICY_INFLATED:
+            /* the shard holds are kept by session */
+            return ( mode == BF_LATCH_MODE_S ) ?
+                   __sxlatch_inflated_leave( r, session_id ) : false;
+
+        case SXLATCH_POLICY_ASYMMETRIC:
+            return ( mode == BF_LATCH_MODE_S &&
+                     sxlatch_asym_release( r, session_id ) > 0 ) ? true : false;
+
+        case SXLATCH_POLICY_BIASED:
+            hold = ( mode == BF_LATCH_MODE_S ) ? SXLATCH_BIAS_HOLD_S : SXLATCH_BIAS_HOLD_X;
+            mask = ( mode == BF_LATCH_MODE_S ) ? SXLATCH_BIAS_HOLD_S_MASK : SXLATCH_BIAS_HOLD_X_MASK;
+            if( SXLATCH_BIAS_IS_OWNER( r->policy_word, session_id ) &&
+                (r->aux_word & mask) != 0 )
+            {
+                /* the owner is dead: nobody else writes aux_word */
+                __atomic_store_n( &(r->aux_word), r->aux_word - hold, __ATOMIC_RELEASE );
+                return true;
+            }
+            return false;
+
+        default:
+            return false;
+    }
+}
+
+/* the shard holds and reader slots which the hold log does not know
+ * (taken while not tracking): the number released */
+static uint32_t __sxlatch_recover_untracked( session_id_t session_id )
+{
+    sxlatch_session_t * sess = sxlatch_session_find( session_id );
+    sxlatch_session_shard_holds_t * shards = ( sess != NULL ) ? sess->shard_holds : NULL;
+    uint32_t released = 0;
+
+    while( shards != NULL && shards->cnt > 0 )
+    {
+        shards->cnt--;
+        atomic_fetch_dec( shards->holds[shards->cnt].readers );
+        released++;
+    }
+
+    released += (uint32_t)sxlatch_asym_release( NULL, session_id );
+
+    return released;
+}
+
+/* the latch the session was requesting: ambiguous(see the matrix)
+ * The count of a pending S cannot be told from the live readers': new
+ * readers are refused meanwhile, so it is resolved once no S is left,
+ * and RC_FAIL(left as is) while some is. */
+static int __sxlatch_recover_pending( sxlatch_t *  r,
+                                      int          mode,
+                                      session_id_t session_id )
+{
+    int64_t value = SXLATCH_GET_VALUE( r );
+
+    if( __sxlatch_recover_aside( r, mode, session_id ) == true )
+    {
+        return RC_SUCCESS;
+    }
+
+    if( __sxlatch_recoverable( r ) == true )
+    {
+        TRY( mode == BF_LATCH_MODE_S &&
+             SXLATCH_GET_MODE( SXLATCH_GET_VALUE( r ) ) != SXLATCH_MODE_X_ACQUIRED &&
+             SXLATCH_GET_SHARED_CNT( SXLATCH_GET_VALUE( r ) ) > 0 );
+
+        return __sxlatch_unlock_for_recovery( r, mode, session_id );
+    }
+
+    /* other policies: only an X owned by the session is certain */
+    TRY( mode != BF_LATCH_MODE_X_ACQUIRED );
+
+    if( SXLATCH_GET_MODE( value ) == SXLATCH_MODE_X_ACQUIRED &&
+        SXLATCH_GET_SESSION_ID( value ) == session_id )
+    {
+        TRY( __sxlatch_policy_ops[r->policy].unlock( r, session_id ) != RC_SUCCESS );
+        __sxlatch_drain_notify();
+    }
+
+    return RC_SUCCESS;
+
+    CATCH_END;
+
+    return RC_FAIL;
+}
+
+int sxlatch_recover_session( session_id_t             session_id,
+                             uint64_t                 wait_msec,
+                             sxlatch_recover_stat_t * stat )
+{
+    sxlatch_session_holds_t * holds = NULL;
+    sxlatch_t * pending = NULL;
+    sxlatch_t * r = NULL;
+    int pending_mode = 0;
+    int64_t idx = 0;
+    int ret = RC_SUCCESS;
+
+    TRY( session_id < 0 || session_id > SXLATCH_MAX_SESSION_ID || stat == NULL );
+
+    memset( stat, 0x00, sizeof(sxlatch_recover_stat_t) );
+
+    /* without the log, what the session held on value is not known */
+    TRY( __sxlatch_hold_track_enabled == 0 );
+
+    holds = sxlatch_session_get_holds( session_id );
+    if( holds == NULL )
+    {
+        stat->released = __sxlatch_recover_untracked( session_id );
+        return RC_SUCCESS;
+    }
+
+    pending      = (sxlatch_t *)holds->pending;
+    pending_mode = holds->pending_mode;
+
+    /* refuse new requests on the ambiguous latch meanwhile */
+    if( pending != NULL )
+    {
+        (void)sxlatch_set_cleanup_progress( pending, true );
+    }
+
+    /* the async granter may still add a grant */
+    sxlatch_session_holds_lock( holds );
+
+    /* the held latches are certain: release them, newest first */
+    for( idx = (int64_t)holds->cnt - 1; idx >= 0; idx-- )
+    {
+        r = (sxlatch_t *)holds->entries[idx].latch;
+
+        if( __sxlatch_recover_aside( r, holds->entries[idx].mode, session_id ) == true )
+        {
+            ret = RC_SUCCESS;
+        }
+        else if( __sxlatch_recoverable( r ) == true )
+        {
+            ret = __sxlatch_unlock_for_recovery( r, holds->entries[idx].mode, session_id );
+        }
+        else
+        {
+            ret = __sxlatch_policy_ops[r->policy].unlock( r, session_id );
+            __sxlatch_drain_notify();
+        }
+
+        if( ret == RC_SUCCESS )
+        {
+            stat->released++;
+        }
+        else
+        {
+            stat->failed++;
+        }
+    }
+    holds->cnt = 0;
+
+    sxlatch_session_holds_unlock( holds );
+
+    if( pending != NULL )
+    {
+        /* let the live sessions settle the latch */
+        if( wait_msec > 0 )
+        {
+            thread_sleep( wait_msec / 1000, (wait_msec % 1000) * 1000 );
+        }
+
+        if( __sxlatch_recover_pending( pending, pending_mode, session_id ) == RC_SUCCESS )
+        {
+            stat->ambiguous++;
+            holds->pending = NULL;
+        }
+        else
+        {
+            /* kept for another call */
+            stat->failed++;
+        }
+
+        (void)sxlatch_set_cleanup_progress( pending, false );
+    }
+
+    stat->released += __sxlatch_recover_untracked( session_id );
+
+    stat->lost      = holds->overflow;
+    holds->overflow = false;
+
+    TRY( stat->failed > 0 || stat->lost == true );
+
+    return RC_SUCCESS;
+
+    CATCH_END;
+
+    return RC_FAIL;
+}
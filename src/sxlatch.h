@@ -4,6 +4,7 @@
 #include <sys/types.h>
 #include "atomic.h"
 #include "util.h"
+#include "session.h"
 
 /* fast SX latch */
 typedef struct _bit_field_latch bf_latch_t;
@@ -34,11 +35,22 @@ struct _bit_field_latch
 #define bf_latch_set_shared_cnt( i64v, _shared_cnt )   \
   (conv_bf_latch(i64v)->shared_cnt = (_shared_cnt))
 
+/* sxlatch_t is 24 bytes(16 bytes before the reader/writer policies).
+ * policy_word and aux_word keep the policy state next to value, on the
+ * same cache line, so a policy never costs a second miss; embedders
+ * sizing by 16 bytes must use sizeof(sxlatch_t). */
 typedef struct _sharable_sxlatch sxlatch_t;
 struct _sharable_sxlatch
 {
   volatile int64_t  value;
   volatile int32_t  cleanup_in_progress_cnt;
+  uint16_t          latch_class;   /* statistics class(sxlatch_attr_t) */
+  uint8_t           policy;        /* SXLATCH_POLICY_XXX(sxlatch_attr_t) */
+  uint8_t           reserved;
+  volatile int32_t  policy_word;   /* owned by the policy, 0 when unlocked */
+  volatile int32_t  aux_word;      /* BIASED: owner's nested holds,
+                                     DEFAULT: contention score,
+                                     BOUNDED: share limit */
 };
 
   /* latch_value syntax & semantic:
@@ -101,15 +113,100 @@ struct _sharable_sxlatch
 #define SXLATCH_MAKE_LATCH_VALUE( mode, session_id, shared_cnt ) \
             (mode | (((int64_t)session_id) << 32) | (int64_t)(shared_cnt))
 
+/* latch attributes given at sxlatch_init_attr() */
+#define SXLATCH_CLASS_DEFAULT      0
+#define SXLATCH_CLASS_MAX          64
+
+/* reader/writer policy
+ * DEFAULT:    a writer blocks new readers(X_BLOCKED) and waits for the
+ *             readers which are in. Writers may starve readers. Readers
+ *             enter with one fetch-and-add and step back if a writer was
+ *             in, instead of retrying a CAS.
+ *             Under sustained contention the latch inflates(inflate.h):
+ *             readers count themselves in sharded counters instead of
+ *             value, until the contention subsides. Shard holds are
+ *             kept by session; writers wait for the shard readers as
+ *             for the readers in value.
+ *             __sxlatch_inflate_threshold = 0 disables it.
+ * PHASE_FAIR: readers which arrive while a writer is in are admitted
+ *             all together when the writer releases, before the next
+ *             writer: readers and writers alternate phases, and neither
+ *             waits longer than one phase of the other.
+ * READER_PREF: readers get in while a writer waits for the readers to
+ *             drain; the writer gets X once no reader is left.
+ * WRITER_PREF: no new reader while any writer waits; waiting writers
+ *             take X one after another before the readers.
+ * BIASED:     the first session which takes the latch owns the bias: it
+ *             takes and releases S/X with plain stores, without touching
+ *             value. The first other session revokes the bias for good
+ *             (membarrier handshake with the owner) and the latch works
+ *             as DEFAULT from then. Biased holds are not visible in value
+ *             (watchdog, recovery). Needs membarrier(2): DEFAULT without.
+ * ASYMMETRIC: for latches read very often and written rarely. Readers
+ *             store into a slot of their thread only; writers take X,
+ *             run membarrier(2) and wait until no slot holds the latch.
+ *             S must be released by the thread which took it, and a
+ *             thread nests at most SXLATCH_ASYM_SLOT_CNT such reads(more
+ *             fall back to S on value). Needs membarrier(2) as BIASED.
+ * BOUNDED:    as DEFAULT, but at most share_limit readers hold S at once;
+ *             further readers park(futex) until one leaves, and
+ *             sxlatch_tryrdlock() fails at the limit. The limit may be
+ *             changed at any time with sxlatch_set_share_limit(). */
+#define SXLATCH_POLICY_DEFAULT      0
+#define SXLATCH_POLICY_PHASE_FAIR   1
+#define SXLATCH_POLICY_READER_PREF  2
+#define SXLATCH_POLICY_WRITER_PREF  3
+#define SXLATCH_POLICY_BIASED       4
+#define SXLATCH_POLICY_ASYMMETRIC   5
+#define SXLATCH_POLICY_BOUNDED      6
+#define SXLATCH_POLICY_MAX          7
+
+typedef struct _sxlatch_attr sxlatch_attr_t;
+struct _sxlatch_attr
+{
+  int   latch_class;   /* 0 ~ SXLATCH_CLASS_MAX - 1 */
+  int   policy;        /* SXLATCH_POLICY_XXX */
+  int   share_limit;   /* BOUNDED: readers at once, 0: no limit */
+};
+
+int sxlatch_attr_init( sxlatch_attr_t * attr );
+int sxlatch_attr_setclass( sxlatch_attr_t * attr, int latch_class );
+int sxlatch_attr_setpolicy( sxlatch_attr_t * attr, int policy );
+int sxlatch_attr_setsharelimit( sxlatch_attr_t * attr, int share_limit );
+
 bool sxlatch_is_unlock( sxlatch_t * r );
 int sxlatch_init( sxlatch_t * r );
+int sxlatch_init_attr( sxlatch_t * r, const sxlatch_attr_t * attr );
+/* CAS retry backoff: a failed CAS on value spins a random number of
+ * PAUSEs below a window which doubles per failure, from
+ * SXLATCH_CAS_BACKOFF_MIN up to __sxlatch_cas_backoff_max(0: retry at
+ * once). __sxlatch_cas_fail_cnt counts the failed CASes of the thread. */
+#define SXLATCH_CAS_BACKOFF_MIN        4
+#define SXLATCH_CAS_BACKOFF_MAX        1024
+extern int __sxlatch_cas_backoff_max;
+extern __thread uint64_t __sxlatch_cas_fail_cnt;
+
+/* destroy waits while the latch is held and cleaned up(a dead session),
+ * woken up by the recovery, at most timeout_msec(sxlatch_destroy():
+ * SXLATCH_DESTROY_TIMEOUT_MSEC). RC_ERR_LOCK_TIMEOUT if it did not drain:
+ * the latch is left as it is. destroy_bulk destroys cnt latches stride
+ * bytes apart under one deadline, the drained ones even on a timeout. */
+#define SXLATCH_DESTROY_TIMEOUT_MSEC   1000
 int sxlatch_destroy( sxlatch_t * r );
+int sxlatch_destroy_timed( sxlatch_t * r, uint64_t timeout_msec );
+int sxlatch_destroy_bulk( sxlatch_t * first,
+                          size_t      cnt,
+                          size_t      stride,
+                          uint64_t    timeout_msec );
+
+/* BOUNDED: readers admitted at once from now on(0: no limit). Readers in
+ * beyond a lowered limit stay until they release. */
+int sxlatch_set_share_limit( sxlatch_t * r, int share_limit );
 
 // use this lock when no need to use session (mdb_backup or recovery processing)
 int sxlatch_Xlock_no_session( sxlatch_t * r );
 int sxlatch_unlock_no_session( sxlatch_t * r );
 
-typedef int32_t session_id_t;
 #define SXLATCH_MAX_SESSION_ID     ((session_id_t)0x0FFFFFFF)
 
 int sxlatch_Xlock( sxlatch_t * r, session_id_t session_id );
@@ -119,8 +216,52 @@ int sxlatch_wrlock( sxlatch_t * r, session_id_t session_id );
 int sxlatch_tryrdlock( sxlatch_t * r, session_id_t session_id );
 int sxlatch_trywrlock( sxlatch_t * r, session_id_t session_id );
 int sxlatch_trysxlock( sxlatch_t * r, session_id_t session_id );
+/* a writer which does not wait(async.h): takes X, or marks X_BLOCKED for
+ * the session as sxlatch_wrlock() does, so no new reader is admitted, and
+ * returns RC_ERR_LOCK_BUSY; called again, it takes X once the readers
+ * have left. sxlatch_trywrlock_unmark() gives the mark back(RC_FAIL if
+ * the session has no mark). RC_FAIL on BIASED and ASYMMETRIC. */
+int sxlatch_trywrlock_mark( sxlatch_t * r, session_id_t session_id );
+int sxlatch_trywrlock_unmark( sxlatch_t * r, session_id_t session_id );
 int sxlatch_intrdlock( sxlatch_t * r, session_id_t session_id );
 int sxlatch_intwrlock( sxlatch_t * r, session_id_t session_id );
 int sxlatch_unlock( sxlatch_t * r, session_id_t session_id );
+/* release S / X without looking at the mode: the caller must hold it.
+ * One atomic instruction on DEFAULT, READER_PREF and WRITER_PREF. */
+int sxlatch_rdunlock( sxlatch_t * r, session_id_t session_id );
+int sxlatch_wrunlock( sxlatch_t * r, session_id_t session_id );
+
+/* interrupt a session: the session waiting in sxlatch_int*lock() gives up
+ * with RC_ERR_LOCK_INTERRUPTED. The interrupt stays until it is cleared. */
+int sxlatch_interrupt_session( session_id_t session_id );
+int sxlatch_clear_session_interrupt( session_id_t session_id );
+
+/* bulk recovery of a dead session
+ * Releases every latch the session holds by its hold log(hold tracking,
+ * sxlatch_session_track_holds()). Held latches are definite and released
+ * at once: the holds a policy keeps out of value(shards of INFLATED,
+ * reader slots of ASYMMETRIC, the bias) are cleared for the session, the
+ * others go through the matrix(PHASE_FAIR, BOUNDED: their own unlock).
+ * Shard holds and reader slots are cleared even when not in the log;
+ * bias holds are not. The latch being requested when the session died is
+ * ambiguous: it is set in cleanup progress, left wait_msec to the live
+ * sessions, then resolved by the matrix. A pending S is resolved only if
+ * no S is left by then(the count of a live reader is never taken):
+ * otherwise it stays pending for a later call. RC_FAIL if a latch could
+ * not be resolved or the log lost entries, and at once(nothing released)
+ * if hold tracking is off: it must be on before the sessions take any
+ * latch. The session must never run again. */
+typedef struct _sxlatch_recover_stat sxlatch_recover_stat_t;
+struct _sxlatch_recover_stat
+{
+  uint32_t  released;    /* held latches released */
+  uint32_t  ambiguous;   /* the pending latch, resolved by the matrix */
+  uint32_t  failed;      /* could not be resolved */
+  bool      lost;        /* the log is incomplete(out of memory) */
+};
+
+int sxlatch_recover_session( session_id_t             session_id,
+                             uint64_t                 wait_msec,
+                             sxlatch_recover_stat_t * stat );
 
 #endif /* _SXLATCH_H_ */
@@ -0,0 +1,23 @@
+#include <stdio.h>
+
+#include "trace.h"
+#include "util.h"
+
+/* sxtrace: convert a latch trace dump into Chrome/Perfetto trace json
+ * usage: sxtrace <dump file> <json file> */
+int main( int argc, char * argv[] )
+{
+    if( argc != 3 )
+    {
+        fprintf( stderr, "usage: %s <dump file> <json file>\n", argv[0] );
+        return 1;
+    }
+
+    if( sxlatch_trace_to_chrome( argv[1], argv[2] ) != RC_SUCCESS )
+    {
+        fprintf( stderr, "%s: cannot convert %s\n", argv[0], argv[1] );
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,333 @@
+#include <stdlib.h>
+#include <memory.h>
+
+#include "table.h"
+#include "atomic.h"
+#include "util.h"
+
+#define SXLATCH_TABLE_HOT_MASK       (SXLATCH_TABLE_HOT_MAX - 1)
+
+static inline uint64_t __sxlatch_table_hash( uint64_t key )
+{
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    key *= 0xc4ceb9fe1a85ec53ULL;
+    key ^= key >> 33;
+    return key;
+}
+
+static inline sxlatch_table_stripe_t * __sxlatch_table_stripe( sxlatch_table_t * table,
+                                                              uint64_t          hash )
+{
+    return &(table->stripes[hash & table->stripe_mask]);
+}
+
+/* the latch split out for the key, NULL if the key is on its stripe */
+static sxlatch_table_hot_t * __sxlatch_table_find_hot( sxlatch_table_t * table,
+                                                       uint64_t          key,
+                                                       uint64_t          hash )
+{
+    sxlatch_table_hot_t * hot = NULL;
+    uint32_t idx = (uint32_t)(hash >> 32);
+    int probe = 0;
+
+    for( probe = 0; probe < SXLATCH_TABLE_HOT_MAX; probe++, idx++ )
+    {
+        hot = &(table->hot[idx & SXLATCH_TABLE_HOT_MASK]);
+
+        if( hot->state == SXLATCH_TABLE_HOT_FREE )
+        {
+            break;
+        }
+
+        if( hot->state == SXLATCH_TABLE_HOT_READY && hot->key == key )
+        {
+            return hot;
+        }
+    }
+
+    return NULL;
+}
+
+/* X on the stripe is held by the caller */
+static void __sxlatch_table_split( sxlatch_table_t *        table,
+                                   sxlatch_table_stripe_t * stripe )
+{
+    sxlatch_table_hot_t * hot = NULL;
+    uint64_t key  = stripe->cand_key;
+    uint64_t hash = __sxlatch_table_hash( key );
+    uint32_t idx  = (uint32_t)(hash >> 32);
+    int probe = 0;
+
+    stripe->cand_hits = 0;
+
+    if( __sxlatch_table_stripe( table, hash ) != stripe ||
+        __sxlatch_table_find_hot( table, key, hash ) != NULL )
+    {
+        return;
+    }
+
+    for( probe = 0; probe < SXLATCH_TABLE_HOT_MAX; probe++, idx++ )
+    {
+        hot = &(table->hot[idx & SXLATCH_TABLE_HOT_MASK]);
+
+        if( hot->state == SXLATCH_TABLE_HOT_FREE &&
+            atomic_cas_32( &(hot->state),
+                           SXLATCH_TABLE_HOT_FREE,
+                           SXLATCH_TABLE_HOT_CLAIMED ) == SXLATCH_TABLE_HOT_FREE )
+        {
+            (void)sxlatch_init_attr( &(hot->latch), &(table->attr) );
+            hot->key = key;
+            mem_barrier();
+            hot->state = SXLATCH_TABLE_HOT_READY;
+
+            atomic_inc_fetch( &(stripe->hot_cnt) );
+            atomic_inc_fetch( &(table->splits) );
+            return;
+        }
+    }
+
+    /* no room left: the key stays on its stripe */
+}
+
+static inline void __sxlatch_table_on_contention( sxlatch_table_stripe_t * stripe,
+                                                  uint64_t                 key )
+{
+    /* plain updates: the most contended key wins the candidate */
+    stripe->contentions++;
+
+    if( stripe->cand_key == key )
+    {
+        stripe->cand_hits++;
+    }
+    else if( stripe->cand_hits > 0 )
+    {
+        stripe->cand_hits--;
+    }
+    else
+    {
+        stripe->cand_key  = key;
+        stripe->cand_hits = 1;
+    }
+}
+
+/* lock the latch of the key; try: sxlatch_try*lock() only */
+static int __sxlatch_table_lock( sxlatch_table_t * table,
+                                 uint64_t          key,
+                                 session_id_t      session_id,
+                                 int               mode,
+                                 bool              try_only )
+{
+    sxlatch_table_stripe_t * stripe = NULL;
+    sxlatch_table_hot_t * hot = NULL;
+    sxlatch_t * latch = NULL;
+    uint64_t hash = 0;
+    int ret = RC_FAIL;
+
+    TRY( table == NULL );
+
+    hash   = __sxlatch_table_hash( key );
+    stripe = __sxlatch_table_stripe( table, hash );
+
+    while( true )
+    {
+        hot = ( stripe->hot_cnt > 0 ) ?
+              __sxlatch_table_find_hot( table, key, hash ) : NULL;
+        latch = ( hot != NULL ) ? &(hot->latch) : &(stripe->latch);
+
+        ret = ( mode == BF_LATCH_MODE_S ) ?
+              sxlatch_tryrdlock( latch, session_id ) :
+              sxlatch_trywrlock( latch, session_id );
+
+        if( ret != RC_SUCCESS && ret != RC_ERR_LOCK_TIMEOUT )
+        {
+            if( hot == NULL )
+            {
+                __sxlatch_table_on_contention( stripe, key );
+            }
+
+            if( try_only == true )
+            {
+                break;
+            }
+
+            ret = ( mode == BF_LATCH_MODE_S ) ?
+                  sxlatch_rdlock( latch, session_id ) :
+                  sxlatch_wrlock( latch, session_id );
+        }
+
+        if( ret != RC_SUCCESS || hot != NULL )
+        {
+            break;
+        }
+
+        /* the key may have been split out while we waited for the stripe */
+        if( stripe->hot_cnt > 0 &&
+            __sxlatch_table_find_hot( table, key, hash ) != NULL )
+        {
+            sxlatch_unlock( latch, session_id );
+            continue;
+        }
+
+        break;
+    }
+
+    return ret;
+
+    CATCH_END;
+
+    return RC_FAIL;
+}
+
+int sxlatch_table_init( sxlatch_table_t *      table,
+                        uint32_t               stripe_cnt,
+                        uint32_t               split_threshold,
+                        const sxlatch_attr_t * attr )
+{
+    uint32_t cnt = 1;
+    uint32_t idx = 0;
+
+    TRY( table == NULL || stripe_cnt == 0 || stripe_cnt > 0x80000000U );
+
+    while( cnt < stripe_cnt )
+    {
+        cnt <<= 1;
+    }
+
+    memset( table, 0x00, sizeof(sxlatch_table_t) );
+
+    if( attr != NULL )
+    {
+        table->attr = *attr;
+    }
+    else
+    {
+        (void)sxlatch_attr_init( &(table->attr) );
+    }
+
+    TRY( posix_memalign( (void **)&(table->stripes), 64,
+                         sizeof(sxlatch_table_stripe_t) * cnt ) != 0 );
+    memset( table->stripes, 0x00, sizeof(sxlatch_table_stripe_t) * cnt );
+
+    for( idx = 0; idx < cnt; idx++ )
+    {
+        TRY_GOTO( sxlatch_init_attr( &(table->stripes[idx].latch),
+                                     &(table->attr) ) != RC_SUCCESS,
+                  err_free );
+    }
+
+    table->stripe_mask     = cnt - 1;
+    table->split_threshold = split_threshold;
+
+    return RC_SUCCESS;
+
+    CATCH( err_free )
+    {
+        free( table->stripes );
+        table->stripes = NULL;
+    }
+    CATCH_END;
+
+    return RC_FAIL;
+}
+
+int sxlatch_table_destroy( sxlatch_table_t * table )
+{
+    uint32_t idx = 0;
+
+    TRY( table == NULL || table->stripes == NULL );
+
+    (void)sxlatch_destroy_bulk( &(table->stripes[0].latch), table->stripe_mask + 1,
+                                sizeof(sxlatch_table_stripe_t),
+                                SXLATCH_DESTROY_TIMEOUT_MSEC );
+
+    for( idx = 0; idx < SXLATCH_TABLE_HOT_MAX; idx++ )
+    {
+        if( table->hot[idx].state == SXLATCH_TABLE_HOT_READY )
+        {
+            sxlatch_destroy( &(table->hot[idx].latch) );
+        }
+    }
+
+    free( table->stripes );
+    memset( table, 0x00, sizeof(sxlatch_table_t) );
+
+    return RC_SUCCESS;
+
+    CATCH_END;
+
+    return RC_FAIL;
+}
+
+int sxlatch_table_rdlock( sxlatch_table_t * table, uint64_t key, session_id_t session_id )
+{
+    return __sxlatch_table_lock( table, key, session_id, BF_LATCH_MODE_S, false );
+}
+
+int sxlatch_table_wrlock( sxlatch_table_t * table, uint64_t key, session_id_t session_id )
+{
+    return __sxlatch_table_lock( table, key, session_id, BF_LATCH_MODE_X_ACQUIRED, false );
+}
+
+int sxlatch_table_tryrdlock( sxlatch_table_t * table, uint64_t key, session_id_t session_id )
+{
+    return __sxlatch_table_lock( table, key, session_id, BF_LATCH_MODE_S, true );
+}
+
+int sxlatch_table_trywrlock( sxlatch_table_t * table, uint64_t key, session_id_t session_id )
+{
+    return __sxlatch_table_lock( table, key, session_id, BF_LATCH_MODE_X_ACQUIRED, true );
+}
+
+int sxlatch_table_unlock( sxlatch_table_t * table, uint64_t key, session_id_t session_id )
+{
+    sxlatch_table_stripe_t * stripe = NULL;
+    sxlatch_table_hot_t * hot = NULL;
+    uint64_t hash = 0;
+    int64_t value = 0;
+
+    TRY( table == NULL );
+
+    hash   = __sxlatch_table_hash( key );
+    stripe = __sxlatch_table_stripe( table, hash );
+
+    if( stripe->hot_cnt > 0 )
+    {
+        hot = __sxlatch_table_find_hot( table, key, hash );
+        if( hot != NULL )
+        {
+            return sxlatch_unlock( &(hot->latch), session_id );
+        }
+    }
+
+    value = SXLATCH_GET_VALUE( &(stripe->latch) );
+    if( table->split_threshold > 0 &&
+        stripe->cand_hits >= (int32_t)table->split_threshold &&
+        SXLATCH_GET_MODE( value ) == SXLATCH_MODE_X_ACQUIRED &&
+        SXLATCH_GET_SESSION_ID( value ) == session_id )
+    {
+        /* we are alone in the stripe */
+        __sxlatch_table_split( table, stripe );
+    }
+
+    return sxlatch_unlock( &(stripe->latch), session_id );
+
+    CATCH_END;
+
+    return RC_FAIL;
+}
+
+void sxlatch_table_get_stat( const sxlatch_table_t * table, sxlatch_table_stat_t * stat )
+{
+    uint32_t idx = 0;
+
+    memset( stat, 0x00, sizeof(sxlatch_table_stat_t) );
+
+    for( idx = 0; idx <= table->stripe_mask; idx++ )
+    {
+        stat->contentions += table->stripes[idx].contentions;
+        stat->hot_cnt     += table->stripes[idx].hot_cnt;
+    }
+    stat->splits = table->splits;
+}
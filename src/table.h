@@ -0,0 +1,79 @@
+#ifndef _TABLE_H_
+#define _TABLE_H_ 1
+
+#include <stdint.h>
+#include "util.h"
+#include "sxlatch.h"
+
+/* striped latch table(lock manager back end)
+ * Maps 64-bit keys onto stripe_cnt cache-aligned latches. Keys which
+ * collide on a stripe share its latch. Each stripe tracks the key it saw
+ * contended most recently; when that key reaches split_threshold
+ * contentions, it is split out onto a latch of its own(at most
+ * SXLATCH_TABLE_HOT_MAX keys per table, for the life of the table).
+ *
+ * A split is done by a session releasing X on the stripe: nobody else
+ * holds a key of the stripe then, and an acquirer looks for the split
+ * keys again once it holds the stripe. A key maps to one latch between
+ * its lock and its unlock. */
+
+#define SXLATCH_TABLE_HOT_MAX        64
+
+typedef struct _sxlatch_table_stripe sxlatch_table_stripe_t;
+struct _sxlatch_table_stripe
+{
+    sxlatch_t          latch;
+    volatile int32_t   hot_cnt;       /* keys split out of the stripe */
+    volatile int32_t   cand_hits;
+    volatile uint64_t  cand_key;      /* most recently contended key */
+    volatile uint64_t  contentions;
+} __attribute__((aligned(64)));
+
+#define SXLATCH_TABLE_HOT_FREE       0
+#define SXLATCH_TABLE_HOT_CLAIMED    1
+#define SXLATCH_TABLE_HOT_READY      2
+
+typedef struct _sxlatch_table_hot sxlatch_table_hot_t;
+struct _sxlatch_table_hot
+{
+    sxlatch_t          latch;
+    volatile uint64_t  key;
+    volatile int32_t   state;         /* SXLATCH_TABLE_HOT_XXX */
+} __attribute__((aligned(64)));
+
+typedef struct _sxlatch_table sxlatch_table_t;
+struct _sxlatch_table
+{
+    uint32_t                  stripe_mask;
+    uint32_t                  split_threshold;   /* 0: never split */
+    sxlatch_attr_t            attr;
+    sxlatch_table_stripe_t *  stripes;
+    volatile uint64_t         splits;
+    sxlatch_table_hot_t       hot[SXLATCH_TABLE_HOT_MAX];
+};
+
+/* stripe_cnt is rounded up to a power of two; attr: NULL for defaults */
+int sxlatch_table_init( sxlatch_table_t *      table,
+                        uint32_t               stripe_cnt,
+                        uint32_t               split_threshold,
+                        const sxlatch_attr_t * attr );
+int sxlatch_table_destroy( sxlatch_table_t * table );
+
+int sxlatch_table_rdlock( sxlatch_table_t * table, uint64_t key, session_id_t session_id );
+int sxlatch_table_wrlock( sxlatch_table_t * table, uint64_t key, session_id_t session_id );
+int sxlatch_table_tryrdlock( sxlatch_table_t * table, uint64_t key, session_id_t session_id );
+int sxlatch_table_trywrlock( sxlatch_table_t * table, uint64_t key, session_id_t session_id );
+int sxlatch_table_unlock( sxlatch_table_t * table, uint64_t key, session_id_t session_id );
+
+/* statistics */
+typedef struct _sxlatch_table_stat sxlatch_table_stat_t;
+struct _sxlatch_table_stat
+{
+    uint64_t  contentions;    /* acquisitions which had to wait */
+    uint64_t  splits;
+    int32_t   hot_cnt;
+};
+
+void sxlatch_table_get_stat( const sxlatch_table_t * table, sxlatch_table_stat_t * stat );
+
+#endif /* _TABLE_H_ */
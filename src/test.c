@@ -0,0 +1,585 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "sxlatch.h"
+#include "session.h"
+#include "inflate.h"
+#include "atomic.h"
+#include "rand_r.h"
+#include "util.h"
+
+/* test: multi-threaded checks of the latch invariants
+ * usage: test [name]
+ *
+ * xadd:       optimistic S entry of DEFAULT and its step back for a writer:
+ *             no count is left behind(interrupted or not), and S/X
+ *             exclude each other under load, also for the other rw policies.
+ * drain:      a writer of an inflated latch waits for the shard readers,
+ *             however long they hold S; an interrupted int*lock gives up
+ *             and leaves no X behind.
+ * phase-fair: the readers waiting for a writer are in before the next
+ *             writer, and S/X exclude each other under load.
+ * recovery:   the holds of a dead session are released and its waiters
+ *             unblocked; a pending S never takes a live reader's count;
+ *             no recovery without hold tracking.
+ * Prints one line per test, exits 1 if any failed. */
+
+#define TEST_THREADS          8
+#define TEST_STRESS_MSEC      300
+#define TEST_HOLD_MSEC        200     /* S held while a writer waits */
+#define TEST_SETTLE_MSEC      50      /* until a thread blocks */
+#define TEST_WAIT_MSEC        5000    /* give up on a condition */
+
+typedef struct _test_shared test_shared_t;
+struct _test_shared
+{
+    sxlatch_t          latch;
+    volatile int32_t   stop;
+    volatile int32_t   readers;     /* in S */
+    volatile int32_t   writers;     /* in X */
+    volatile int32_t   violations;
+    volatile int32_t   ticket;      /* order of the acquisitions */
+};
+
+typedef struct _test_thread test_thread_t;
+struct _test_thread
+{
+    pthread_t          thread;
+    test_shared_t *    shared;
+    session_id_t       session_id;
+    int                ret;
+    int32_t            ticket;
+    uint64_t           waited;      /* msec */
+} __attribute__((aligned(64)));
+
+static int __test_failed_line = 0;
+
+#define TEST_CHECK( cond )                                     \
+  if( !(cond) ) { __test_failed_line = __LINE__; goto _label_catch_end; }
+
+/* true once cond holds, false after TEST_WAIT_MSEC */
+#define TEST_WAIT_FOR( cond, ok )                              \
+  do {                                                         \
+    int _msec = 0;                                             \
+    while( !(cond) && _msec++ < TEST_WAIT_MSEC )               \
+    {                                                          \
+      thread_sleep( 0, 1000 );                                 \
+    }                                                          \
+    (ok) = (cond) ? true : false;                              \
+  } while( 0 )
+
+static void __test_sleep_msec( int msec )
+{
+    thread_sleep( msec / 1000, (uint64_t)(msec % 1000) * 1000 );
+}
+
+/* rw load: S and X(30%) with every entry and release function */
+static void * __test_rw_main( void * arg )
+{
+    test_thread_t * thr    = (test_thread_t *)arg;
+    test_shared_t * shared = thr->shared;
+    sxlatch_t *     r      = &(shared->latch);
+    session_id_t    sid    = thr->session_id;
+    RNG rng;
+    int ret = 0;
+    int op  = 0;
+
+    RNG_init( &rng, (uint32_t)sid * 7919, 0, 100 );
+
+    while( shared->stop == 0 )
+    {
+        op = (int)RNG_generate( &rng );
+
+        if( op < 30 )
+        {
+            ret = ( op < 15 ) ? sxlatch_wrlock( r, sid ) : sxlatch_intwrlock( r, sid );
+            if( ret != RC_SUCCESS )
+            {
+                continue;
+            }
+            if( atomic_inc_fetch( &(shared->writers) ) != 1 || shared->readers != 0 )
+            {
+                atomic_inc_fetch( &(shared->violations) );
+            }
+            atomic_dec_fetch( &(shared->writers) );
+            if( op % 2 == 0 )
+            {
+                (void)sxlatch_unlock( r, sid );
+            }
+            else
+            {
+                (void)sxlatch_wrunlock( r, sid );
+            }
+        }
+        else
+        {
+            ret = ( op < 50 ) ? sxlatch_tryrdlock( r, sid ) :
+                  ( op < 75 ) ? sxlatch_intrdlock( r, sid ) :
+                                sxlatch_rdlock( r, sid );
+            if( ret != RC_SUCCESS )
+            {
+                continue;
+            }
+            atomic_inc_fetch( &(shared->readers) );
+            if( shared->writers != 0 )
+            {
+                atomic_inc_fetch( &(shared->violations) );
+            }
+            atomic_dec_fetch( &(shared->readers) );
+            if( op % 2 == 0 )
+            {
+                (void)sxlatch_unlock( r, sid );
+            }
+            else
+            {
+                (void)sxlatch_rdunlock( r, sid );
+            }
+        }
+    }
+
+    return NULL;
+}
+
+/* TEST_THREADS rw threads on shared for TEST_STRESS_MSEC: the violations */
+static int __test_rw_stress( test_shared_t * shared )
+{
+    test_thread_t threads[TEST_THREADS];
+    int idx = 0;
+
+    memset( threads, 0x00, sizeof(threads) );
+    shared->stop       = 0;
+    shared->violations = 0;
+
+    for( idx = 0; idx < TEST_THREADS; idx++ )
+    {
+        threads[idx].shared     = shared;
+        threads[idx].session_id = idx + 1;
+        TRY( pthread_create( &(threads[idx].thread), NULL,
+                             __test_rw_main, &(threads[idx]) ) != 0 );
+    }
+
+    __test_sleep_msec( TEST_STRESS_MSEC );
+    shared->stop = 1;
+
+    for( idx = 0; idx < TEST_THREADS; idx++ )
+    {
+        pthread_join( threads[idx].thread, NULL );
+    }
+
+    return shared->violations;
+
+    CATCH_END;
+
+    shared->stop = 1;
+    while( --idx >= 0 )
+    {
+        pthread_join( threads[idx].thread, NULL );
+    }
+
+    return -1;
+}
+
+static void * __test_intrdlock_main( void * arg )
+{
+    test_thread_t * thr = (test_thread_t *)arg;
+
+    thr->ret = sxlatch_intrdlock( &(thr->shared->latch), thr->session_id );
+
+    return NULL;
+}
+
+static void * __test_rdlock_main( void * arg )
+{
+    test_thread_t * thr = (test_thread_t *)arg;
+
+    thr->ret = sxlatch_rdlock( &(thr->shared->latch), thr->session_id );
+    thr->ticket = atomic_fetch_inc( &(thr->shared->ticket) );
+    (void)sxlatch_unlock( &(thr->shared->latch), thr->session_id );
+
+    return NULL;
+}
+
+static void * __test_wrlock_main( void * arg )
+{
+    test_thread_t * thr = (test_thread_t *)arg;
+    uint64_t begin = get_time_nsec();
+
+    thr->ret = sxlatch_wrlock( &(thr->shared->latch), thr->session_id );
+    thr->waited = ( get_time_nsec() - begin ) / 1000000;
+    thr->ticket = atomic_fetch_inc( &(thr->shared->ticket) );
+    (void)sxlatch_unlock( &(thr->shared->latch), thr->session_id );
+
+    return NULL;
+}
+
+static void * __test_intwrlock_main( void * arg )
+{
+    test_thread_t * thr = (test_thread_t *)arg;
+
+    thr->ret = sxlatch_intwrlock( &(thr->shared->latch), thr->session_id );
+
+    return NULL;
+}
+
+/* S held for TEST_HOLD_MSEC */
+static void * __test_hold_s_main( void * arg )
+{
+    test_thread_t * thr = (test_thread_t *)arg;
+
+    thr->ret = sxlatch_rdlock( &(thr->shared->latch), thr->session_id );
+    atomic_inc_fetch( &(thr->shared->readers) );
+    __test_sleep_msec( TEST_HOLD_MSEC );
+    atomic_dec_fetch( &(thr->shared->readers) );
+    (void)sxlatch_unlock( &(thr->shared->latch), thr->session_id );
+
+    return NULL;
+}
+
+static int __test_xadd( void )
+{
+    test_shared_t shared;
+    test_thread_t thr;
+    sxlatch_attr_t attr;
+    int policies[] = { SXLATCH_POLICY_DEFAULT,
+                       SXLATCH_POLICY_READER_PREF,
+                       SXLATCH_POLICY_WRITER_PREF,
+                       SXLATCH_POLICY_BOUNDED };
+    int threshold = __sxlatch_inflate_threshold;
+    int64_t xvalue = 0;
+    int idx = 0;
+
+    /* exact counts: the latch must stay DEFAULT */
+    __sxlatch_inflate_threshold = 0;
+
+    memset( &shared, 0x00, sizeof(shared) );
+    memset( &thr, 0x00, sizeof(thr) );
+    TEST_CHECK( sxlatch_init( &(shared.latch) ) == RC_SUCCESS );
+
+    /* a reader steps back for X and waits: interrupted, it leaves no count */
+    TEST_CHECK( sxlatch_wrlock( &(shared.latch), 1 ) == RC_SUCCESS );
+    xvalue = SXLATCH_GET_VALUE( &(shared.latch) );
+
+    TEST_CHECK( sxlatch_tryrdlock( &(shared.latch), 2 ) != RC_SUCCESS );
+    TEST_CHECK( SXLATCH_GET_VALUE( &(shared.latch) ) == xvalue );
+
+    thr.shared     = &shared;
+    thr.session_id = 2;
+    TEST_CHECK( pthread_create( &(thr.thread), NULL, __test_intrdlock_main, &thr ) == 0 );
+    __test_sleep_msec( TEST_SETTLE_MSEC );
+    (void)sxlatch_interrupt_session( 2 );
+    pthread_join( thr.thread, NULL );
+    (void)sxlatch_clear_session_interrupt( 2 );
+
+    TEST_CHECK( thr.ret == RC_ERR_LOCK_INTERRUPTED );
+    TEST_CHECK( SXLATCH_GET_VALUE( &(shared.latch) ) == xvalue );
+
+    /* not interrupted, it gets in once X is gone */
+    TEST_CHECK( pthread_create( &(thr.thread), NULL, __test_rdlock_main, &thr ) == 0 );
+    __test_sleep_msec( TEST_SETTLE_MSEC );
+    TEST_CHECK( sxlatch_wrunlock( &(shared.latch), 1 ) == RC_SUCCESS );
+    pthread_join( thr.thread, NULL );
+
+    TEST_CHECK( thr.ret == RC_SUCCESS );
+    TEST_CHECK( sxlatch_is_unlock( &(shared.latch) ) == true );
+    TEST_CHECK( sxlatch_destroy( &(shared.latch) ) == RC_SUCCESS );
+
+    /* under load, with inflation back on for DEFAULT */
+    __sxlatch_inflate_threshold = threshold;
+
+    for( idx = 0; idx < (int)(sizeof(policies) / sizeof(policies[0])); idx++ )
+    {
+        sxlatch_attr_init( &attr );
+        TEST_CHECK( sxlatch_attr_setpolicy( &attr, policies[idx] ) == RC_SUCCESS );
+        if( policies[idx] == SXLATCH_POLICY_BOUNDED )
+        {
+            TEST_CHECK( sxlatch_attr_setsharelimit( &attr, 3 ) == RC_SUCCESS );
+        }
+        TEST_CHECK( sxlatch_init_attr( &(shared.latch), &attr ) == RC_SUCCESS );
+
+        TEST_CHECK( __test_rw_stress( &shared ) == 0 );
+        TEST_CHECK( sxlatch_is_unlock( &(shared.latch) ) == true );
+        TEST_CHECK( sxlatch_destroy( &(shared.latch) ) == RC_SUCCESS );
+    }
+
+    return RC_SUCCESS;
+
+    CATCH_END;
+
+    __sxlatch_inflate_threshold = threshold;
+
+    return RC_FAIL;
+}
+
+/* inflate a DEFAULT latch as its contention score would */
+static int __test_inflate( sxlatch_t * r )
+{
+    int32_t idx = sxlatch_inflated_alloc( r );
+
+    TRY( idx == 0 );
+
+    r->policy_word = idx;
+    mem_barrier();
+    r->policy = SXLATCH_POLICY_INFLATED;
+    mem_barrier();
+    sxlatch_inflate_count( true );
+
+    return RC_SUCCESS;
+
+    CATCH_END;
+
+    return RC_FAIL;
+}
+
+static int __test_drain( void )
+{
+    test_shared_t shared;
+    test_thread_t reader;
+    test_thread_t writer;
+    bool ok = false;
+
+    memset( &shared, 0x00, sizeof(shared) );
+    memset( &reader, 0x00, sizeof(reader) );
+    memset( &writer, 0x00, sizeof(writer) );
+    TEST_CHECK( sxlatch_init( &(shared.latch) ) == RC_SUCCESS );
+
+    /* a blocking writer waits for a shard reader however long it holds S */
+    TEST_CHECK( __test_inflate( &(shared.latch) ) == RC_SUCCESS );
+
+    reader.shared     = &shared;
+    reader.session_id = 1;
+    TEST_CHECK( pthread_create( &(reader.thread), NULL, __test_hold_s_main, &reader ) == 0 );
+    TEST_WAIT_FOR( shared.readers == 1, ok );
+    TEST_CHECK( ok == true );
+
+    writer.shared     = &shared;
+    writer.session_id = 2;
+    TEST_CHECK( pthread_create( &(writer.thread), NULL, __test_wrlock_main, &writer ) == 0 );
+    pthread_join( writer.thread, NULL );
+    pthread_join( reader.thread, NULL );
+
+    TEST_CHECK( reader.ret == RC_SUCCESS );
+    TEST_CHECK( writer.ret == RC_SUCCESS );
+    TEST_CHECK( writer.waited >= TEST_HOLD_MSEC / 2 );
+    TEST_CHECK( sxlatch_is_unlock( &(shared.latch) ) == true );
+
+    /* an interrupted writer gives up the drain and its X */
+    if( shared.latch.policy != SXLATCH_POLICY_INFLATED )
+    {
+        /* the writer deflated it */
+        TEST_CHECK( __test_inflate( &(shared.latch) ) == RC_SUCCESS );
+    }
+
+    TEST_CHECK( pthread_create( &(reader.thread), NULL, __test_hold_s_main, &reader ) == 0 );
+    TEST_WAIT_FOR( shared.readers == 1, ok );
+    TEST_CHECK( ok == true );
+
+    TEST_CHECK( pthread_create( &(writer.thread), NULL, __test_intwrlock_main, &writer ) == 0 );
+    __test_sleep_msec( TEST_SETTLE_MSEC );
+    (void)sxlatch_interrupt_session( 2 );
+    pthread_join( writer.thread, NULL );
+    (void)sxlatch_clear_session_interrupt( 2 );
+
+    TEST_CHECK( writer.ret == RC_ERR_LOCK_INTERRUPTED );
+    TEST_CHECK( shared.readers == 1 );
+    TEST_CHECK( SXLATCH_GET_MODE( SXLATCH_GET_VALUE( &(shared.latch) ) ) == SXLATCH_MODE_S );
+
+    pthread_join( reader.thread, NULL );
+    TEST_CHECK( sxlatch_trywrlock( &(shared.latch), 2 ) == RC_SUCCESS );
+    TEST_CHECK( sxlatch_unlock( &(shared.latch), 2 ) == RC_SUCCESS );
+    TEST_CHECK( sxlatch_is_unlock( &(shared.latch) ) == true );
+    TEST_CHECK( sxlatch_destroy( &(shared.latch) ) == RC_SUCCESS );
+
+    return RC_SUCCESS;
+
+    CATCH_END;
+
+    return RC_FAIL;
+}
+
+#define TEST_PF_READERS       3
+
+static int __test_phase_fair( void )
+{
+    test_shared_t shared;
+    test_thread_t readers[TEST_PF_READERS];
+    test_thread_t writer;
+    sxlatch_attr_t attr;
+    bool ok = false;
+    int idx = 0;
+
+    memset( &shared, 0x00, sizeof(shared) );
+    memset( readers, 0x00, sizeof(readers) );
+    memset( &writer, 0x00, sizeof(writer) );
+
+    sxlatch_attr_init( &attr );
+    TEST_CHECK( sxlatch_attr_setpolicy( &attr, SXLATCH_POLICY_PHASE_FAIR ) == RC_SUCCESS );
+    TEST_CHECK( sxlatch_init_attr( &(shared.latch), &attr ) == RC_SUCCESS );
+
+    /* readers arrive while a writer is in, then another writer */
+    TEST_CHECK( sxlatch_wrlock( &(shared.latch), 1 ) == RC_SUCCESS );
+
+    for( idx = 0; idx < TEST_PF_READERS; idx++ )
+    {
+        readers[idx].shared     = &shared;
+        readers[idx].session_id = idx + 2;
+        TEST_CHECK( pthread_create( &(readers[idx].thread), NULL,
+                                    __test_rdlock_main, &(readers[idx]) ) == 0 );
+    }
+
+    /* registered in the phase: the low 24 bits of policy_word */
+    TEST_WAIT_FOR( (shared.latch.policy_word & 0x00FFFFFF) == TEST_PF_READERS, ok );
+    TEST_CHECK( ok == true );
+
+    writer.shared     = &shared;
+    writer.session_id = TEST_PF_READERS + 2;
+    TEST_CHECK( pthread_create( &(writer.thread), NULL, __test_wrlock_main, &writer ) == 0 );
+    __test_sleep_msec( TEST_SETTLE_MSEC );
+
+    TEST_CHECK( sxlatch_unlock( &(shared.latch), 1 ) == RC_SUCCESS );
+
+    pthread_join( writer.thread, NULL );
+    for( idx = 0; idx < TEST_PF_READERS; idx++ )
+    {
+        pthread_join( readers[idx].thread, NULL );
+        TEST_CHECK( readers[idx].ret == RC_SUCCESS );
+        TEST_CHECK( readers[idx].ticket < writer.ticket );
+    }
+    TEST_CHECK( writer.ret == RC_SUCCESS );
+    TEST_CHECK( sxlatch_is_unlock( &(shared.latch) ) == true );
+
+    /* under load */
+    TEST_CHECK( __test_rw_stress( &shared ) == 0 );
+    TEST_CHECK( sxlatch_is_unlock( &(shared.latch) ) == true );
+    TEST_CHECK( shared.latch.policy_word % (1 << 24) == 0 );
+    TEST_CHECK( sxlatch_destroy( &(shared.latch) ) == RC_SUCCESS );
+
+    return RC_SUCCESS;
+
+    CATCH_END;
+
+    return RC_FAIL;
+}
+
+static int __test_recovery( void )
+{
+    test_shared_t shared;
+    test_thread_t waiter;
+    sxlatch_recover_stat_t stat;
+    sxlatch_t s_latch;
+    sxlatch_t p_latch;
+
+    memset( &shared, 0x00, sizeof(shared) );
+    memset( &waiter, 0x00, sizeof(waiter) );
+    TEST_CHECK( sxlatch_init( &(shared.latch) ) == RC_SUCCESS );
+    TEST_CHECK( sxlatch_init( &s_latch ) == RC_SUCCESS );
+    TEST_CHECK( sxlatch_init( &p_latch ) == RC_SUCCESS );
+
+    /* no log, no recovery */
+    TEST_CHECK( sxlatch_recover_session( 5, 0, &stat ) == RC_FAIL );
+
+    TEST_CHECK( sxlatch_session_track_holds( true ) == RC_SUCCESS );
+
+    /* session 5 dies with X and S; 6 waits for its X, 7 shares its S */
+    TEST_CHECK( sxlatch_wrlock( &(shared.latch), 5 ) == RC_SUCCESS );
+    TEST_CHECK( sxlatch_rdlock( &s_latch, 5 ) == RC_SUCCESS );
+    TEST_CHECK( sxlatch_rdlock( &s_latch, 7 ) == RC_SUCCESS );
+
+    waiter.shared     = &shared;
+    waiter.session_id = 6;
+    TEST_CHECK( pthread_create( &(waiter.thread), NULL, __test_wrlock_main, &waiter ) == 0 );
+    __test_sleep_msec( TEST_SETTLE_MSEC );
+
+    TEST_CHECK( sxlatch_recover_session( 5, 0, &stat ) == RC_SUCCESS );
+    TEST_CHECK( stat.released == 2 && stat.failed == 0 );
+
+    pthread_join( waiter.thread, NULL );
+    TEST_CHECK( waiter.ret == RC_SUCCESS );
+    TEST_CHECK( sxlatch_is_unlock( &(shared.latch) ) == true );
+
+    /* the live reader keeps its S */
+    TEST_CHECK( SXLATCH_GET_VALUE( &s_latch ) == 1 );
+    TEST_CHECK( sxlatch_unlock( &s_latch, 7 ) == RC_SUCCESS );
+    TEST_CHECK( sxlatch_is_unlock( &s_latch ) == true );
+
+    /* session 8 dies requesting S next to a live reader: left pending */
+    TEST_CHECK( sxlatch_rdlock( &p_latch, 7 ) == RC_SUCCESS );
+    sxlatch_session_hold_request( 8, &p_latch, BF_LATCH_MODE_S );
+
+    TEST_CHECK( sxlatch_recover_session( 8, TEST_SETTLE_MSEC, &stat ) == RC_FAIL );
+    TEST_CHECK( stat.failed == 1 );
+    TEST_CHECK( SXLATCH_GET_VALUE( &p_latch ) == 1 );
+    TEST_CHECK( p_latch.cleanup_in_progress_cnt == 0 );
+
+    /* resolved once the reader left */
+    TEST_CHECK( sxlatch_unlock( &p_latch, 7 ) == RC_SUCCESS );
+    TEST_CHECK( sxlatch_recover_session( 8, 0, &stat ) == RC_SUCCESS );
+    TEST_CHECK( stat.ambiguous == 1 );
+    TEST_CHECK( sxlatch_is_unlock( &p_latch ) == true );
+
+    (void)sxlatch_session_track_holds( false );
+
+    TEST_CHECK( sxlatch_destroy( &(shared.latch) ) == RC_SUCCESS );
+    TEST_CHECK( sxlatch_destroy( &s_latch ) == RC_SUCCESS );
+    TEST_CHECK( sxlatch_destroy( &p_latch ) == RC_SUCCESS );
+
+    return RC_SUCCESS;
+
+    CATCH_END;
+
+    (void)sxlatch_session_track_holds( false );
+
+    return RC_FAIL;
+}
+
+typedef struct _test_case test_case_t;
+struct _test_case
+{
+    const char * name;
+    int       (* func)( void );
+};
+
+static const test_case_t __test_cases[] = {
+    { "xadd",       __test_xadd },
+    { "drain",      __test_drain },
+    { "phase-fair", __test_phase_fair },
+    { "recovery",   __test_recovery }
+};
+
+int main( int argc, char * argv[] )
+{
+    int failed = 0;
+    int ran    = 0;
+    int idx    = 0;
+
+    for( idx = 0; idx < (int)(sizeof(__test_cases) / sizeof(__test_cases[0])); idx++ )
+    {
+        if( argc > 1 && strcmp( argv[1], __test_cases[idx].name ) != 0 )
+        {
+            continue;
+        }
+
+        __test_failed_line = 0;
+        ran++;
+
+        if( __test_cases[idx].func() == RC_SUCCESS )
+        {
+            printf( "PASS  %s\n", __test_cases[idx].name );
+        }
+        else
+        {
+            printf( "FAIL  %s(test.c:%d)\n", __test_cases[idx].name, __test_failed_line );
+            failed++;
+        }
+    }
+
+    if( ran == 0 )
+    {
+        fprintf( stderr, "usage: %s [xadd|drain|phase-fair|recovery]\n", argv[0] );
+        return 1;
+    }
+
+    return ( failed > 0 ) ? 1 : 0;
+}
@@ -0,0 +1,142 @@
+#ifndef __APPLE__
+#include <pthread.h>
+#include <stdint.h>
+#include <time.h>
+#include <errno.h>
+#include <cpuid.h>
+#include <sys/prctl.h>
+#include "util.h"
+#include "rand_r.h"
+
+/* On linux, ticks are rdtsc() cycles when the TSC runs at a constant rate
+ * across P/C-states and cores(invariant TSC), CLOCK_MONOTONIC nanoseconds
+ * otherwise. clock_gettime() is a vDSO call: no system call either way.
+ * The cycle rate is calibrated against CLOCK_MONOTONIC once. */
+#define TSC_CALIBRATION_USEC    10000  /* 10 msec. */
+
+#define TIME_SOURCE_UNKNOWN     0
+#define TIME_SOURCE_TSC         1
+#define TIME_SOURCE_MONOTONIC   2
+
+static pthread_once_t time_source_once = PTHREAD_ONCE_INIT;
+static volatile int time_source = TIME_SOURCE_UNKNOWN;
+
+static pthread_once_t tsc_calibration_once = PTHREAD_ONCE_INIT;
+static double nsec_per_tick = 1.0;
+
+uint64_t get_time_nsec( void )
+{
+  struct timespec ts;
+  clock_gettime( CLOCK_MONOTONIC, &ts );
+  return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+bool tsc_is_invariant( void )
+{
+  unsigned int eax = 0;
+  unsigned int ebx = 0;
+  unsigned int ecx = 0;
+  unsigned int edx = 0;
+
+  /* CPUID.80000007H:EDX[8] */
+  if( __get_cpuid( 0x80000007, &eax, &ebx, &ecx, &edx ) == 0 )
+    {
+      return false;
+    }
+  return ( (edx & (1U << 8)) != 0 ) ? true : false;
+}
+
+static void choose_time_source( void )
+{
+  time_source = ( tsc_is_invariant() == true ) ?
+                TIME_SOURCE_TSC : TIME_SOURCE_MONOTONIC;
+}
+
+static uint64_t get_time_slow( void )
+{
+  pthread_once( &time_source_once, choose_time_source );
+
+  return ( time_source == TIME_SOURCE_TSC ) ? rdtsc() : get_time_nsec();
+}
+
+static void calibrate_tsc( void )
+{
+  uint64_t begin_nsec = 0;
+  uint64_t begin_tsc  = 0;
+  uint64_t end_nsec   = 0;
+  uint64_t end_tsc    = 0;
+
+  pthread_once( &time_source_once, choose_time_source );
+  if( time_source != TIME_SOURCE_TSC )
+    {
+      return; /* ticks are nanoseconds already */
+    }
+
+  begin_nsec = get_time_nsec();
+  begin_tsc  = rdtsc();
+
+  thread_sleep_nsec( TSC_CALIBRATION_USEC * 1000ULL );
+
+  end_nsec = get_time_nsec();
+  end_tsc  = rdtsc();
+
+  if( end_tsc > begin_tsc && end_nsec > begin_nsec )
+    {
+      nsec_per_tick = (double)(end_nsec - begin_nsec) /
+                      (double)(end_tsc - begin_tsc);
+    }
+}
+
+uint64_t get_time( void )
+{
+  if( __builtin_expect( time_source == TIME_SOURCE_TSC, 1 ) )
+    {
+      return rdtsc();
+    }
+  return get_time_slow();
+}
+
+double get_elapsed_time( uint64_t elapsed )
+{
+  pthread_once( &tsc_calibration_once, calibrate_tsc );
+  return (double)elapsed * nsec_per_tick;
+}
+
+int thread_sleep_nsec( uint64_t nsec )
+{
+  struct timespec deadline;
+  uint64_t deadline_nsec = 0;
+  int slack = 0;
+  int ret = 0;
+
+  if( nsec == 0 )
+    {
+      return 0;
+    }
+
+  /* the default 50us slack would dwarf short sleeps: lower it for this
+   * sleep only, the slack of the thread is the caller's */
+  slack = prctl( PR_GET_TIMERSLACK, 0, 0, 0, 0 );
+  if( slack > 1 )
+    {
+      (void)prctl( PR_SET_TIMERSLACK, 1UL, 0, 0, 0 );
+    }
+
+  deadline_nsec    = get_time_nsec() + nsec;
+  deadline.tv_sec  = deadline_nsec / 1000000000ULL;
+  deadline.tv_nsec = deadline_nsec % 1000000000ULL;
+
+  /* an absolute deadline: signals do not stretch the sleep */
+  do
+    {
+      ret = clock_nanosleep( CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL );
+    } while( ret == EINTR );
+
+  if( slack > 1 )
+    {
+      (void)prctl( PR_SET_TIMERSLACK, (unsigned long)slack, 0, 0, 0 );
+    }
+
+  return ( ret == 0 ) ? 0 : -1;
+}
+#endif /* __APPLE__ */
@@ -0,0 +1,345 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <memory.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <time.h>
+
+#include "trace.h"
+#include "sxlatch.h"
+#include "atomic.h"
+#include "rand_r.h"
+#include "util.h"
+
+typedef struct _sxlatch_trace_ring sxlatch_trace_ring_t;
+struct _sxlatch_trace_ring
+{
+    sxlatch_trace_ring_t * next;
+    volatile int32_t       in_use;
+    int32_t                tid;
+    /* written by the owner thread only */
+    volatile uint64_t      head;
+    sxlatch_trace_rec_t    recs[SXLATCH_TRACE_RING_SIZE];
+};
+
+volatile int32_t __sxlatch_trace_enabled = 0;
+
+static uint64_t __sxlatch_trace_begin_tsc  = 0;
+static uint64_t __sxlatch_trace_begin_nsec = 0;
+
+/* all rings ever created. A ring is never freed but is handed over to
+ * a new thread after its owner thread exited. */
+static sxlatch_trace_ring_t * volatile __sxlatch_trace_rings = NULL;
+static __thread sxlatch_trace_ring_t * __sxlatch_trace_my_ring = NULL;
+
+static pthread_once_t __sxlatch_trace_once = PTHREAD_ONCE_INIT;
+static pthread_key_t  __sxlatch_trace_key;
+
+static const char * __sxlatch_trace_event_name[SXLATCH_TRACE_EVENT_MAX] = {
+    "request",
+    "x_blocked",
+    "acquire",
+    "release",
+    "timeout",
+    "interrupt",
+    "busy"
+};
+
+static void __sxlatch_trace_detach( void * arg )
+{
+    sxlatch_trace_ring_t * ring = (sxlatch_trace_ring_t *)arg;
+
+    mem_barrier();
+    ring->in_use = 0;
+}
+
+static void __sxlatch_trace_init_key( void )
+{
+    pthread_key_create( &__sxlatch_trace_key, __sxlatch_trace_detach );
+}
+
+static sxlatch_trace_ring_t * __sxlatch_trace_attach( void )
+{
+    sxlatch_trace_ring_t * ring = NULL;
+    sxlatch_trace_ring_t * oldhead = NULL;
+
+    pthread_once( &__sxlatch_trace_once, __sxlatch_trace_init_key );
+
+    /* reuse a ring of an exited thread first */
+    for( ring = __sxlatch_trace_rings; ring != NULL; ring = ring->next )
+    {
+        if( ring->in_use == 0 &&
+            atomic_cas_32( &(ring->in_use), 0, 1 ) == 0 )
+        {
+            break;
+        }
+    }
+
+    if( ring == NULL )
+    {
+        TRY( posix_memalign( (void **)&ring, 64, sizeof(sxlatch_trace_ring_t) ) != 0 );
+        memset( ring, 0x00, sizeof(sxlatch_trace_ring_t) );
+        ring->in_use = 1;
+
+        do
+        {
+            oldhead    = __sxlatch_trace_rings;
+            ring->next = oldhead;
+        } while( atomic_cas_64( &__sxlatch_trace_rings, oldhead, ring ) != oldhead );
+    }
+
+    /* keep head: the records of the previous owner stay in order */
+    ring->tid = (int32_t)gettid();
+
+    pthread_setspecific( __sxlatch_trace_key, ring );
+    __sxlatch_trace_my_ring = ring;
+
+    return ring;
+
+    CATCH_END;
+
+    return NULL;
+}
+
+void sxlatch_trace_record( const void * latch,
+                           int          event,
+                           session_id_t session_id,
+                           int          mode )
+{
+    sxlatch_trace_ring_t * ring = __sxlatch_trace_my_ring;
+    sxlatch_trace_rec_t  * rec  = NULL;
+
+    if( __builtin_expect( ring == NULL, 0 ) )
+    {
+        ring = __sxlatch_trace_attach();
+        if( ring == NULL )
+        {
+            return;
+        }
+    }
+
+    rec = &(ring->recs[ring->head & SXLATCH_TRACE_RING_MASK]);
+    rec->tsc        = get_time();
+    rec->latch      = (uint64_t)(uintptr_t)latch;
+    rec->session_id = session_id;
+    rec->tid        = ring->tid;
+    rec->event      = (uint8_t)event;
+    rec->mode       = (uint8_t)mode;
+
+    /* publish the record: only a compiler barrier is needed,
+     * the dumper tolerates a torn record at the tail. */
+    __asm__ __volatile__( "" ::: "memory" );
+    ring->head++;
+}
+
+int sxlatch_trace_enable( bool enable )
+{
+    if( enable == true )
+    {
+        __sxlatch_trace_begin_nsec = get_time_nsec();
+        __sxlatch_trace_begin_tsc  = get_time();
+    }
+
+    mem_barrier();
+    __sxlatch_trace_enabled = (enable == true) ? 1 : 0;
+    mem_barrier();
+
+    return RC_SUCCESS;
+}
+
+int sxlatch_trace_dump( const char * path )
+{
+    FILE * fp = NULL;
+    sxlatch_trace_ring_t * ring = NULL;
+    sxlatch_trace_file_header_t header;
+    sxlatch_trace_ring_header_t ring_header;
+    uint64_t head = 0;
+    uint64_t idx  = 0;
+
+    memset( &header, 0x00, sizeof(header) );
+    memcpy( header.magic, SXLATCH_TRACE_MAGIC, sizeof(header.magic) );
+    header.rec_size   = sizeof(sxlatch_trace_rec_t);
+    header.begin_tsc  = __sxlatch_trace_begin_tsc;
+    header.begin_nsec = __sxlatch_trace_begin_nsec;
+    header.end_nsec   = get_time_nsec();
+    header.end_tsc    = get_time();
+
+    for( ring = __sxlatch_trace_rings; ring != NULL; ring = ring->next )
+    {
+        header.ring_cnt++;
+    }
+
+    fp = fopen( path, "wb" );
+    TRY( fp == NULL );
+
+    TRY_GOTO( fwrite( &header, sizeof(header), 1, fp ) != 1, err_write );
+
+    /* rings pushed after counting are not written */
+    for( ring = __sxlatch_trace_rings;
+         ring != NULL && header.ring_cnt > 0;
+         ring = ring->next, header.ring_cnt-- )
+    {
+        head = ring->head;
+        mem_barrier();
+
+        ring_header.tid      = ring->tid;
+        ring_header.reserved = 0;
+        ring_header.rec_cnt  = ( head > SXLATCH_TRACE_RING_SIZE ) ?
+                               SXLATCH_TRACE_RING_SIZE : head;
+        TRY_GOTO( fwrite( &ring_header, sizeof(ring_header), 1, fp ) != 1,
+                  err_write );
+
+        for( idx = head - ring_header.rec_cnt; idx < head; idx++ )
+        {
+            TRY_GOTO( fwrite( &(ring->recs[idx & SXLATCH_TRACE_RING_MASK]),
+                              sizeof(sxlatch_trace_rec_t), 1, fp ) != 1,
+                      err_write );
+        }
+    }
+
+    TRY( fclose( fp ) != 0 );
+
+    return RC_SUCCESS;
+
+    CATCH( err_write )
+    {
+        fclose( fp );
+    }
+    CATCH_END;
+
+    return RC_FAIL;
+}
+
+static void __sxlatch_trace_write_event( FILE       * out,
+                                         bool       * first,
+                                         const char * name,
+                                         const char * phase,
+                                         double       ts,
+                                         sxlatch_trace_rec_t * rec )
+{
+    fprintf( out,
+             "%s\n{\"name\":\"%s\",\"cat\":\"latch\",\"ph\":\"%s\","
+             "\"pid\":1,\"tid\":%d,\"ts\":%.3f,"
+             "\"id\":\"0x%llx:%d\","
+             "\"args\":{\"latch\":\"0x%llx\",\"session\":%d,\"mode\":\"%s\"}}",
+             (*first == true) ? "" : ",",
+             name, phase, rec->tid, ts,
+             (unsigned long long)rec->latch, rec->tid,
+             (unsigned long long)rec->latch, rec->session_id,
+             (rec->mode == BF_LATCH_MODE_S) ? "S" : "X" );
+    *first = false;
+}
+
+int sxlatch_trace_to_chrome( const char * trace_path, const char * json_path )
+{
+    FILE * in  = NULL;
+    FILE * out = NULL;
+    sxlatch_trace_file_header_t header;
+    sxlatch_trace_ring_header_t ring_header;
+    sxlatch_trace_rec_t rec;
+    double   tsc_per_usec = 1.0;
+    uint64_t idx = 0;
+    uint32_t ring = 0;
+    double   ts = 0;
+    bool     first = true;
+
+    in = fopen( trace_path, "rb" );
+    TRY( in == NULL );
+
+    TRY_GOTO( fread( &header, sizeof(header), 1, in ) != 1, err_format );
+    TRY_GOTO( memcmp( header.magic, SXLATCH_TRACE_MAGIC, sizeof(header.magic) ) != 0,
+              err_format );
+    TRY_GOTO( header.rec_size != sizeof(sxlatch_trace_rec_t), err_format );
+
+    if( header.end_nsec > header.begin_nsec && header.end_tsc > header.begin_tsc )
+    {
+        tsc_per_usec = (double)(header.end_tsc - header.begin_tsc) * 1000.0 /
+                       (double)(header.end_nsec - header.begin_nsec);
+    }
+
+    out = fopen( json_path, "w" );
+    TRY_GOTO( out == NULL, err_format );
+
+    fprintf( out, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[" );
+
+    for( ring = 0; ring < header.ring_cnt; ring++ )
+    {
+        TRY_GOTO( fread( &ring_header, sizeof(ring_header), 1, in ) != 1,
+                  err_format );
+
+        fprintf( out,
+                 "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,"
+                 "\"args\":{\"name\":\"tid %d\"}}",
+                 (first == true) ? "" : ",",
+                 ring_header.tid, ring_header.tid );
+        first = false;
+
+        for( idx = 0; idx < ring_header.rec_cnt; idx++ )
+        {
+            TRY_GOTO( fread( &rec, sizeof(rec), 1, in ) != 1, err_format );
+
+            if( rec.event >= SXLATCH_TRACE_EVENT_MAX )
+            {
+                /* torn record */
+                continue;
+            }
+
+            ts = (rec.tsc > header.begin_tsc) ?
+                 (double)(rec.tsc - header.begin_tsc) / tsc_per_usec : 0;
+
+            /* wait and hold intervals are async slices keyed by
+             * (latch, thread), points are instant events. */
+            switch( rec.event )
+            {
+                case SXLATCH_TRACE_REQUEST:
+                    __sxlatch_trace_write_event( out, &first, "wait", "b",
+                                                 ts, &rec );
+                    break;
+
+                case SXLATCH_TRACE_ACQUIRE:
+                    __sxlatch_trace_write_event( out, &first, "wait", "e",
+                                                 ts, &rec );
+                    __sxlatch_trace_write_event( out, &first, "hold", "b",
+                                                 ts, &rec );
+                    break;
+
+                case SXLATCH_TRACE_RELEASE:
+                    __sxlatch_trace_write_event( out, &first, "hold", "e",
+                                                 ts, &rec );
+                    break;
+
+                case SXLATCH_TRACE_TIMEOUT:
+                case SXLATCH_TRACE_INTERRUPT:
+                    __sxlatch_trace_write_event( out, &first, "wait", "e",
+                                                 ts, &rec );
+                    /* fall through */
+                default:
+                    __sxlatch_trace_write_event( out, &first,
+                                                 __sxlatch_trace_event_name[rec.event],
+                                                 "n",
+                                                 ts, &rec );
+                    break;
+            }
+        }
+    }
+
+    fprintf( out, "\n]}\n" );
+
+    fclose( in );
+    TRY( fclose( out ) != 0 );
+
+    return RC_SUCCESS;
+
+    CATCH( err_format )
+    {
+        fclose( in );
+        if( out != NULL )
+        {
+            fclose( out );
+        }
+    }
+    CATCH_END;
+
+    return RC_FAIL;
+}
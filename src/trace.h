@@ -0,0 +1,93 @@
+#ifndef _TRACE_H_
+#define _TRACE_H_ 1
+
+#include <stdint.h>
+#include "util.h"
+#include "session.h"
+
+/* latch event trace
+ * Every thread records latch events into its own ring buffer, so
+ * recording needs neither a lock nor an atomic instruction.
+ * The rings are written to a binary file by sxlatch_trace_dump(), and
+ * sxlatch_trace_to_chrome() converts that file into Chrome/Perfetto
+ * trace json(chrome://tracing, ui.perfetto.dev). */
+
+#define SXLATCH_TRACE_REQUEST       0  /* acquisition was requested */
+#define SXLATCH_TRACE_X_BLOCKED     1  /* X_BLOCKED was marked */
+#define SXLATCH_TRACE_ACQUIRE       2
+#define SXLATCH_TRACE_RELEASE       3
+#define SXLATCH_TRACE_TIMEOUT       4
+#define SXLATCH_TRACE_INTERRUPT     5
+#define SXLATCH_TRACE_BUSY          6  /* try*lock() failed */
+#define SXLATCH_TRACE_EVENT_MAX     7
+
+/* 32 bytes */
+typedef struct _sxlatch_trace_rec sxlatch_trace_rec_t;
+struct _sxlatch_trace_rec
+{
+    uint64_t      tsc;
+    uint64_t      latch;
+    session_id_t  session_id;
+    int32_t       tid;       /* a ring may be handed over to a new thread */
+    uint8_t       event;
+    uint8_t       mode;      /* BF_LATCH_MODE_S or BF_LATCH_MODE_X_ACQUIRED */
+    uint8_t       reserved[6];
+};
+
+/* records per thread, must be power of 2 */
+#define SXLATCH_TRACE_RING_SIZE     (16 * 1024)
+#define SXLATCH_TRACE_RING_MASK     (SXLATCH_TRACE_RING_SIZE - 1)
+
+/* binary dump file
+ * | header | ring header | records ... | ring header | records ... |
+ * the records of a ring are written in the recorded order. */
+#define SXLATCH_TRACE_MAGIC         "SXTRACE1"
+
+typedef struct _sxlatch_trace_file_header sxlatch_trace_file_header_t;
+struct _sxlatch_trace_file_header
+{
+    char      magic[8];
+    uint32_t  rec_size;
+    uint32_t  ring_cnt;
+    /* (tsc, CLOCK_MONOTONIC nsec) pairs taken when tracing was enabled
+     * and when the dump was written. The converter derives the tsc rate
+     * from them. tsc is get_time() ticks: nanoseconds already where the
+     * TSC is not invariant. */
+    uint64_t  begin_tsc;
+    uint64_t  begin_nsec;
+    uint64_t  end_tsc;
+    uint64_t  end_nsec;
+};
+
+typedef struct _sxlatch_trace_ring_header sxlatch_trace_ring_header_t;
+struct _sxlatch_trace_ring_header
+{
+    int32_t   tid;       /* the current owner */
+    uint32_t  reserved;
+    uint64_t  rec_cnt;
+};
+
+extern volatile int32_t __sxlatch_trace_enabled;
+
+void sxlatch_trace_record( const void * latch,
+                           int          event,
+                           session_id_t session_id,
+                           int          mode );
+
+#ifdef SXLATCH_NO_TRACE
+#define SXLATCH_TRACE( _latch, _event, _session_id, _mode )
+#else
+#define SXLATCH_TRACE( _latch, _event, _session_id, _mode )                  \
+    do {                                                                     \
+        if( __builtin_expect( __sxlatch_trace_enabled, 0 ) )                 \
+        {                                                                    \
+            sxlatch_trace_record( (_latch), (_event), (_session_id), (_mode) ); \
+        }                                                                    \
+    } while( 0 )
+#endif /* SXLATCH_NO_TRACE */
+
+int sxlatch_trace_enable( bool enable );
+int sxlatch_trace_dump( const char * path );
+int sxlatch_trace_to_chrome( const char * trace_path, const char * json_path );
+
+#endif /* _TRACE_H_ */
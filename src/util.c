@@ -6,8 +6,15 @@
 #include <pthread.h>
 #include <stdint.h>
 #include <sys/time.h>
+#include <limits.h>
 #include "util.h"
 
+#ifndef __APPLE__
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#endif /* __APPLE__ */
+
 /* rdtsc(): https://docs.microsoft.com/ko-kr/cpp/intrinsics/rdtsc?view=vs-2017 */
 
 uint64_t rdtsc(void)
@@ -19,6 +26,12 @@ uint64_t rdtsc(void)
 
 int thread_sleep( uint64_t sec, uint64_t usec )
 {
+#ifndef __APPLE__
+  if( sec != 0 || usec != 0 )
+    {
+      return thread_sleep_nsec( sec * 1000000000ULL + usec * 1000ULL );
+    }
+#endif /* __APPLE__ */
 #if 0
   return poll(NULL, 0, (sec * 1000) + (usec / 1000));
 #else
@@ -39,6 +52,193 @@ int thread_sleep( uint64_t sec, uint64_t usec )
 #endif
 }
 
+#ifndef __APPLE__
+int futex_wait( volatile int32_t * addr, int32_t expected, uint64_t usec )
+{
+  struct timespec tspec;
+  struct timespec *tspecp = NULL;
+  if( usec != 0 )
+    {
+      tspec.tv_sec = usec / 1000000;
+      tspec.tv_nsec = (usec % 1000000) * 1000;
+      tspecp = &tspec;
+    }
+
+  return syscall( SYS_futex, addr, FUTEX_WAIT_PRIVATE, expected,
+                  tspecp, NULL, 0 );
+}
+
+int futex_wake( volatile int32_t * addr, int32_t wake_cnt )
+{
+  return syscall( SYS_futex, addr, FUTEX_WAKE_PRIVATE,
+                  (wake_cnt > 0) ? wake_cnt : INT_MAX,
+                  NULL, NULL, 0 );
+}
+#else
+int futex_wait( volatile int32_t * addr, int32_t expected, uint64_t usec )
+{
+  /* no futex on darwin: fall back to a plain sleep */
+  if( *addr != expected )
+    {
+      return 0;
+    }
+  return thread_sleep( 0, (usec != 0) ? usec : 1 );
+}
+
+int futex_wake( volatile int32_t * addr, int32_t wake_cnt )
+{
+  return 0;
+}
+#endif /* __APPLE__ */
+
+#ifndef __APPLE__
+#include <linux/membarrier.h>
+
+/* membarrier(2): the calling process registers once for the private
+ * expedited command(linux 4.14+) */
+static pthread_once_t membarrier_once = PTHREAD_ONCE_INIT;
+static int membarrier_registered = 0;
+
+static void register_membarrier( void )
+{
+  int cmds = syscall( SYS_membarrier, MEMBARRIER_CMD_QUERY, 0 );
+
+  if( cmds > 0 &&
+      (cmds & MEMBARRIER_CMD_PRIVATE_EXPEDITED) != 0 &&
+      syscall( SYS_membarrier, MEMBARRIER_CMD_REGISTER_PRIVATE_EXPEDITED, 0 ) == 0 )
+    {
+      membarrier_registered = 1;
+    }
+}
+
+bool process_membarrier_supported( void )
+{
+  pthread_once( &membarrier_once, register_membarrier );
+  return ( membarrier_registered != 0 ) ? true : false;
+}
+
+int process_membarrier( void )
+{
+  TRY( process_membarrier_supported() == false );
+  TRY( syscall( SYS_membarrier, MEMBARRIER_CMD_PRIVATE_EXPEDITED, 0 ) != 0 );
+
+  return RC_SUCCESS;
+
+  CATCH_END;
+
+  return RC_FAIL;
+}
+#else
+bool process_membarrier_supported( void )
+{
+  return false;
+}
+
+int process_membarrier( void )
+{
+  return RC_FAIL;
+}
+#endif /* __APPLE__ */
+
+#ifndef __APPLE__
+#include <sys/mman.h>
+#include <linux/mempolicy.h>
+
+int numa_node_of_caller( void )
+{
+  unsigned cpu  = 0;
+  unsigned node = 0;
+
+  if( syscall( SYS_getcpu, &cpu, &node, NULL ) != 0 )
+    {
+      return -1;
+    }
+  return (int)node;
+}
+
+void * huge_page_alloc( size_t size, int node, bool * huge )
+{
+  unsigned long nodemask = 0;
+  char * ptr  = NULL;
+  char * base = NULL;
+  size_t head = 0;
+
+  *huge = true;
+  ptr = mmap( NULL, size, PROT_READ | PROT_WRITE,
+              MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0 );
+
+  if( ptr == MAP_FAILED )
+    {
+      /* no reserved huge pages: align small pages for THP */
+      *huge = false;
+      base = mmap( NULL, size + HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
+      if( base == MAP_FAILED )
+        {
+          return NULL;
+        }
+
+      ptr  = (char *)(((uintptr_t)base + HUGE_PAGE_SIZE - 1) &
+                      ~(uintptr_t)(HUGE_PAGE_SIZE - 1));
+      head = ptr - base;
+      if( head > 0 )
+        {
+          munmap( base, head );
+        }
+      munmap( ptr + size, HUGE_PAGE_SIZE - head );
+
+      (void)madvise( ptr, size, MADV_HUGEPAGE );
+    }
+
+  if( node < 0 )
+    {
+      node = numa_node_of_caller();
+    }
+
+  if( node >= 0 && node < (int)(sizeof(nodemask) * 8) )
+    {
+      /* nothing is touched yet: the pages fault in on node */
+      nodemask = 1UL << node;
+      (void)syscall( SYS_mbind, ptr, size, MPOL_PREFERRED,
+                     &nodemask, sizeof(nodemask) * 8, 0 );
+    }
+
+  return ptr;
+}
+
+void huge_page_free( void * ptr, size_t size )
+{
+  munmap( ptr, size );
+}
+#else
+#include <stdlib.h>
+#include <memory.h>
+
+int numa_node_of_caller( void )
+{
+  return -1;
+}
+
+void * huge_page_alloc( size_t size, int node, bool * huge )
+{
+  void * ptr = NULL;
+
+  *huge = false;
+  if( posix_memalign( &ptr, HUGE_PAGE_SIZE, size ) != 0 )
+    {
+      return NULL;
+    }
+  memset( ptr, 0x00, size );
+
+  return ptr;
+}
+
+void huge_page_free( void * ptr, size_t size )
+{
+  free( ptr );
+}
+#endif /* __APPLE__ */
+
 #ifdef __APPLE__
 #include <mach/mach.h>
 #include <mach/mach_time.h>
@@ -62,4 +262,24 @@ double get_elapsed_time( uint64_t elapsed )
    return (double)(elapsed * sTimebaseInfo.numer) / sTimebaseInfo.denom;
 }
 
+uint64_t get_time_nsec( void )
+{
+    return (uint64_t)get_elapsed_time( mach_absolute_time() );
+}
+
+bool tsc_is_invariant( void )
+{
+    return false;
+}
+
+int thread_sleep_nsec( uint64_t nsec )
+{
+    if( nsec == 0 )
+    {
+        return 0;
+    }
+    return thread_sleep( nsec / 1000000000ULL,
+                         ((nsec % 1000000000ULL) + 999) / 1000 );
+}
+
 #endif /* __APPLE__ */
@@ -11,6 +11,8 @@
 #define EXTERN_C_END
 #endif
 
+#include <stddef.h>
+
 #ifndef __cplusplus
 #include <stdint.h>
 typedef int32_t bool;
@@ -44,6 +46,43 @@ enum {
 
 int thread_sleep( uint64_t sec, uint64_t usec );
 
+/* futex_wait(): sleep while *addr == expected, at most usec (0: forever).
+ * futex_wake(): wake up to wake_cnt sleepers on addr. */
+int futex_wait( volatile int32_t * addr, int32_t expected, uint64_t usec );
+int futex_wake( volatile int32_t * addr, int32_t wake_cnt );
+
+/* process_membarrier(): run a full memory barrier on every running thread
+ * of the process(membarrier(2) private expedited). RC_FAIL if the kernel
+ * does not support it: check process_membarrier_supported() first. */
+bool process_membarrier_supported( void );
+int process_membarrier( void );
+
+/* huge_page_alloc(): size bytes(a multiple of HUGE_PAGE_SIZE) of zeroed
+ * memory aligned on HUGE_PAGE_SIZE, preferably on NUMA node(-1: the node
+ * of the caller). *huge is true if it comes from reserved huge pages,
+ * false if from transparent huge pages(or small pages). Give it back with
+ * huge_page_free().
+ * numa_node_of_caller(): node of the cpu the caller runs on, -1 if unknown */
+#define HUGE_PAGE_SIZE    (2UL * 1024 * 1024)
+void * huge_page_alloc( size_t size, int node, bool * huge );
+void huge_page_free( void * ptr, size_t size );
+int numa_node_of_caller( void );
+
+/* timing(timing.c on linux)
+ * get_time(): current time in ticks: TSC cycles if the TSC is invariant,
+ *             CLOCK_MONOTONIC(vDSO) nanoseconds otherwise
+ * get_elapsed_time(): ticks -> nanoseconds(the TSC rate is calibrated
+ *             against CLOCK_MONOTONIC once, at the first call)
+ * get_time_nsec(): CLOCK_MONOTONIC in nanoseconds
+ * thread_sleep_nsec(): sleep until nsec have passed(clock_nanosleep on an
+ *             absolute deadline, 1ns timer slack during the sleep, the
+ *             slack of the thread is restored): precise short sleeps */
+uint64_t get_time( void );
+double get_elapsed_time( uint64_t elapsed );
+uint64_t get_time_nsec( void );
+bool tsc_is_invariant( void );
+int thread_sleep_nsec( uint64_t nsec );
+
 #ifdef __APPLE__
 #include <sys/types.h>
 pid_t gettid( void );
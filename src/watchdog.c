@@ -0,0 +1,333 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <memory.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "watchdog.h"
+#include "sxlatch.h"
+#include "session.h"
+#include "atomic.h"
+#include "util.h"
+
+typedef struct _sxlatch_watchdog_entry sxlatch_watchdog_entry_t;
+struct _sxlatch_watchdog_entry
+{
+    const sxlatch_t * latch;
+    const char      * name;
+    int64_t           owner;       /* mode | session id of the hold */
+    uint64_t          first_seen;  /* get_time() */
+    bool              reported;
+};
+
+#define SXLATCH_WATCHDOG_OWNER_MASK  (SXLATCH_MASK_MODE | SXLATCH_MASK_SESSION_ID)
+
+static pthread_mutex_t __sxlatch_watchdog_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  __sxlatch_watchdog_cond  = PTHREAD_COND_INITIALIZER;
+
+static sxlatch_watchdog_entry_t * __sxlatch_watchdog_entries  = NULL;
+static int                        __sxlatch_watchdog_entry_cnt = 0;
+static int                        __sxlatch_watchdog_entry_max = 0;
+
+static sxlatch_watchdog_conf_t __sxlatch_watchdog_conf;
+static pthread_t __sxlatch_watchdog_thread;
+static bool      __sxlatch_watchdog_running = false;
+static bool      __sxlatch_watchdog_stopping = false;
+
+int sxlatch_watchdog_register( const sxlatch_t * r, const char * name )
+{
+    sxlatch_watchdog_entry_t * entries = NULL;
+    int new_max = 0;
+
+    TRY( r == NULL );
+
+    pthread_mutex_lock( &__sxlatch_watchdog_mutex );
+
+    if( __sxlatch_watchdog_entry_cnt == __sxlatch_watchdog_entry_max )
+    {
+        new_max = ( __sxlatch_watchdog_entry_max == 0 ) ?
+                  64 : __sxlatch_watchdog_entry_max * 2;
+        entries = realloc( __sxlatch_watchdog_entries,
+                           sizeof(sxlatch_watchdog_entry_t) * new_max );
+        TRY_GOTO( entries == NULL, err_unlock );
+
+        __sxlatch_watchdog_entries   = entries;
+        __sxlatch_watchdog_entry_max = new_max;
+    }
+
+    memset( &(__sxlatch_watchdog_entries[__sxlatch_watchdog_entry_cnt]), 0x00,
+            sizeof(sxlatch_watchdog_entry_t) );
+    __sxlatch_watchdog_entries[__sxlatch_watchdog_entry_cnt].latch = r;
+    __sxlatch_watchdog_entries[__sxlatch_watchdog_entry_cnt].name  = name;
+    __sxlatch_watchdog_entry_cnt++;
+
+    pthread_mutex_unlock( &__sxlatch_watchdog_mutex );
+
+    return RC_SUCCESS;
+
+    CATCH( err_unlock )
+    {
+        pthread_mutex_unlock( &__sxlatch_watchdog_mutex );
+    }
+    CATCH_END;
+
+    return RC_FAIL;
+}
+
+int sxlatch_watchdog_unregister( const sxlatch_t * r )
+{
+    int idx = 0;
+    int ret = RC_FAIL;
+
+    pthread_mutex_lock( &__sxlatch_watchdog_mutex );
+
+    for( idx = 0; idx < __sxlatch_watchdog_entry_cnt; idx++ )
+    {
+        if( __sxlatch_watchdog_entries[idx].latch == r )
+        {
+            __sxlatch_watchdog_entry_cnt--;
+            __sxlatch_watchdog_entries[idx] =
+                __sxlatch_watchdog_entries[__sxlatch_watchdog_entry_cnt];
+            ret = RC_SUCCESS;
+            break;
+        }
+    }
+
+    pthread_mutex_unlock( &__sxlatch_watchdog_mutex );
+
+    return ret;
+}
+
+static void __sxlatch_watchdog_print( const sxlatch_watchdog_report_t * report,
+                                      void                            * arg )
+{
+    (void)arg;
+
+    fprintf( stderr,
+             "sxlatch watchdog: latch %p(%s) is held in %s by session %d "
+             "for %llu msec(readers left: %u, interrupted waiters: %d)\n",
+             (void *)report->latch,
+             (report->name != NULL) ? report->name : "-",
+             (report->mode == BF_LATCH_MODE_X_ACQUIRED) ? "X" : "X_BLOCKED",
+             report->session_id,
+             (unsigned long long)(report->hold_nsec / 1000000),
+             report->shared_cnt,
+             report->interrupted_cnt );
+}
+
+typedef struct _sxlatch_watchdog_waiter_arg sxlatch_watchdog_waiter_arg_t;
+struct _sxlatch_watchdog_waiter_arg
+{
+    const sxlatch_t * latch;
+    session_id_t      owner;
+    int32_t           interrupted_cnt;
+};
+
+static void __sxlatch_watchdog_interrupt_waiter( session_id_t        session_id,
+                                                 sxlatch_session_t * sess,
+                                                 void              * arg )
+{
+    sxlatch_watchdog_waiter_arg_t * waiter = (sxlatch_watchdog_waiter_arg_t *)arg;
+
+    if( sess->waiting_latch == waiter->latch && session_id != waiter->owner )
+    {
+        /* for this wait only: the session may wait again later */
+        sxlatch_session_interrupt_once( session_id );
+        mem_barrier();
+
+        if( sess->waiting_latch != waiter->latch )
+        {
+            /* the wait ended meanwhile */
+            sxlatch_session_drop_interrupt_once( sess );
+            return;
+        }
+        waiter->interrupted_cnt++;
+    }
+}
+
+/* caller holds __sxlatch_watchdog_mutex */
+static void __sxlatch_watchdog_check( sxlatch_watchdog_entry_t * entry,
+                                      uint64_t                   now )
+{
+    sxlatch_watchdog_report_t     report;
+    sxlatch_watchdog_waiter_arg_t waiter;
+    int64_t value = SXLATCH_GET_VALUE( entry->latch );
+    int64_t owner = value & SXLATCH_WATCHDOG_OWNER_MASK;
+    int64_t mode  = SXLATCH_GET_MODE( value );
+    uint64_t hold_nsec = 0;
+
+    if( mode != SXLATCH_MODE_X_ACQUIRED && mode != SXLATCH_MODE_X_BLOCKED )
+    {
+        entry->owner = 0;
+        return;
+    }
+
+    if( owner != entry->owner )
+    {
+        /* a new hold */
+        entry->owner      = owner;
+        entry->first_seen = now;
+        entry->reported   = false;
+        return;
+    }
+
+    hold_nsec = (uint64_t)get_elapsed_time( now - entry->first_seen );
+    if( entry->reported == true ||
+        hold_nsec < (uint64_t)__sxlatch_watchdog_conf.threshold_msec * 1000000 )
+    {
+        return;
+    }
+
+    memset( &report, 0x00, sizeof(report) );
+    report.latch      = entry->latch;
+    report.name       = entry->name;
+    report.session_id = (session_id_t)SXLATCH_GET_SESSION_ID( value );
+    report.mode       = (int)SXLATCH_GET_MODE_IDX( value );
+    report.shared_cnt = (uint32_t)SXLATCH_GET_SHARED_CNT( value );
+    report.hold_nsec  = hold_nsec;
+
+    if( __sxlatch_watchdog_conf.interrupt_waiters == true )
+    {
+        waiter.latch           = entry->latch;
+        waiter.owner           = report.session_id;
+        waiter.interrupted_cnt = 0;
+        sxlatch_session_foreach( __sxlatch_watchdog_interrupt_waiter, &waiter );
+        report.interrupted_cnt = waiter.interrupted_cnt;
+    }
+
+    __sxlatch_watchdog_conf.reporter( &report, __sxlatch_watchdog_conf.reporter_arg );
+    entry->reported = true;
+}
+
+int sxlatch_watchdog_scan( void )
+{
+    uint64_t now = get_time();
+    int idx = 0;
+
+    pthread_mutex_lock( &__sxlatch_watchdog_mutex );
+
+    if( __sxlatch_watchdog_conf.reporter == NULL )
+    {
+        __sxlatch_watchdog_conf.reporter = __sxlatch_watchdog_print;
+    }
+
+    for( idx = 0; idx < __sxlatch_watchdog_entry_cnt; idx++ )
+    {
+        __sxlatch_watchdog_check( &(__sxlatch_watchdog_entries[idx]), now );
+    }
+
+    pthread_mutex_unlock( &__sxlatch_watchdog_mutex );
+
+    return RC_SUCCESS;
+}
+
+static void * __sxlatch_watchdog_main( void * arg )
+{
+    struct timespec deadline;
+
+    (void)arg;
+
+    pthread_mutex_lock( &__sxlatch_watchdog_mutex );
+
+    while( __sxlatch_watchdog_stopping == false )
+    {
+        clock_gettime( CLOCK_REALTIME, &deadline );
+        deadline.tv_sec  += __sxlatch_watchdog_conf.interval_msec / 1000;
+        deadline.tv_nsec += (long)(__sxlatch_watchdog_conf.interval_msec % 1000) * 1000000;
+        if( deadline.tv_nsec >= 1000000000 )
+        {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000;
+        }
+
+        pthread_cond_timedwait( &__sxlatch_watchdog_cond,
+                                &__sxlatch_watchdog_mutex,
+                                &deadline );
+        if( __sxlatch_watchdog_stopping == true )
+        {
+            break;
+        }
+
+        pthread_mutex_unlock( &__sxlatch_watchdog_mutex );
+        sxlatch_watchdog_scan();
+        pthread_mutex_lock( &__sxlatch_watchdog_mutex );
+    }
+
+    pthread_mutex_unlock( &__sxlatch_watchdog_mutex );
+
+    return NULL;
+}
+
+int sxlatch_watchdog_start( const sxlatch_watchdog_conf_t * conf )
+{
+    pthread_mutex_lock( &__sxlatch_watchdog_mutex );
+
+    TRY_GOTO( __sxlatch_watchdog_running == true, err_unlock );
+
+    memset( &__sxlatch_watchdog_conf, 0x00, sizeof(__sxlatch_watchdog_conf) );
+    if( conf != NULL )
+    {
+        __sxlatch_watchdog_conf = *conf;
+    }
+    if( __sxlatch_watchdog_conf.interval_msec == 0 )
+    {
+        __sxlatch_watchdog_conf.interval_msec = SXLATCH_WATCHDOG_DEFAULT_INTERVAL_MSEC;
+    }
+    if( __sxlatch_watchdog_conf.threshold_msec == 0 )
+    {
+        __sxlatch_watchdog_conf.threshold_msec = SXLATCH_WATCHDOG_DEFAULT_THRESHOLD_MSEC;
+    }
+    if( __sxlatch_watchdog_conf.reporter == NULL )
+    {
+        __sxlatch_watchdog_conf.reporter = __sxlatch_watchdog_print;
+    }
+
+    /* calibrate the tick rate before the first scan */
+    (void)get_elapsed_time( 0 );
+
+    __sxlatch_watchdog_stopping = false;
+    TRY_GOTO( pthread_create( &__sxlatch_watchdog_thread, NULL,
+                              __sxlatch_watchdog_main, NULL ) != 0,
+              err_unlock );
+    __sxlatch_watchdog_running = true;
+
+    pthread_mutex_unlock( &__sxlatch_watchdog_mutex );
+
+    return RC_SUCCESS;
+
+    CATCH( err_unlock )
+    {
+        pthread_mutex_unlock( &__sxlatch_watchdog_mutex );
+    }
+    CATCH_END;
+
+    return RC_FAIL;
+}
+
+int sxlatch_watchdog_stop( void )
+{
+    pthread_mutex_lock( &__sxlatch_watchdog_mutex );
+
+    TRY_GOTO( __sxlatch_watchdog_running == false, err_unlock );
+
+    __sxlatch_watchdog_stopping = true;
+    pthread_cond_signal( &__sxlatch_watchdog_cond );
+
+    pthread_mutex_unlock( &__sxlatch_watchdog_mutex );
+
+    pthread_join( __sxlatch_watchdog_thread, NULL );
+
+    pthread_mutex_lock( &__sxlatch_watchdog_mutex );
+    __sxlatch_watchdog_running = false;
+    pthread_mutex_unlock( &__sxlatch_watchdog_mutex );
+
+    return RC_SUCCESS;
+
+    CATCH( err_unlock )
+    {
+        pthread_mutex_unlock( &__sxlatch_watchdog_mutex );
+    }
+    CATCH_END;
+
+    return RC_FAIL;
+}
@@ -0,0 +1,53 @@
+#ifndef _WATCHDOG_H_
+#define _WATCHDOG_H_ 1
+
+#include <stdint.h>
+#include "util.h"
+#include "sxlatch.h"
+
+/* long hold watchdog
+ * A background thread scans the registered latches every interval_msec.
+ * When a latch stays in X_ACQUIRED or X_BLOCKED by the same session longer
+ * than threshold_msec, it is reported once per hold. Optionally, the
+ * sessions waiting for the latch in sxlatch_int*lock() are interrupted,
+ * for that wait only: the interrupt does not stay as the one of
+ * sxlatch_interrupt_session() does, and needs no clearing. */
+
+typedef struct _sxlatch_watchdog_report sxlatch_watchdog_report_t;
+struct _sxlatch_watchdog_report
+{
+    const sxlatch_t * latch;
+    const char      * name;
+    session_id_t      session_id;   /* owner */
+    int               mode;         /* BF_LATCH_MODE_X_ACQUIRED or _X_BLOCKED */
+    uint32_t          shared_cnt;   /* readers left(X_BLOCKED) */
+    uint64_t          hold_nsec;    /* at least, since the first scan seeing it */
+    int32_t           interrupted_cnt;
+};
+
+typedef void (*sxlatch_watchdog_reporter)( const sxlatch_watchdog_report_t * report,
+                                           void                            * arg );
+
+typedef struct _sxlatch_watchdog_conf sxlatch_watchdog_conf_t;
+struct _sxlatch_watchdog_conf
+{
+    uint32_t                  interval_msec;
+    uint32_t                  threshold_msec;
+    bool                      interrupt_waiters;
+    sxlatch_watchdog_reporter reporter;       /* NULL: print to stderr */
+    void                    * reporter_arg;
+};
+
+#define SXLATCH_WATCHDOG_DEFAULT_INTERVAL_MSEC   100
+#define SXLATCH_WATCHDOG_DEFAULT_THRESHOLD_MSEC  1000
+
+int sxlatch_watchdog_register( const sxlatch_t * r, const char * name );
+int sxlatch_watchdog_unregister( const sxlatch_t * r );
+
+int sxlatch_watchdog_start( const sxlatch_watchdog_conf_t * conf );
+int sxlatch_watchdog_stop( void );
+
+/* one scan, without the background thread */
+int sxlatch_watchdog_scan( void );
+
+#endif /* _WATCHDOG_H_ */